@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <vector>
 
 #include "uiuc/PNG.h"
 #include "uiuc/HSLAPixel.h"
+#include "uiuc/HuePalette.h"
+#include "uiuc/StencilMask.h"
 #include "ImageTransform.h"
 
 /* ******************
@@ -18,7 +23,11 @@ Email:
 ******************** */
 
 using uiuc::HSLAPixel;
+using uiuc::HuePalette;
+using uiuc::PixelPipeline;
 using uiuc::PNG;
+using uiuc::PNGView;
+using uiuc::StencilMask;
 
 /**
  * Returns an image that has been transformed to grayscale.
@@ -29,22 +38,34 @@ using uiuc::PNG;
  */
 PNG grayscale(PNG image)
 {
-  /// This function is already written for you so you can see how to
-  /// interact with our PNG class.
-  for (unsigned x = 0; x < image.width(); x++)
+  grayscaleInPlace(image);
+  return image;
+}
+
+void grayscaleInPlace(PNG &image)
+{
+  PixelPipeline().addStage(grayscaleStage()).apply(image);
+}
+
+void grayscaleInPlace(PNGView const &view)
+{
+  PixelPipeline().addStage(grayscaleStage()).apply(view);
+}
+
+/**
+ * Returns a pipeline stage that sets the saturation of every pixel to 0.
+ */
+PixelPipeline::Stage grayscaleStage()
+{
+  return [](HSLAPixel *pixels, unsigned x, unsigned y, unsigned count)
   {
-    for (unsigned y = 0; y < image.height(); y++)
+    for (unsigned i = 0; i < count; i++)
     {
-      HSLAPixel &pixel = image.getPixel(x, y);
-
-      // `pixel` is a reference to the memory stored inside of the PNG `image`,
-      // which means you're changing the image directly. No need to `set`
-      // the pixel since you're directly changing the memory of the image.
-      pixel.s = 0;
+      // `pixels` points at the memory stored inside of the PNG image,
+      // which means you're changing the image directly.
+      pixels[i].s = 0;
     }
-  }
-
-  return image;
+  };
 }
 
 /**
@@ -70,22 +91,97 @@ PNG grayscale(PNG image)
 
 PNG createSpotlight(PNG image, int centerX, int centerY)
 {
-  for (unsigned x = 0; x < image.width(); x++)
+  createSpotlightInPlace(image, centerX, centerY);
+  return image;
+}
+
+void createSpotlightInPlace(PNG &image, int centerX, int centerY)
+{
+  PixelPipeline().addStage(spotlightStage(centerX, centerY)).apply(image);
+}
+
+void createSpotlightInPlace(PNGView const &view, int centerX, int centerY)
+{
+  PixelPipeline().addStage(spotlightStage(centerX, centerY)).apply(view);
+}
+
+PNG createSpotlights(PNG image, std::vector<Spotlight> const &spotlights)
+{
+  createSpotlightsInPlace(image, spotlights);
+  return image;
+}
+
+void createSpotlightsInPlace(PNG &image, std::vector<Spotlight> const &spotlights)
+{
+  PixelPipeline().addStage(spotlightsStage(spotlights)).apply(image);
+}
+
+// Pixels at a squared distance of this much or more from the center are
+// outside of the spotlight (160 * 160).
+static const long long kSpotlightSquaredRadius = 25600;
+
+/**
+ * Returns the spotlight multiplier for every squared distance inside of the
+ * spotlight. Pixels sit at integer offsets from the center, so the squared
+ * distance is an integer and the whole falloff fits in one table, shared by
+ * every image size and center. The table is built once, on first use.
+ */
+static double const *spotlightMultipliers()
+{
+  static std::vector<double> const multipliers = []
   {
-    for (unsigned y = 0; y < image.height(); y++)
+    std::vector<double> table(kSpotlightSquaredRadius);
+    for (long long squared = 0; squared < kSpotlightSquaredRadius; squared++)
     {
-      HSLAPixel &pixel = image.getPixel(x, y);
-      double distance = sqrt(pow((int)x - centerX, 2) + pow((int)y - centerY, 2));
-      double multiplier = 1.0;
-      if (distance < 160.0)
-        multiplier = 1.0 - (distance / 2.0 / 100.0);
-      else
-        multiplier = 0.2;
-      pixel.l *= multiplier;
+      double distance = sqrt((double)squared);
+      table[squared] = 1.0 - (distance / 2.0 / 100.0);
     }
-  }
+    return table;
+  }();
+  return multipliers.data();
+}
 
-  return image;
+/**
+ * Returns a pipeline stage that applies the spotlight of createSpotlight.
+ */
+PixelPipeline::Stage spotlightStage(int centerX, int centerY)
+{
+  return spotlightsStage(std::vector<Spotlight>(1, Spotlight{centerX, centerY}));
+}
+
+/**
+ * Returns a pipeline stage that applies each of the spotlights in turn.
+ *
+ * The squared distance to each center is stepped along the row with integer
+ * arithmetic, using (dx + 1)^2 = dx^2 + 2dx + 1, and looked up in the table
+ * of multipliers, so no square roots are taken per pixel. The results are
+ * exactly the same as computing each distance directly.
+ */
+PixelPipeline::Stage spotlightsStage(std::vector<Spotlight> spotlights)
+{
+  double const *multipliers = spotlightMultipliers();
+  return [spotlights, multipliers](HSLAPixel *pixels, unsigned x, unsigned y, unsigned count)
+  {
+    for (Spotlight const &spotlight : spotlights)
+    {
+      long long dy = (long long)y - spotlight.centerY;
+      long long dx = (long long)x - spotlight.centerX;
+      long long squared = (dx * dx) + (dy * dy);
+      if (dy * dy >= kSpotlightSquaredRadius)
+      {
+        for (unsigned i = 0; i < count; i++)
+          pixels[i].l *= 0.2;
+        continue;
+      }
+
+      for (unsigned i = 0; i < count; i++)
+      {
+        pixels[i].l *= (squared < kSpotlightSquaredRadius) ? multipliers[squared] : 0.2;
+        squared += (2 * dx) + 1;
+        dx++;
+      }
+    }
+  };
 }
 
 /**
@@ -99,29 +195,48 @@ PNG createSpotlight(PNG image, int centerX, int centerY)
  * @return The illinify'd image.
  **/
 
-double findIlliniHue(double hue)
+PNG illinify(PNG image)
 {
-  double orangeDiff = abs(hue - 11.0);
-  double blueDiff = abs(hue - 216.0);
-  if (orangeDiff > 180.0)
-    orangeDiff = 360.0 - orangeDiff;
-  if (blueDiff > 180.0)
-    blueDiff = 360.0 - blueDiff;
-  return (orangeDiff < blueDiff) ? 11.0 : 216.0;
+  illinifyInPlace(image);
+  return image;
 }
 
-PNG illinify(PNG image)
+void illinifyInPlace(PNG &image)
+{
+  PixelPipeline().addStage(illinifyStage()).apply(image);
+}
+
+void illinifyInPlace(PNGView const &view)
+{
+  PixelPipeline().addStage(illinifyStage()).apply(view);
+}
+
+/**
+ * Returns a pipeline stage that snaps every hue to Illini orange or blue.
+ */
+PixelPipeline::Stage illinifyStage()
 {
-  for (unsigned x = 0; x < image.width(); x++)
+  return hueRemapStage(HuePalette::find("illini"));
+}
+
+/**
+ * Returns a pipeline stage that snaps every hue to the nearest hue of
+ * `palette`, looking it up in the palette's table.
+ */
+PixelPipeline::Stage hueRemapStage(std::shared_ptr<HuePalette const> palette)
+{
+  return [palette](HSLAPixel *pixels, unsigned x, unsigned y, unsigned count)
   {
-    for (unsigned y = 0; y < image.height(); y++)
-    {
-      HSLAPixel &pixel = image.getPixel(x, y);
-      double newHue = findIlliniHue(pixel.h);
-      pixel.h = newHue;
-    }
-  }
-  return image;
+    palette->apply(pixels, count);
+  };
+}
+
+/**
+ * Brightens one pixel under an active pixel of a watermark stencil.
+ */
+static void brightenWatermarkPixel(HSLAPixel &pixel)
+{
+  pixel.l = (pixel.l < 0.8) ? pixel.l + 0.2 : 1.0;
 }
 
 /**
@@ -136,19 +251,310 @@ PNG illinify(PNG image)
  *
  * @return The watermarked image.
  */
-PNG watermark(PNG firstImage, PNG secondImage)
+PNG watermark(PNG firstImage, PNG const &secondImage)
+{
+  watermarkInPlace(firstImage, secondImage);
+  return firstImage;
+}
+
+void watermarkInPlace(PNG &firstImage, PNG const &secondImage)
 {
+  if (secondImage.width() <= firstImage.width() && secondImage.height() <= firstImage.height())
+  {
+    // Only pixels under the stencil can change.
+    watermarkInPlace(PNGView(firstImage, 0, 0, secondImage.width(), secondImage.height()), secondImage);
+    return;
+  }
+
+  // A stencil larger than the base image lands on the truncated edge
+  // coordinates of getPixel, so keep the original pixel-by-pixel loop.
   for (unsigned x = 0; x < secondImage.width(); x++)
   {
     for (unsigned y = 0; y < secondImage.height(); y++)
     {
       HSLAPixel &pixel = secondImage.getPixel(x, y);
       if (pixel.l == 1.0)
-      {
-        HSLAPixel &resultPixel = firstImage.getPixel(x, y);
-        resultPixel.l = (resultPixel.l < 0.8) ? resultPixel.l + 0.2 : 1.0;
-      }
+        brightenWatermarkPixel(firstImage.getPixel(x, y));
     }
   }
+}
+
+void watermarkInPlace(PNGView const &view, PNG const &stencil)
+{
+  PixelPipeline().addStage(watermarkStage(stencil)).apply(view);
+  if (view.empty())
+    return;
+
+  // Like getPixel in watermark, parts of the stencil past the edges of the
+  // image land on its last row or column, which may be brightened more than
+  // once. The stage above only covers the stencil within the image, so add
+  // the rest for any of those pixels that are in the view.
+  PNG const &image = *view.image();
+  unsigned lastX = image.width() - 1;
+  unsigned lastY = image.height() - 1;
+  for (unsigned y = 0; y < stencil.height(); y++)
+  {
+    unsigned imageY = std::min(y, lastY);
+    if (imageY < view.y() || imageY >= view.y() + view.height())
+      continue;
+    HSLAPixel const *stencilRow = stencil.row(y);
+    for (unsigned x = (y > lastY) ? 0 : lastX + 1; x < stencil.width(); x++)
+    {
+      unsigned imageX = std::min(x, lastX);
+      if (stencilRow[x].l == 1.0 && imageX >= view.x() && imageX < view.x() + view.width())
+        brightenWatermarkPixel(view.getPixel(imageX - view.x(), imageY - view.y()));
+    }
+  }
+}
+
+/**
+ * Returns a pipeline stage that applies `stencil` as a watermark. Pixels
+ * outside of the stencil are left unchanged.
+ */
+PixelPipeline::Stage watermarkStage(PNG const &stencil)
+{
+  return [&stencil](HSLAPixel *pixels, unsigned x, unsigned y, unsigned count)
+  {
+    if (y >= stencil.height() || x >= stencil.width())
+      return;
+    HSLAPixel const *stencilRow = stencil.row(y) + x;
+    for (unsigned i = 0; i < count && x + i < stencil.width(); i++)
+    {
+      if (stencilRow[i].l == 1.0)
+        brightenWatermarkPixel(pixels[i]);
+    }
+  };
+}
+
+/**
+ * Returns an image that has been watermarked with a precompiled mask, the
+ * same as watermark with the stencil the mask was made from. Only the
+ * mask's active pixels are visited, so this costs in proportion to the
+ * mask's coverage rather than to the size of the image.
+ *
+ * @param firstImage The base image.
+ * @param mask The mask, made once from a stencil and reused for any number
+ *             of images.
+ *
+ * @return The watermarked image.
+ */
+PNG watermark(PNG firstImage, StencilMask const &mask)
+{
+  watermarkInPlace(firstImage, mask);
+  return firstImage;
+}
+
+void watermarkInPlace(PNG &firstImage, StencilMask const &mask)
+{
+  if (firstImage.width() == 0 || firstImage.height() == 0)
+    return;
+
+  // Like getPixel in watermark, parts of the mask past the edges of the base
+  // image land on the last row or column.
+  unsigned lastX = firstImage.width() - 1;
+  unsigned lastY = firstImage.height() - 1;
+  for (unsigned y : mask.activeRows())
+  {
+    HSLAPixel *row = firstImage.row(std::min(y, lastY));
+    for (StencilMask::Run const *run = mask.rowBegin(y); run != mask.rowEnd(y); run++)
+    {
+      for (unsigned x = run->x; x < run->x + run->length; x++)
+        brightenWatermarkPixel(row[std::min(x, lastX)]);
+    }
+  }
+}
+
+/**
+ * Returns a pipeline stage that applies `mask` as a watermark. Pixels
+ * outside of the mask are left unchanged.
+ */
+PixelPipeline::Stage watermarkStage(StencilMask const &mask)
+{
+  return [&mask](HSLAPixel *pixels, unsigned x, unsigned y, unsigned count)
+  {
+    if (y >= mask.height())
+      return;
+    for (StencilMask::Run const *run = mask.rowBegin(y); run != mask.rowEnd(y); run++)
+    {
+      unsigned begin = std::max(run->x, x);
+      unsigned end = std::min(run->x + run->length, x + count);
+      for (unsigned i = begin; i < end; i++)
+        brightenWatermarkPixel(pixels[i - x]);
+    }
+  };
+}
+
+
+// ---------------------------------------------------------------------------
+// Transforms of BasicPNG images. The per-pixel work is the same as above, but
+// luminance and hue are scaled through ChannelTraits, and 16-bit fixed point
+// gets its own integer versions of the spotlight and illinify lookups.
+
+using uiuc::BasicHSLAPixel;
+using uiuc::BasicPNG;
+using uiuc::ChannelTraits;
+
+template <typename Channel>
+BasicPNG<Channel> grayscale(BasicPNG<Channel> image)
+{
+  grayscaleInPlace(image);
+  return image;
+}
+
+template <typename Channel>
+void grayscaleInPlace(BasicPNG<Channel> &image)
+{
+  for (BasicHSLAPixel<Channel> &pixel : image)
+    pixel.s = 0;
+}
+
+/**
+ * Scales the luminance of one row of pixels by the spotlight multiplier of
+ * each pixel's squared distance, stepped along the row as in spotlightsStage.
+ */
+template <typename Channel>
+static void spotlightRow(BasicHSLAPixel<Channel> *pixels, unsigned count, long long dx, long long dy)
+{
+  double const *multipliers = spotlightMultipliers();
+  long long squared = (dx * dx) + (dy * dy);
+  for (unsigned i = 0; i < count; i++)
+  {
+    double multiplier = (squared < kSpotlightSquaredRadius) ? multipliers[squared] : 0.2;
+    pixels[i].l = Channel(pixels[i].l * multiplier);
+    squared += (2 * dx) + 1;
+    dx++;
+  }
+}
+
+/**
+ * The spotlight multipliers as 16-bit fractions, so that fixed-point
+ * luminance is scaled with one integer multiply and shift.
+ */
+static std::uint32_t const *spotlightFixedMultipliers()
+{
+  static std::vector<std::uint32_t> const multipliers = []
+  {
+    double const *source = spotlightMultipliers();
+    std::vector<std::uint32_t> table(kSpotlightSquaredRadius + 1);
+    for (long long squared = 0; squared < kSpotlightSquaredRadius; squared++)
+      table[squared] = std::uint32_t(source[squared] * 65536.0 + 0.5);
+    // Everything outside of the spotlight shares the last entry.
+    table[kSpotlightSquaredRadius] = std::uint32_t(0.2 * 65536.0 + 0.5);
+    return table;
+  }();
+  return multipliers.data();
+}
+
+template <>
+void spotlightRow<std::uint16_t>(BasicHSLAPixel<std::uint16_t> *pixels, unsigned count, long long dx, long long dy)
+{
+  std::uint32_t const *multipliers = spotlightFixedMultipliers();
+  long long squared = (dx * dx) + (dy * dy);
+  for (unsigned i = 0; i < count; i++)
+  {
+    std::uint32_t multiplier = multipliers[std::min(squared, kSpotlightSquaredRadius)];
+    pixels[i].l = std::uint16_t((pixels[i].l * multiplier + 32768) >> 16);
+    squared += (2 * dx) + 1;
+    dx++;
+  }
+}
+
+template <typename Channel>
+BasicPNG<Channel> createSpotlight(BasicPNG<Channel> image, int centerX, int centerY)
+{
+  createSpotlightInPlace(image, centerX, centerY);
+  return image;
+}
+
+template <typename Channel>
+void createSpotlightInPlace(BasicPNG<Channel> &image, int centerX, int centerY)
+{
+  for (unsigned y = 0; y < image.height(); y++)
+    spotlightRow(image.row(y), image.width(), -(long long)centerX, (long long)y - centerY);
+}
+
+template <typename Channel>
+BasicPNG<Channel> illinify(BasicPNG<Channel> image)
+{
+  illinifyInPlace(image);
+  return image;
+}
+
+template <typename Channel>
+void illinifyInPlace(BasicPNG<Channel> &image)
+{
+  typedef ChannelTraits<Channel> Traits;
+  std::shared_ptr<HuePalette const> palette = HuePalette::find("illini");
+  for (BasicHSLAPixel<Channel> &pixel : image)
+    pixel.h = Traits::fromHue(palette->snap(Traits::hue(pixel.h)));
+}
+
+/**
+ * A 16-bit hue has only 65536 values, so illinify snaps it through a table
+ * of all of them, built once.
+ */
+template <>
+void illinifyInPlace<std::uint16_t>(BasicPNG<std::uint16_t> &image)
+{
+  typedef ChannelTraits<std::uint16_t> Traits;
+  static std::vector<std::uint16_t> const table = []
+  {
+    std::shared_ptr<HuePalette const> palette = HuePalette::find("illini");
+    std::vector<std::uint16_t> hues(65536);
+    for (unsigned h = 0; h < hues.size(); h++)
+      hues[h] = Traits::fromHue(palette->snap(Traits::hue(std::uint16_t(h))));
+    return hues;
+  }();
+  for (BasicHSLAPixel<std::uint16_t> &pixel : image)
+    pixel.h = table[pixel.h];
+}
+
+template <typename Channel>
+BasicPNG<Channel> watermark(BasicPNG<Channel> firstImage, BasicPNG<Channel> const &secondImage)
+{
+  watermarkInPlace(firstImage, secondImage);
   return firstImage;
 }
+
+template <typename Channel>
+void watermarkInPlace(BasicPNG<Channel> &firstImage, BasicPNG<Channel> const &secondImage)
+{
+  typedef ChannelTraits<Channel> Traits;
+  if (firstImage.width() == 0 || firstImage.height() == 0)
+    return;
+
+  Channel const full = Traits::fromUnit(1.0);
+  Channel const limit = Traits::fromUnit(0.8);
+  Channel const step = Traits::fromUnit(0.2);
+
+  // As with PNG stencils, parts of the stencil past the edges of the base
+  // image land on the last row or column.
+  unsigned lastX = firstImage.width() - 1;
+  unsigned lastY = firstImage.height() - 1;
+  for (unsigned y = 0; y < secondImage.height(); y++)
+  {
+    BasicHSLAPixel<Channel> const *stencilRow = secondImage.row(y);
+    BasicHSLAPixel<Channel> *row = firstImage.row(std::min(y, lastY));
+    for (unsigned x = 0; x < secondImage.width(); x++)
+    {
+      if (stencilRow[x].l != full)
+        continue;
+      BasicHSLAPixel<Channel> &pixel = row[std::min(x, lastX)];
+      pixel.l = (pixel.l < limit) ? Channel(pixel.l + step) : full;
+    }
+  }
+}
+
+#define INSTANTIATE_TRANSFORMS(Channel) \
+  template BasicPNG<Channel> grayscale(BasicPNG<Channel>); \
+  template BasicPNG<Channel> createSpotlight(BasicPNG<Channel>, int, int); \
+  template BasicPNG<Channel> illinify(BasicPNG<Channel>); \
+  template BasicPNG<Channel> watermark(BasicPNG<Channel>, BasicPNG<Channel> const &); \
+  template void grayscaleInPlace(BasicPNG<Channel> &); \
+  template void createSpotlightInPlace(BasicPNG<Channel> &, int, int); \
+  template void illinifyInPlace(BasicPNG<Channel> &); \
+  template void watermarkInPlace(BasicPNG<Channel> &, BasicPNG<Channel> const &);
+
+INSTANTIATE_TRANSFORMS(double)
+INSTANTIATE_TRANSFORMS(float)
+INSTANTIATE_TRANSFORMS(std::uint16_t)
@@ -1,9 +1,99 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "uiuc/BasicPNG.h"
+#include "uiuc/HuePalette.h"
 #include "uiuc/PNG.h"
+#include "uiuc/PixelPipeline.h"
+#include "uiuc/PNGView.h"
+#include "uiuc/StencilMask.h"
 using namespace uiuc;
 
+// Each transform takes its image by value and returns it by value. Pass an
+// image you no longer need with std::move to transform it without a copy:
+//
+//   result = grayscale(std::move(png));
 PNG grayscale(PNG image);  
 PNG createSpotlight(PNG image, int centerX, int centerY);
 PNG illinify(PNG image);
-PNG watermark(PNG firstImage, PNG secondImage);
+PNG watermark(PNG firstImage, PNG const &secondImage);
+
+// The center of one spotlight, for applying several spotlights in one pass.
+struct Spotlight
+{
+  int centerX, centerY;
+};
+
+// Applies each spotlight in turn, as if createSpotlight were called once per
+// spotlight, but in a single pass over the image.
+PNG createSpotlights(PNG image, std::vector<Spotlight> const &spotlights);
+
+// Watermarks with a mask compiled once from a stencil, StencilMask(stencil),
+// visiting only the mask's active pixels. Use this to apply one stencil to
+// many images.
+PNG watermark(PNG firstImage, StencilMask const &mask);
+
+// In-place variants of the transforms above, which change `image` directly.
+void grayscaleInPlace(PNG &image);
+void createSpotlightInPlace(PNG &image, int centerX, int centerY);
+void createSpotlightsInPlace(PNG &image, std::vector<Spotlight> const &spotlights);
+void illinifyInPlace(PNG &image);
+void watermarkInPlace(PNG &firstImage, PNG const &secondImage);
+void watermarkInPlace(PNG &firstImage, StencilMask const &mask);
+
+// Variants of the in-place transforms that change only the pixels of a view,
+// such as a rectangle that needs redrawing. Pixels in the view come out
+// exactly as transforming the whole image would leave them, even with a
+// stencil larger than the image; the spotlight center and the stencil are
+// in image coordinates, not view coordinates.
+//
+//   PNGView dirty(png, 100, 40, 64, 64);
+//   createSpotlightInPlace(dirty, 450, 150);
+void grayscaleInPlace(PNGView const &view);
+void createSpotlightInPlace(PNGView const &view, int centerX, int centerY);
+void illinifyInPlace(PNGView const &view);
+void watermarkInPlace(PNGView const &view, PNG const &stencil);
+
+// Pipeline stages doing the same per-pixel work as the functions above, so
+// that several transforms can be fused into a single pass over an image:
+//
+//   PixelPipeline pipeline;
+//   pipeline.addStage(grayscaleStage()).addStage(spotlightStage(450, 150));
+//   pipeline.apply(png);
+PixelPipeline::Stage grayscaleStage();
+PixelPipeline::Stage spotlightStage(int centerX, int centerY);
+PixelPipeline::Stage spotlightsStage(std::vector<Spotlight> spotlights);
+PixelPipeline::Stage illinifyStage();
+// Snaps every hue to the nearest hue of a palette, such as one found with
+// HuePalette::find; illinifyStage is this with the "illini" palette.
+PixelPipeline::Stage hueRemapStage(std::shared_ptr<HuePalette const> palette);
+// The stencil or mask is used by reference, so it must outlive the stage.
+PixelPipeline::Stage watermarkStage(PNG const &stencil);
+PixelPipeline::Stage watermarkStage(StencilMask const &mask);
+
+// The same transforms for images with float or 16-bit fixed-point channels
+// (see uiuc/BasicPNG.h), instantiated for double, float and std::uint16_t.
+// Each matches the PNG version to within the precision of the channel type.
+template <typename Channel>
+BasicPNG<Channel> grayscale(BasicPNG<Channel> image);
+template <typename Channel>
+BasicPNG<Channel> createSpotlight(BasicPNG<Channel> image, int centerX, int centerY);
+template <typename Channel>
+BasicPNG<Channel> illinify(BasicPNG<Channel> image);
+template <typename Channel>
+BasicPNG<Channel> watermark(BasicPNG<Channel> firstImage, BasicPNG<Channel> const &secondImage);
+
+template <typename Channel>
+void grayscaleInPlace(BasicPNG<Channel> &image);
+template <typename Channel>
+void createSpotlightInPlace(BasicPNG<Channel> &image, int centerX, int centerY);
+template <typename Channel>
+void illinifyInPlace(BasicPNG<Channel> &image);
+// Fixed-point hues are snapped through a table of all 65536 of them.
+template <>
+void illinifyInPlace<std::uint16_t>(BasicPNG<std::uint16_t> &image);
+template <typename Channel>
+void watermarkInPlace(BasicPNG<Channel> &firstImage, BasicPNG<Channel> const &secondImage);
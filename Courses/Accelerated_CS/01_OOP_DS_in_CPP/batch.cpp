@@ -0,0 +1,379 @@
+/**
+ * @file batch.cpp
+ * Applies a chain of transforms from ImageTransform.h to a batch of PNG
+ * files, decoding, transforming and encoding different images at the same
+ * time on a work-stealing thread pool.
+ *
+ * Usage: ./batch [-j threads] -o outputDir -f filters input...
+ *
+ * Each input is a PNG file, a directory (every .png file in it is used), or
+ * @manifest, a text file listing one PNG file per line. Each image is
+ * written to outputDir under its own file name, so two inputs with the same
+ * file name are an error. threads is from 0 (the default, one per core) to
+ * 1024. Filters are applied in the order given, separated by commas:
+ *
+ *   grayscale            grayscale
+ *   illinify             illinify
+ *   spotlight:X:Y        createSpotlight centered at (X, Y), both integers
+ *   watermark:FILE       watermark with the stencil image FILE
+ *
+ * For example:
+ *
+ *   ./batch -j 8 -o out -f grayscale,spotlight:450:150 photos @more.txt
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "ImageTransform.h"
+#include "uiuc/PNG.h"
+#include "uiuc/PixelPipeline.h"
+#include "uiuc/StencilMask.h"
+#include "uiuc/ThreadPool.h"
+#include "uiuc/WorkStealingPool.h"
+
+using uiuc::PixelPipeline;
+using uiuc::PNG;
+using uiuc::StencilMask;
+using uiuc::ThreadPool;
+using uiuc::WorkStealingPool;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/**
+ * Time spent and work done in one stage, summed over every image.
+ */
+struct StageStats
+{
+  std::atomic<long long> nanoseconds;
+  std::atomic<long long> pixels;
+  std::atomic<long long> bytes;
+  std::atomic<unsigned> images;
+
+  StageStats() : nanoseconds(0), pixels(0), bytes(0), images(0) { }
+
+  void add(Clock::time_point start, long long stagePixels, long long stageBytes)
+  {
+    nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    pixels += stagePixels;
+    bytes += stageBytes;
+    images++;
+  }
+};
+
+static bool isDirectory(std::string const &path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#else
+  return false;
+#endif
+}
+
+static bool endsWith(std::string const &text, std::string const &suffix)
+{
+  return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::string fileName(std::string const &path)
+{
+  std::size_t slash = path.find_last_of('/');
+  return (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+
+/**
+ * The most threads that -j accepts.
+ */
+static unsigned const kMaxThreads = 1024;
+
+/**
+ * Parses the thread count of -j, which must be a whole number from 0 to
+ * kMaxThreads.
+ */
+static bool parseThreads(char const *text, unsigned &threads)
+{
+  char *end = NULL;
+  errno = 0;
+  long value = std::strtol(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || value < 0 || value > (long)kMaxThreads)
+  {
+    std::cerr << "Invalid thread count " << text << " (expected 0 to " << kMaxThreads << ")" << std::endl;
+    return false;
+  }
+  threads = (unsigned)value;
+  return true;
+}
+
+/**
+ * Parses one coordinate of a filter, which must be a whole number that fits
+ * in an int.
+ */
+static bool parseCoordinate(std::string const &text, int &value)
+{
+  char const *start = text.c_str();
+  char *end = NULL;
+  errno = 0;
+  long parsed = std::strtol(start, &end, 10);
+  if (errno != 0 || end == start || *end != '\0' || parsed < INT_MIN || parsed > INT_MAX)
+  {
+    std::cerr << "Invalid coordinate " << text << std::endl;
+    return false;
+  }
+  value = (int)parsed;
+  return true;
+}
+
+static long long fileSize(std::string const &path)
+{
+  std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+  return file ? (long long)file.tellg() : 0;
+}
+
+/**
+ * Adds the PNG files named by one command line input to `files`.
+ */
+static bool addInput(std::string const &input, std::vector<std::string> &files)
+{
+  if (!input.empty() && input[0] == '@')
+  {
+    std::ifstream manifest(input.substr(1).c_str());
+    if (!manifest)
+    {
+      std::cerr << "Cannot read manifest " << input.substr(1) << std::endl;
+      return false;
+    }
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+      if (!line.empty() && line[line.size() - 1] == '\r')
+        line.erase(line.size() - 1);
+      if (!line.empty())
+        files.push_back(line);
+    }
+    return true;
+  }
+
+  if (isDirectory(input))
+  {
+#if defined(__unix__) || defined(__APPLE__)
+    DIR *dir = opendir(input.c_str());
+    if (!dir)
+    {
+      std::cerr << "Cannot read directory " << input << std::endl;
+      return false;
+    }
+    std::vector<std::string> names;
+    while (dirent *entry = readdir(dir))
+    {
+      if (endsWith(entry->d_name, ".png"))
+        names.push_back(input + "/" + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    files.insert(files.end(), names.begin(), names.end());
+#endif
+    return true;
+  }
+
+  files.push_back(input);
+  return true;
+}
+
+/**
+ * Adds the pipeline stage for one filter, such as "spotlight:450:150".
+ * Stencils are loaded and compiled into `masks`, which must outlive the
+ * pipeline.
+ */
+static bool addFilter(std::string const &filter, PixelPipeline &pipeline,
+                      std::vector<std::unique_ptr<StencilMask>> &masks)
+{
+  std::string name = filter.substr(0, filter.find(':'));
+  std::string arguments = (filter.find(':') == std::string::npos) ? "" : filter.substr(filter.find(':') + 1);
+
+  if (name == "grayscale" && arguments.empty())
+  {
+    pipeline.addStage(grayscaleStage());
+  }
+  else if (name == "illinify" && arguments.empty())
+  {
+    pipeline.addStage(illinifyStage());
+  }
+  else if (name == "spotlight" && std::count(arguments.begin(), arguments.end(), ':') == 1)
+  {
+    int centerX, centerY;
+    if (!parseCoordinate(arguments.substr(0, arguments.find(':')), centerX) ||
+        !parseCoordinate(arguments.substr(arguments.find(':') + 1), centerY))
+      return false;
+    pipeline.addStage(spotlightStage(centerX, centerY));
+  }
+  else if (name == "watermark" && !arguments.empty())
+  {
+    PNG stencil;
+    if (!stencil.readFromFile(arguments))
+      return false;
+    masks.emplace_back(new StencilMask(stencil));
+    pipeline.addStage(watermarkStage(*masks.back()));
+  }
+  else
+  {
+    std::cerr << "Unknown filter " << filter << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static void printStage(char const *name, StageStats const &stats)
+{
+  double seconds = stats.nanoseconds / 1e9;
+  std::cout << "  " << name << ": " << stats.images << " images in " << (seconds * 1000) << " ms";
+  if (seconds > 0)
+  {
+    std::cout << ", " << (stats.pixels / 1e6 / seconds) << " Mpixel/s, "
+              << (stats.bytes / 1e6 / seconds) << " MB/s";
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned threads = 0;
+  std::string outputDir;
+  std::string filters;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc)
+    {
+      if (!parseThreads(argv[++i], threads))
+        return 1;
+    }
+    else if (arg == "-o" && i + 1 < argc)
+      outputDir = argv[++i];
+    else if (arg == "-f" && i + 1 < argc)
+      filters = argv[++i];
+    else if (!addInput(arg, files))
+      return 1;
+  }
+
+  if (outputDir.empty() || filters.empty() || files.empty())
+  {
+    std::cerr << "Usage: " << argv[0] << " [-j threads] -o outputDir -f filters input..." << std::endl;
+    return 1;
+  }
+
+  // Every image is written under its own file name, so two inputs with the
+  // same name would overwrite each other. Check before doing any work.
+  std::vector<std::string> outFiles;
+  std::map<std::string, std::string> inputForOutput;
+  for (std::string const &file : files)
+  {
+    std::string outFile = outputDir + "/" + fileName(file);
+    std::map<std::string, std::string>::const_iterator clash = inputForOutput.find(outFile);
+    if (clash != inputForOutput.end())
+    {
+      std::cerr << "Both " << clash->second << " and " << file << " would be written to " << outFile << std::endl;
+      return 1;
+    }
+    inputForOutput[outFile] = file;
+    outFiles.push_back(outFile);
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (!isDirectory(outputDir) && mkdir(outputDir.c_str(), 0755) != 0)
+  {
+    std::cerr << "Cannot create directory " << outputDir << std::endl;
+    return 1;
+  }
+#endif
+
+  // Each image is transformed on the one thread it is on; the pool runs
+  // different images in parallel instead.
+  ThreadPool serial(1);
+  PixelPipeline pipeline(serial);
+  std::vector<std::unique_ptr<StencilMask>> masks;
+  std::size_t start = 0;
+  while (start <= filters.size() && !filters.empty())
+  {
+    std::size_t comma = std::min(filters.find(',', start), filters.size());
+    if (!addFilter(filters.substr(start, comma - start), pipeline, masks))
+      return 1;
+    start = comma + 1;
+  }
+
+  StageStats decodeStats, transformStats, encodeStats;
+  std::atomic<unsigned> failures(0);
+  Clock::time_point batchStart = Clock::now();
+  {
+    WorkStealingPool pool(threads);
+
+    // Every image is a chain of three tasks. Each task submits the next one
+    // to its own worker, which runs it next while the image is in cache;
+    // idle workers steal images that have not been started yet.
+    for (std::size_t i = 0; i < files.size(); i++)
+    {
+      std::string const &file = files[i];
+      std::string const &outFile = outFiles[i];
+      pool.submit([&, file, outFile]
+      {
+        Clock::time_point decodeStart = Clock::now();
+        std::shared_ptr<PNG> image = std::make_shared<PNG>();
+        if (!image->readFromFile(file))
+        {
+          std::cerr << "Failed to read " << file << std::endl;
+          failures++;
+          return;
+        }
+        long long pixels = (long long)image->width() * image->height();
+        decodeStats.add(decodeStart, pixels, fileSize(file));
+
+        pool.submit([&, outFile, image, pixels]
+        {
+          Clock::time_point transformStart = Clock::now();
+          pipeline.apply(*image);
+          transformStats.add(transformStart, pixels, pixels * sizeof(uiuc::HSLAPixel));
+
+          pool.submit([&, outFile, image, pixels]
+          {
+            Clock::time_point encodeStart = Clock::now();
+            if (!image->writeToFile(outFile))
+            {
+              std::cerr << "Failed to write " << outFile << std::endl;
+              failures++;
+              return;
+            }
+            encodeStats.add(encodeStart, pixels, fileSize(outFile));
+          });
+        });
+      });
+    }
+    pool.wait();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+
+  std::cout << "Processed " << encodeStats.images << " of " << files.size() << " images in "
+            << (seconds * 1000) << " ms (" << (encodeStats.images / seconds) << " images/s)" << std::endl;
+  std::cout << "Time per stage, summed over all threads:" << std::endl;
+  printStage("decode", decodeStats);
+  printStage("transform", transformStats);
+  printStage("encode", encodeStats);
+
+  return (failures == 0) ? 0 : 1;
+}
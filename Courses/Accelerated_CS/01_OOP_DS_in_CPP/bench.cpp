@@ -0,0 +1,254 @@
+/**
+ * @file bench.cpp
+ * Benchmarks the image library on synthetic images of several sizes and
+ * prints the results as JSON, so that runs from different builds can be
+ * compared.
+ *
+ * Usage: ./bench [--sizes 1,4,16,64] [--repeat N] [--out results.json]
+ *
+ * Sizes are in megapixels; each image is a square of 1024 * sqrt(size)
+ * pixels on a side. For every size, each operation is run `repeat` times
+ * (3 by default) and the fastest run is reported, along with the memory it
+ * allocated. Allocations are counted by replacing operator new, so memory
+ * that lodepng allocates with malloc is not included.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ImageTransform.h"
+#include "uiuc/BasicPNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "uiuc/PNG.h"
+#include "uiuc/RGB_HSL.h"
+
+using uiuc::HSLAPixel;
+using uiuc::PNG;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Every allocation made through operator new is counted, on any thread.
+static std::atomic<long long> allocatedBytes(0);
+static std::atomic<long long> allocationCount(0);
+
+void *operator new(std::size_t size)
+{
+  allocatedBytes += size;
+  allocationCount++;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+/**
+ * The result of one benchmark.
+ */
+struct Result
+{
+  std::string name;
+  unsigned width, height;
+  double seconds;
+  long long bytes;
+  long long allocations;
+};
+
+/**
+ * Creates a test image with smooth gradients, some noise and partly
+ * transparent areas, so that it compresses about as well as a photo.
+ */
+static PNG createSyntheticImage(unsigned width, unsigned height)
+{
+  PNG png(width, height);
+  unsigned seed = 12345;
+  for (unsigned y = 0; y < height; y++)
+  {
+    HSLAPixel *row = png.row(y);
+    for (unsigned x = 0; x < width; x++)
+    {
+      seed = seed * 1103515245 + 12345;
+      double noise = ((seed >> 16) & 0xff) / 255.0 * 0.05;
+      row[x].h = fmod(360.0 * x / width + 90.0 * y / height, 360.0);
+      row[x].s = 0.3 + 0.6 * y / height;
+      row[x].l = 0.2 + 0.6 * ((x + y) % 512) / 512.0 + noise;
+      row[x].a = ((x / 256 + y / 256) % 4 == 0) ? 0.5 : 1.0;
+    }
+  }
+  return png;
+}
+
+/**
+ * Runs `setup` and then times `run`, `repeat` times, and returns the
+ * fastest run and what it allocated. Only `run` is timed.
+ */
+static Result measure(std::string const &name, PNG const &image, unsigned repeat,
+                      std::function<void()> const &setup, std::function<void()> const &run)
+{
+  Result result = {name, image.width(), image.height(), 0, 0, 0};
+  for (unsigned i = 0; i < repeat; i++)
+  {
+    setup();
+    long long bytesBefore = allocatedBytes;
+    long long allocationsBefore = allocationCount;
+    Clock::time_point start = Clock::now();
+    run();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (i == 0 || seconds < result.seconds)
+    {
+      result.seconds = seconds;
+      result.bytes = allocatedBytes - bytesBefore;
+      result.allocations = allocationCount - allocationsBefore;
+    }
+  }
+  std::cerr << name << " " << image.width() << "x" << image.height() << ": "
+            << (result.seconds * 1000) << " ms" << std::endl;
+  return result;
+}
+
+static void benchmarkSize(double megapixels, unsigned repeat, std::vector<Result> &results)
+{
+  unsigned side = (unsigned)std::lround(1024 * std::sqrt(megapixels));
+  PNG image = createSyntheticImage(side, side);
+  PNG stencil = createSyntheticImage(side / 2, side / 2);
+  std::size_t count = std::size_t(side) * side;
+  std::string fileName = "bench_" + std::to_string(side) + ".png";
+  std::vector<unsigned char> rgba(count * 4);
+  std::vector<HSLAPixel> hsla(count);
+  PNG work, result;
+
+  auto nothing = [] {};
+  auto copyImage = [&] { work = image; };
+
+  results.push_back(measure("writeToFile", image, repeat, nothing, [&] { image.writeToFile(fileName); }));
+  results.push_back(measure("readFromFile", image, repeat, nothing, [&] { work.readFromFile(fileName); }));
+  std::remove(fileName.c_str());
+
+  results.push_back(measure("hsl2rgb", image, repeat, nothing, [&] { uiuc::hsl2rgbBatch(image.data(), rgba.data(), count); }));
+  results.push_back(measure("rgb2hsl", image, repeat, nothing, [&] { uiuc::rgb2hslBatch(rgba.data(), hsla.data(), count); }));
+  std::vector<uiuc::FloatPNG::Pixel> hslaFloat(count);
+  std::vector<uiuc::FixedPNG::Pixel> hslaFixed(count);
+  results.push_back(measure("rgb2hslFloat", image, repeat, nothing, [&] { uiuc::rgbaToPixels(rgba.data(), hslaFloat.data(), count); }));
+  results.push_back(measure("hsl2rgbFloat", image, repeat, nothing, [&] { uiuc::pixelsToRGBA(hslaFloat.data(), rgba.data(), count); }));
+  results.push_back(measure("rgb2hslFixed", image, repeat, nothing, [&] { uiuc::rgbaToPixels(rgba.data(), hslaFixed.data(), count); }));
+  results.push_back(measure("hsl2rgbFixed", image, repeat, nothing, [&] { uiuc::pixelsToRGBA(hslaFixed.data(), rgba.data(), count); }));
+
+  results.push_back(measure("grayscale", image, repeat, copyImage, [&] { result = grayscale(std::move(work)); }));
+  results.push_back(measure("createSpotlight", image, repeat, copyImage, [&] { result = createSpotlight(std::move(work), side / 2, side / 3); }));
+  results.push_back(measure("illinify", image, repeat, copyImage, [&] { result = illinify(std::move(work)); }));
+  results.push_back(measure("watermark", image, repeat, copyImage, [&] { result = watermark(std::move(work), stencil); }));
+
+  volatile std::size_t hash = 0;
+  results.push_back(measure("computeHash", image, repeat, nothing, [&] { hash = image.computeHash(); }));
+  results.push_back(measure("computeContentHash", image, repeat, nothing, [&] { hash = image.computeContentHash(); }));
+}
+
+static std::string toJSON(std::vector<Result> const &results, unsigned repeat)
+{
+  std::ostringstream json;
+  json.precision(6);
+  json << "{\n  \"repeat\": " << repeat << ",\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); i++)
+  {
+    Result const &r = results[i];
+    double megapixels = (double)r.width * r.height / 1e6;
+    json << (i ? "," : "") << "\n    {"
+         << "\"name\": \"" << r.name << "\", "
+         << "\"width\": " << r.width << ", "
+         << "\"height\": " << r.height << ", "
+         << "\"megapixels\": " << megapixels << ", "
+         << "\"seconds\": " << r.seconds << ", "
+         << "\"megapixelsPerSecond\": " << (r.seconds > 0 ? megapixels / r.seconds : 0) << ", "
+         << "\"bytesAllocated\": " << r.bytes << ", "
+         << "\"allocations\": " << r.allocations << "}";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<double> sizes = {1, 4, 16};
+  unsigned repeat = 3;
+  std::string outFile;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--sizes" && i + 1 < argc)
+    {
+      sizes.clear();
+      std::istringstream list(argv[++i]);
+      std::string size;
+      while (std::getline(list, size, ','))
+        sizes.push_back(std::atof(size.c_str()));
+    }
+    else if (arg == "--repeat" && i + 1 < argc)
+    {
+      repeat = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (arg == "--out" && i + 1 < argc)
+    {
+      outFile = argv[++i];
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--sizes 1,4,16,64] [--repeat N] [--out results.json]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Result> results;
+  for (double megapixels : sizes)
+  {
+    if (megapixels > 0)
+      benchmarkSize(megapixels, repeat, results);
+  }
+
+  std::string json = toJSON(results, repeat);
+  if (outFile.empty())
+  {
+    std::cout << json;
+  }
+  else
+  {
+    std::ofstream out(outFile.c_str());
+    out << json;
+  }
+  return 0;
+}
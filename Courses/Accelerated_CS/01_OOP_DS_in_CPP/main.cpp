@@ -6,6 +6,8 @@
  * @author Updated by University of Illinois CS 400 Course Staff
 **/
 
+#include <utility>
+
 #include "ImageTransform.h"
 #include "uiuc/PNG.h"
 
@@ -22,8 +24,9 @@ int main() {
   result = illinify(png);
   result.writeToFile("out-illinify.png");
 
+  // This is the last use of `png`, so it can be moved instead of copied.
   png2.readFromFile("overlay.png");
-  result = watermark(png, png2);
+  result = watermark(std::move(png), png2);
   result.writeToFile("out-watermark.png");
   
   return 0;
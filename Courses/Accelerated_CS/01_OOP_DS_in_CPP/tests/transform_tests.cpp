@@ -0,0 +1,342 @@
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/BasicPNG.h"
+#include "../uiuc/ImageCompare.h"
+#include "../uiuc/PixelPipeline.h"
+#include "../uiuc/PNGView.h"
+#include "../uiuc/RGB_HSL.h"
+#include "../uiuc/ThreadPool.h"
+
+// A file written by a test, which is deleted when the test is done with it,
+// even if the test fails.
+struct TempFile {
+  std::string name;
+  explicit TempFile(std::string const & fileName) : name(fileName) { }
+  ~TempFile() { std::remove(name.c_str()); }
+};
+
+static PNG createTestImage() {
+  PNG png(360, 200);
+  for (unsigned x = 0; x < png.width(); x++) {
+    for (unsigned y = 0; y < png.height(); y++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      pixel.h = x;
+      pixel.s = y / 200.0;
+      pixel.l = 0.3 + (x % 7) / 10.0;
+      pixel.a = 1;
+    }
+  }
+  return png;
+}
+
+static PNG createTestStencil() {
+  PNG png(300, 150);
+  for (unsigned x = 0; x < png.width(); x++) {
+    for (unsigned y = 0; y < png.height(); y++) {
+      png.getPixel(x, y).l = ((x / 10 + y / 10) % 2 == 0) ? 1 : 0;
+    }
+  }
+  return png;
+}
+
+TEST_CASE("A fused pipeline should match applying the transforms one by one", "[weight=0]") {
+  PNG png = createTestImage();
+  PNG stencil = createTestStencil();
+  PNG expected = watermark(illinify(createSpotlight(grayscale(png), 100, 50)), stencil);
+
+  SECTION("On the shared thread pool") {
+    PixelPipeline pipeline;
+    pipeline.addStage(grayscaleStage())
+            .addStage(spotlightStage(100, 50))
+            .addStage(illinifyStage())
+            .addStage(watermarkStage(stencil));
+    REQUIRE( pipeline.stages() == 4 );
+    REQUIRE( pipeline(png) == expected );
+  }
+
+  SECTION("Split over several threads, in place") {
+    ThreadPool pool(4);
+    PixelPipeline pipeline(pool);
+    pipeline.addStage(grayscaleStage())
+            .addStage(spotlightStage(100, 50))
+            .addStage(illinifyStage())
+            .addStage(watermarkStage(stencil));
+    pipeline.apply(png);
+    REQUIRE( png == expected );
+  }
+}
+
+TEST_CASE("In-place transforms should match the by-value transforms", "[weight=0]") {
+  PNG png = createTestImage();
+  PNG stencil = createTestStencil();
+
+  PNG image = png;
+  grayscaleInPlace(image);
+  REQUIRE( image == grayscale(png) );
+
+  image = png;
+  createSpotlightInPlace(image, 20, 180);
+  REQUIRE( image == createSpotlight(png, 20, 180) );
+
+  image = png;
+  illinifyInPlace(image);
+  REQUIRE( image == illinify(png) );
+
+  image = png;
+  watermarkInPlace(image, stencil);
+  REQUIRE( image == watermark(png, stencil) );
+
+  SECTION("Moving an image into a transform reuses its pixels") {
+    PNG source = png;
+    HSLAPixel * pixels = &source.getPixel(0, 0);
+    PNG result = grayscale(std::move(source));
+    REQUIRE( &result.getPixel(0, 0) == pixels );
+  }
+}
+
+TEST_CASE("Spotlights should match the distance formula exactly", "[weight=0]") {
+  PNG png = createTestImage();
+  int centers[][2] = { {100, 50}, {0, 0}, {-40, 500}, {359, 199}, {1000, -1000} };
+  for (auto const & center : centers) {
+    PNG result = createSpotlight(png, center[0], center[1]);
+    PNG expected = png;
+    for (unsigned y = 0; y < png.height(); y++) {
+      for (unsigned x = 0; x < png.width(); x++) {
+        double distance = sqrt(pow((int)x - center[0], 2) + pow((int)y - center[1], 2));
+        double multiplier = (distance < 160.0) ? 1.0 - (distance / 2.0 / 100.0) : 0.2;
+        expected.getPixel(x, y).l *= multiplier;
+      }
+    }
+    REQUIRE( result == expected );
+  }
+
+  SECTION("Several spotlights in one pass match applying them one by one") {
+    std::vector<Spotlight> spotlights = { {100, 50}, {300, 150}, {-20, 210} };
+    PNG expected = createSpotlight(createSpotlight(createSpotlight(png, 100, 50), 300, 150), -20, 210);
+    REQUIRE( createSpotlights(png, spotlights) == expected );
+
+    PNG image = png;
+    createSpotlightsInPlace(image, spotlights);
+    REQUIRE( image == expected );
+    REQUIRE( createSpotlights(png, std::vector<Spotlight>()) == png );
+  }
+}
+
+TEST_CASE("A precompiled stencil mask should watermark like its stencil", "[weight=0]") {
+  PNG png = createTestImage();
+  PNG stencil = createTestStencil();
+  StencilMask mask(stencil);
+  REQUIRE( mask.width() == 300 );
+  REQUIRE( mask.height() == 150 );
+  REQUIRE( mask.coverage() == 300 * 150 / 2 );
+  REQUIRE( mask.rowEnd(0) - mask.rowBegin(0) == 15 );
+  REQUIRE( mask.rowBegin(0)[1].x == 20 );
+  REQUIRE( mask.rowBegin(0)[1].length == 10 );
+
+  REQUIRE( watermark(png, mask) == watermark(png, stencil) );
+  REQUIRE( watermark(grayscale(png), mask) == watermark(grayscale(png), stencil) );
+
+  PNG image = png;
+  PixelPipeline().addStage(watermarkStage(mask)).apply(image);
+  REQUIRE( image == watermark(png, stencil) );
+
+  SECTION("A mask larger than the image lands on its edges") {
+    PNG small = png;
+    small.resize(120, 90);
+    PNG expected = watermark(small, stencil);
+    watermarkInPlace(small, mask);
+    REQUIRE( small == expected );
+  }
+
+  SECTION("An empty mask changes nothing") {
+    PNG blank(40, 40);
+    for (HSLAPixel & pixel : blank) { pixel.l = 0.5; }
+    StencilMask empty(blank);
+    REQUIRE( empty.coverage() == 0 );
+    REQUIRE( empty.activeRows().empty() );
+    REQUIRE( watermark(png, empty) == png );
+    REQUIRE( watermark(png, StencilMask()) == png );
+  }
+}
+
+TEST_CASE("A pipeline run over a file should match running it in memory", "[weight=0]") {
+  PNG stencil = createTestStencil();
+  TempFile in("test_pipeline_in.png"), out("test_pipeline_out.png");
+  REQUIRE( createTestImage().writeToFile(in.name) );
+
+  PixelPipeline pipeline;
+  pipeline.addStage(grayscaleStage())
+          .addStage(spotlightStage(100, 50))
+          .addStage(watermarkStage(stencil));
+  REQUIRE( pipeline.applyToFile(in.name, out.name) );
+
+  PNG png;
+  REQUIRE( png.readFromFile(in.name) );
+  std::vector<unsigned char> encoded;
+  REQUIRE( pipeline(png).writeToMemory(encoded) );
+
+  PNG result, expected;
+  REQUIRE( result.readFromFile(out.name) );
+  REQUIRE( expected.readFromMemory(encoded.data(), encoded.size()) );
+  REQUIRE( result == expected );
+}
+
+TEST_CASE("Float and fixed-point images should match double images", "[weight=0]") {
+  REQUIRE( sizeof(BasicHSLAPixel<double>) == sizeof(HSLAPixel) );
+  REQUIRE( sizeof(FloatPNG::Pixel) == 16 );
+  REQUIRE( sizeof(FixedPNG::Pixel) == 8 );
+
+  PNG png = createTestImage();
+  PNG stencil = createTestStencil();
+  for (HSLAPixel & pixel : stencil) {
+    pixel.h = pixel.s = 0;
+    pixel.a = 1;
+  }
+  TempFile file("test_channels.png");
+  REQUIRE( png.writeToFile(file.name) );
+  PNG legacy;
+  REQUIRE( legacy.readFromFile(file.name) );
+
+  SECTION("Double channels read exactly like PNG") {
+    BasicPNG<double> image;
+    REQUIRE( image.readFromFile(file.name) );
+    REQUIRE( image.toPNG() == legacy );
+    REQUIRE( grayscale(image).toPNG() == grayscale(legacy) );
+    REQUIRE( createSpotlight(image, 100, 50).toPNG() == createSpotlight(legacy, 100, 50) );
+    REQUIRE( illinify(image).toPNG() == illinify(legacy) );
+    REQUIRE( watermark(image, BasicPNG<double>(stencil)).toPNG() == watermark(legacy, stencil) );
+  }
+
+  SECTION("Float channels") {
+    FloatPNG image;
+    REQUIRE( image.readFromFile(file.name) );
+    REQUIRE( image.toPNG().equals(legacy, 1e-5) );
+    TempFile writtenFile("test_channels_float.png");
+    REQUIRE( image.writeToFile(writtenFile.name) );
+    PNG written;
+    REQUIRE( written.readFromFile(writtenFile.name) );
+    REQUIRE( written.equals(legacy, 1.0 / 255) );
+
+    FloatPNG floatStencil(stencil);
+    REQUIRE( grayscale(image).toPNG().equals(grayscale(legacy), 1e-5) );
+    REQUIRE( createSpotlight(image, 100, 50).toPNG().equals(createSpotlight(legacy, 100, 50), 1e-5) );
+    REQUIRE( illinify(image).toPNG().equals(illinify(legacy), 1e-5) );
+    REQUIRE( watermark(image, floatStencil).toPNG().equals(watermark(legacy, stencil), 1e-5) );
+  }
+
+  SECTION("Fixed-point channels") {
+    FixedPNG image;
+    REQUIRE( image.readFromFile(file.name) );
+    REQUIRE( image.toPNG().equals(legacy, 1e-4) );
+    TempFile writtenFile("test_channels_fixed.png");
+    REQUIRE( image.writeToFile(writtenFile.name) );
+    PNG written;
+    REQUIRE( written.readFromFile(writtenFile.name) );
+    REQUIRE( written.equals(legacy, 1.0 / 255) );
+
+    FixedPNG fixedStencil(stencil);
+    REQUIRE( grayscale(image).toPNG().equals(grayscale(legacy), 1e-4) );
+    REQUIRE( createSpotlight(image, 100, 50).toPNG().equals(createSpotlight(legacy, 100, 50), 1e-4) );
+    REQUIRE( illinify(image).toPNG().equals(illinify(legacy), 1e-4) );
+    REQUIRE( watermark(image, fixedStencil).toPNG().equals(watermark(legacy, stencil), 1e-4) );
+  }
+}
+
+TEST_CASE("Fixed-point conversions should match ChannelTraits exactly", "[weight=0]") {
+  typedef uiuc::ChannelTraits<std::uint16_t> Traits;
+  std::vector<unsigned char> rgba;
+  for (unsigned i = 0; i < (1u << 24); i += 4099) {
+    rgba.push_back(i & 0xFF);
+    rgba.push_back((i >> 8) & 0xFF);
+    rgba.push_back((i >> 16) & 0xFF);
+    rgba.push_back((i * 7) & 0xFF);
+  }
+  std::size_t count = rgba.size() / 4;
+
+  std::vector<FixedPNG::Pixel> pixels(count);
+  uiuc::rgbaToPixels(rgba.data(), pixels.data(), count);
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    float hsla[4];
+    uiuc::rgb2hslFloat(&rgba[i * 4], hsla);
+    if (pixels[i].h != Traits::fromHue(hsla[0]) || pixels[i].s != Traits::fromUnit(hsla[1]) ||
+        pixels[i].l != Traits::fromUnit(hsla[2]) || pixels[i].a != Traits::fromUnit(hsla[3])) {
+      mismatches++;
+    }
+  }
+  REQUIRE( mismatches == 0 );
+
+  // Every hue, including the ones just below 360 degrees.
+  for (std::size_t i = 0; i < count; i++) {
+    pixels[i].h = std::uint16_t(i * 4099);
+  }
+  std::vector<unsigned char> back(count * 4);
+  uiuc::pixelsToRGBA(pixels.data(), back.data(), count);
+  mismatches = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    float hsla[] = { float(Traits::hue(pixels[i].h)), float(Traits::unit(pixels[i].s)),
+                     float(Traits::unit(pixels[i].l)), float(Traits::unit(pixels[i].a)) };
+    unsigned char rgb[4];
+    uiuc::hsl2rgbFloat(hsla, rgb);
+    if (rgb[0] != back[i * 4] || rgb[1] != back[(i * 4) + 1] || rgb[2] != back[(i * 4) + 2] || rgb[3] != back[(i * 4) + 3]) {
+      mismatches++;
+    }
+  }
+  REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE("Transforming a view should match transforming the whole image within it", "[weight=0]") {
+  PNG png = createTestImage();
+  PNG stencil = createTestStencil();
+
+  PNG image = png;
+  PNGView dirty(image, 150, 60, 90, 70);
+  createSpotlightInPlace(dirty, 100, 50);
+  illinifyInPlace(dirty);
+  watermarkInPlace(dirty, stencil);
+  grayscaleInPlace(dirty);
+
+  PNG expected = grayscale(watermark(illinify(createSpotlight(png, 100, 50)), stencil));
+  unsigned mismatches = 0;
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      bool inside = x >= 150 && x < 240 && y >= 60 && y < 130;
+      if (!pixelsEqual(&image.getPixel(x, y), &(inside ? expected : png).getPixel(x, y), 1)) { mismatches++; }
+    }
+  }
+  REQUIRE( mismatches == 0 );
+
+  SECTION("Dirty rectangles spread over tiles") {
+    PixelPipeline pipeline;
+    pipeline.addStage(grayscaleStage()).addStage(spotlightStage(100, 50));
+    PNG tiled = png;
+    std::vector<PNGView> views = { PNGView(tiled, 0, 0, 100, 100), PNGView(tiled, 100, 0, 260, 200), PNGView(tiled, 0, 100, 100, 100) };
+    pipeline.apply(views, TileScheduler(30, 20));
+    REQUIRE( tiled == pipeline(png) );
+  }
+
+  SECTION("A stencil larger than the image") {
+    PNG big(png.width() + 5, png.height() + 7);
+    for (unsigned y = 0; y < big.height(); y++) {
+      for (unsigned x = 0; x < big.width(); x++) {
+        big.getPixel(x, y).l = ((x * 7 + y * 3) % 4 == 0) ? 1.0 : 0.5;
+      }
+    }
+    PNG watermarked = png;
+    unsigned halfWidth = png.width() / 2, halfHeight = png.height() / 2;
+    watermarkInPlace(PNGView(watermarked, 0, 0, halfWidth, halfHeight), big);
+    watermarkInPlace(PNGView(watermarked, halfWidth, 0, png.width(), halfHeight), big);
+    watermarkInPlace(PNGView(watermarked, 0, halfHeight, halfWidth, png.height()), big);
+    watermarkInPlace(PNGView(watermarked, halfWidth, halfHeight, png.width(), png.height()), big);
+    REQUIRE( watermarked == watermark(png, big) );
+  }
+}
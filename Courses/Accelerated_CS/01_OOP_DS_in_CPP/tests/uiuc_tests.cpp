@@ -0,0 +1,873 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/HuePalette.h"
+#include "../uiuc/ImageCompare.h"
+#include "../uiuc/ImageHash.h"
+#include "../uiuc/MipPyramid.h"
+#include "../uiuc/PNGStream.h"
+#include "../uiuc/PNGView.h"
+#include "../uiuc/RGB_HSL.h"
+#include "../uiuc/RGBAImage.h"
+#include "../uiuc/ThreadPool.h"
+#include "../uiuc/WorkStealingPool.h"
+
+using uiuc::HSLAPixel;
+using uiuc::PNG;
+using uiuc::RGBAImage;
+
+// A file written by a test, which is deleted when the test is done with it,
+// even if the test fails.
+struct TempFile {
+  std::string name;
+  explicit TempFile(std::string const & fileName) : name(fileName) { }
+  ~TempFile() { std::remove(name.c_str()); }
+};
+
+static std::vector<char> readFileBytes(std::string const & fileName) {
+  std::ifstream file(fileName, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static PNG createGradientPNG() {
+  PNG png(360, 100);
+  for (unsigned x = 0; x < png.width(); x++) {
+    for (unsigned y = 0; y < png.height(); y++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      pixel.h = x;
+      pixel.s = y / 100.0;
+      pixel.l = 0.25 + (y / 200.0);
+      pixel.a = 1.0 - (x / 720.0);
+    }
+  }
+  return png;
+}
+
+TEST_CASE("RGBAImage should load the same pixels as PNG", "[weight=0]") {
+  PNG png;
+  RGBAImage rgba;
+  REQUIRE( png.readFromFile("alma.png") );
+  REQUIRE( rgba.readFromFile("alma.png") );
+
+  REQUIRE( rgba.width() == png.width() );
+  REQUIRE( rgba.height() == png.height() );
+  REQUIRE( rgba.toPNG() == png );
+}
+
+TEST_CASE("RGBAImage should hold the bytes PNG would write", "[weight=0]") {
+  PNG png = createGradientPNG();
+  RGBAImage rgba(png);
+
+  SECTION("Converting back and forth is stable once quantized") {
+    REQUIRE( RGBAImage(rgba.toPNG()) == rgba );
+  }
+
+  SECTION("HSLA access converts a single pixel on demand") {
+    HSLAPixel expected = rgba.toPNG().getPixel(123, 45);
+    HSLAPixel actual = rgba.getPixel(123, 45);
+    REQUIRE( actual.h == expected.h );
+    REQUIRE( actual.s == expected.s );
+    REQUIRE( actual.l == expected.l );
+    REQUIRE( actual.a == expected.a );
+  }
+
+  SECTION("Writing through the pixel proxy stores RGBA bytes") {
+    HSLAPixel white;
+    white.h = 0;
+    white.s = 0;
+    white.l = 1;
+    white.a = 1;
+    rgba.pixel(10, 20) = white;
+
+    uiuc::rgbaColor stored = rgba.getRGBA(10, 20);
+    REQUIRE( stored.r == 255 );
+    REQUIRE( stored.g == 255 );
+    REQUIRE( stored.b == 255 );
+    REQUIRE( stored.a == 255 );
+    REQUIRE( HSLAPixel(rgba.pixel(10, 20)).l == 1 );
+  }
+}
+
+TEST_CASE("rgb2hslBatch should match rgb2hsl bit for bit", "[weight=0]") {
+  std::vector<unsigned char> rgba;
+  for (unsigned i = 0; i < (1u << 24); i += 97) {
+    rgba.push_back(i & 0xFF);
+    rgba.push_back((i >> 8) & 0xFF);
+    rgba.push_back((i >> 16) & 0xFF);
+    rgba.push_back((i * 7) & 0xFF);
+  }
+  std::size_t count = rgba.size() / 4;
+  std::vector<HSLAPixel> batch(count);
+  uiuc::rgb2hslBatch(rgba.data(), batch.data(), count);
+
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    uiuc::rgbaColor rgb = { rgba[i * 4], rgba[(i * 4) + 1], rgba[(i * 4) + 2], rgba[(i * 4) + 3] };
+    uiuc::hslaColor hsl = uiuc::rgb2hsl(rgb);
+    if (hsl.h != batch[i].h || hsl.s != batch[i].s || hsl.l != batch[i].l || hsl.a != batch[i].a) {
+      mismatches++;
+    }
+  }
+  REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE("hsl2rgbBatch should match hsl2rgb byte for byte", "[weight=0]") {
+  PNG png = createGradientPNG();
+  std::vector<HSLAPixel> hsla;
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      hsla.push_back(png.getPixel(x, y));
+    }
+  }
+  // Values outside the usual ranges; the huge hue takes the scalar fallback.
+  HSLAPixel odd = { -90.0, 2.0, 0.5, 1.0 };
+  hsla.push_back(odd);
+  odd.h = 1e300;
+  hsla.push_back(odd);
+
+  std::vector<unsigned char> rgba(hsla.size() * 4);
+  uiuc::hsl2rgbBatch(hsla.data(), rgba.data(), hsla.size());
+
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < hsla.size(); i++) {
+    uiuc::hslaColor hsl = { hsla[i].h, hsla[i].s, hsla[i].l, hsla[i].a };
+    uiuc::rgbaColor rgb = uiuc::hsl2rgb(hsl);
+    if (rgb.r != rgba[i * 4] || rgb.g != rgba[(i * 4) + 1] || rgb.b != rgba[(i * 4) + 2] || rgb.a != rgba[(i * 4) + 3]) {
+      mismatches++;
+    }
+  }
+  REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE("rgb2hslBatchFloat should match rgb2hslFloat bit for bit", "[weight=0]") {
+  std::vector<unsigned char> rgba;
+  for (unsigned i = 0; i < (1u << 24); i += 97) {
+    rgba.push_back(i & 0xFF);
+    rgba.push_back((i >> 8) & 0xFF);
+    rgba.push_back((i >> 16) & 0xFF);
+    rgba.push_back((i * 7) & 0xFF);
+  }
+  std::size_t count = rgba.size() / 4;
+  std::vector<float> batch(count * 4);
+  uiuc::rgb2hslBatchFloat(rgba.data(), batch.data(), count);
+
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    float hsla[4];
+    uiuc::rgb2hslFloat(&rgba[i * 4], hsla);
+    if (hsla[0] != batch[i * 4] || hsla[1] != batch[(i * 4) + 1] || hsla[2] != batch[(i * 4) + 2] || hsla[3] != batch[(i * 4) + 3]) {
+      mismatches++;
+    }
+  }
+  REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE("hsl2rgbBatchFloat should match hsl2rgbFloat byte for byte", "[weight=0]") {
+  PNG png = createGradientPNG();
+  std::vector<float> hsla;
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      float values[] = { float(pixel.h), float(pixel.s), float(pixel.l), float(pixel.a) };
+      hsla.insert(hsla.end(), values, values + 4);
+    }
+  }
+  // Values outside the usual ranges; the huge and NaN hues take the scalar
+  // fallback, and the NaN lightness must still become 0.
+  float odd[] = { -90.0f, 2.0f, 0.5f, 1.0f,
+                  1e30f, 0.5f, 0.5f, 1.0f,
+                  std::nanf(""), 0.5f, 0.5f, 1.0f,
+                  90.0f, 0.5f, std::nanf(""), -1.0f };
+  hsla.insert(hsla.end(), odd, odd + 16);
+
+  std::size_t count = hsla.size() / 4;
+  std::vector<unsigned char> rgba(count * 4);
+  uiuc::hsl2rgbBatchFloat(hsla.data(), rgba.data(), count);
+
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    unsigned char rgb[4];
+    uiuc::hsl2rgbFloat(&hsla[i * 4], rgb);
+    if (rgb[0] != rgba[i * 4] || rgb[1] != rgba[(i * 4) + 1] || rgb[2] != rgba[(i * 4) + 2] || rgb[3] != rgba[(i * 4) + 3]) {
+      mismatches++;
+    }
+  }
+  REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE("ThreadPool::parallelFor should visit every index once", "[weight=0]") {
+  uiuc::ThreadPool pool(4);
+  std::vector<int> visits(1000, 0);
+  pool.parallelFor(0, visits.size(), 7, [&](unsigned begin, unsigned end) {
+    for (unsigned i = begin; i < end; i++) { visits[i]++; }
+  });
+
+  bool allOnce = true;
+  for (int count : visits) { allOnce = allOnce && (count == 1); }
+  REQUIRE( allOnce );
+
+  REQUIRE_THROWS_AS( pool.parallelFor(0, 100, 1, [](unsigned begin, unsigned end) {
+    if (begin == 50) { throw std::runtime_error("chunk failed"); }
+  }), std::runtime_error );
+}
+
+TEST_CASE("WorkStealingPool should run every task, including chained ones", "[weight=0]") {
+  uiuc::WorkStealingPool pool(3);
+  REQUIRE( pool.size() == 3 );
+
+  std::vector<std::atomic<unsigned>> stages(200);
+  for (auto & stage : stages) { stage = 0; }
+  for (unsigned i = 0; i < stages.size(); i++) {
+    pool.submit([&pool, &stages, i] {
+      stages[i]++;
+      pool.submit([&pool, &stages, i] {
+        stages[i]++;
+        pool.submit([&stages, i] { stages[i]++; });
+      });
+    });
+  }
+  pool.wait();
+  for (auto const & stage : stages) {
+    REQUIRE( stage == 3u );
+  }
+
+  SECTION("exceptions are rethrown by wait") {
+    pool.submit([] { throw std::runtime_error("task failed"); });
+    REQUIRE_THROWS_AS( pool.wait(), std::runtime_error );
+    pool.wait();
+  }
+}
+
+TEST_CASE("PNG should support move construction and move assignment", "[weight=0]") {
+  PNG original = createGradientPNG();
+  PNG expected = original;
+  HSLAPixel * pixels = &original.getPixel(0, 0);
+
+  PNG moved(std::move(original));
+  REQUIRE( moved == expected );
+  REQUIRE( &moved.getPixel(0, 0) == pixels );
+  REQUIRE( original.width() == 0 );
+  REQUIRE( original.height() == 0 );
+
+  PNG assigned(10, 10);
+  assigned = std::move(moved);
+  REQUIRE( assigned == expected );
+  REQUIRE( &assigned.getPixel(0, 0) == pixels );
+  REQUIRE( moved.width() == 0 );
+
+  // A moved-from image can be reused.
+  moved = expected;
+  REQUIRE( moved == expected );
+}
+
+TEST_CASE("PNG row, data and iterator access should match getPixel", "[weight=0]") {
+  PNG png = createGradientPNG();
+
+  REQUIRE( png.data() == &png.getPixel(0, 0) );
+  REQUIRE( png.row(37) == &png.getPixel(0, 37) );
+  REQUIRE( png.row(37) + 200 == &png.getPixel(200, 37) );
+  REQUIRE( png.end() - png.begin() == 360 * 100 );
+
+  for (HSLAPixel & pixel : png) { pixel.s = 0.5; }
+  REQUIRE( png.getPixel(359, 99).s == 0.5 );
+
+  SECTION("resize should keep pixels through row copies") {
+    PNG expected = png;
+    png.resize(200, 150);
+    REQUIRE( png.getPixel(199, 99).h == expected.getPixel(199, 99).h );
+    png.resize(360, 100);
+    REQUIRE( png.getPixel(150, 80).l == expected.getPixel(150, 80).l );
+  }
+}
+
+TEST_CASE("PNG equality should find a difference in any pixel and channel", "[weight=0]") {
+  PNG png = createGradientPNG();
+  PNG copy = png;
+  REQUIRE( png == copy );
+
+  unsigned count = png.width() * png.height();
+  unsigned positions[] = { 0, 1, 63, 64, 65, 127, 5000, count - 65, count - 64, count - 1 };
+  for (unsigned position : positions) {
+    for (unsigned channel = 0; channel < 4; channel++) {
+      PNG changed = png;
+      double * values[] = { &changed.data()[position].h, &changed.data()[position].s,
+                            &changed.data()[position].l, &changed.data()[position].a };
+      *values[channel] += 1e-12;
+      REQUIRE( png != changed );
+      REQUIRE( changed.equals(png, 1e-9) );
+      REQUIRE_FALSE( changed.equals(png, 0) );
+    }
+  }
+
+  SECTION("negative zero is equal and NaN is not") {
+    PNG zero(100, 1), negativeZero(100, 1);
+    for (unsigned x = 0; x < 100; x++) {
+      zero.getPixel(x, 0) = HSLAPixel{0, 0, 0, 0};
+      negativeZero.getPixel(x, 0) = HSLAPixel{-0.0, 0, -0.0, 0};
+    }
+    REQUIRE( zero == negativeZero );
+    negativeZero.getPixel(70, 0).l = std::nan("");
+    REQUIRE( zero != negativeZero );
+    REQUIRE_FALSE( zero.equals(negativeZero, 1) );
+  }
+
+  SECTION("hue tolerance wraps around the color wheel") {
+    PNG red = png, alsoRed = png;
+    red.getPixel(100, 50).h = 359.9;
+    alsoRed.getPixel(100, 50).h = 0.1;
+    REQUIRE( red.equals(alsoRed, 0.25 / 360) );
+    REQUIRE_FALSE( red.equals(alsoRed, 0.15 / 360) );
+  }
+}
+
+TEST_CASE("diff should measure how two images differ", "[weight=0]") {
+  PNG png = createGradientPNG();
+  PNG changed = png;
+
+  uiuc::ImageDiff same = uiuc::diff(png, changed);
+  REQUIRE( same.sameSize );
+  REQUIRE( same.changedPixels == 0 );
+  REQUIRE( same.maxAbsDiff == 0 );
+  REQUIRE( std::isinf(same.psnr) );
+
+  changed.getPixel(10, 20).l += 0.5;
+  changed.getPixel(300, 70).s -= 0.25;
+  changed.getPixel(200, 5).h = png.getPixel(200, 5).h + 36;
+  uiuc::ImageDiff result = uiuc::diff(png, changed);
+  REQUIRE( result.changedPixels == 3 );
+  REQUIRE( result.maxAbsDiff == Approx(0.5) );
+  REQUIRE( result.meanSquaredError == Approx((0.25 + 0.0625 + 0.01) / (4.0 * 360 * 100)) );
+  REQUIRE( result.psnr == Approx(10 * std::log10(1 / result.meanSquaredError)) );
+  REQUIRE( result.minX == 10 );
+  REQUIRE( result.minY == 5 );
+  REQUIRE( result.maxX == 300 );
+  REQUIRE( result.maxY == 70 );
+
+  uiuc::ThreadPool pool(3);
+  uiuc::ImageDiff parallel = uiuc::diff(png, changed, pool);
+  REQUIRE( parallel.changedPixels == 3 );
+  REQUIRE( parallel.minY == 5 );
+  REQUIRE( parallel.maxY == 70 );
+
+  PNG smaller = png;
+  smaller.resize(100, 100);
+  REQUIRE_FALSE( uiuc::diff(png, smaller).sameSize );
+}
+
+TEST_CASE("Content hash should be the same however the rows are split", "[weight=0]") {
+  PNG png = createGradientPNG();
+  std::uint64_t hash = png.computeContentHash();
+
+  uiuc::ThreadPool pool(4);
+  REQUIRE( uiuc::contentHash(png, pool) == hash );
+
+  uiuc::ImageHasher hasher(png.width());
+  for (unsigned y = 0; y < png.height(); y++) { hasher.addRow(png.row(y)); }
+  REQUIRE( hasher.digest() == hash );
+
+  REQUIRE( uiuc::contentHash(png, pool, 1) != hash );
+}
+
+TEST_CASE("Content hash should follow image equality", "[weight=0]") {
+  PNG png = createGradientPNG();
+  PNG other = png;
+  REQUIRE( other.computeContentHash() == png.computeContentHash() );
+
+  // -0.0 == 0.0, so they must hash the same.
+  png.getPixel(5, 5).s = 0.0;
+  other.getPixel(5, 5).s = -0.0;
+  REQUIRE( other.computeContentHash() == png.computeContentHash() );
+
+  std::swap(other.getPixel(10, 20), other.getPixel(11, 20));
+  REQUIRE( other.computeContentHash() != png.computeContentHash() );
+
+  PNG transposed(100, 360);
+  REQUIRE( transposed.computeContentHash() != PNG(360, 100).computeContentHash() );
+}
+
+TEST_CASE("PNGStreamWriter output should decode to the same pixels", "[weight=0]") {
+  // Large enough to be compressed in several bands.
+  PNG png(700, 600);
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      pixel.h = (x * 7 + y * 3) % 360;
+      pixel.s = ((x * y) % 101) / 100.0;
+      pixel.l = ((x ^ y) % 97) / 96.0;
+      pixel.a = (x % 5) / 4.0;
+    }
+  }
+
+  TempFile file("test_stream.png");
+  uiuc::PNGStreamWriter writer;
+  REQUIRE( writer.open(file.name, png.width(), png.height()) );
+  for (unsigned y = 0; y < png.height(); y += 50) {
+    REQUIRE( writer.writeRows(png.row(y), 50) );
+  }
+  REQUIRE( writer.close() );
+
+  // Decoded with plain lodepng, not the stream reader.
+  RGBAImage decoded;
+  REQUIRE( decoded.readFromFile(file.name) );
+  REQUIRE( decoded == RGBAImage(png) );
+}
+
+TEST_CASE("PNGStreamWriter output should decode at compression level 0", "[weight=0]") {
+  // 263 rows of 1000 pixels fill the first band exactly, so the final flush
+  // has no data left and must still end the stream.
+  PNG png(1000, 263);
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      pixel.h = (x + y) % 360;
+      pixel.s = 0.5;
+      pixel.l = (x % 11) / 10.0;
+    }
+  }
+
+  TempFile file("test_stream_stored.png");
+  uiuc::PNGWriteOptions options;
+  options.compressionLevel = 0;
+  for (unsigned height : { 263u, 600u }) {
+    png.resize(1000, height);
+    uiuc::PNGStreamWriter writer;
+    REQUIRE( writer.open(file.name, png.width(), png.height(), options) );
+    REQUIRE( writer.writeRows(png.row(0), png.height()) );
+    REQUIRE( writer.close() );
+
+    RGBAImage decoded;
+    REQUIRE( decoded.readFromFile(file.name) );
+    REQUIRE( decoded == RGBAImage(png) );
+  }
+}
+
+TEST_CASE("PNGStreamReader should decode bands of rows in order", "[weight=0]") {
+  TempFile file("test_stream.png");
+  RGBAImage rgba(createGradientPNG());
+  REQUIRE( rgba.writeToFile(file.name) );
+  PNG expected = rgba.toPNG();
+
+  uiuc::PNGStreamReader reader;
+  REQUIRE( reader.open(file.name) );
+  REQUIRE( reader.width() == 360 );
+  REQUIRE( reader.height() == 100 );
+
+  PNG png(reader.width(), reader.height());
+  unsigned nextRow = 0;
+  REQUIRE( reader.read([&](HSLAPixel * pixels, unsigned y, unsigned rows) {
+    REQUIRE( y == nextRow );
+    std::copy(pixels, pixels + rows * 360, png.row(y));
+    nextRow += rows;
+    return true;
+  }) );
+  REQUIRE( nextRow == 100 );
+  REQUIRE( png == expected );
+
+  SECTION("the callback can stop reading") {
+    REQUIRE_FALSE( reader.read([](HSLAPixel *, unsigned, unsigned) { return false; }) );
+  }
+
+  SECTION("palette images are expanded") {
+    // lodepng writes an image with few colors as a palette image.
+    RGBAImage few(64, 64);
+    for (unsigned y = 0; y < 64; y++) {
+      for (unsigned x = 0; x < 64; x++) {
+        uiuc::rgbaColor color = { (unsigned char)(x < 32 ? 255 : 0), 0, (unsigned char)(y < 32 ? 255 : 0), 255 };
+        few.setRGBA(x, y, color);
+      }
+    }
+    REQUIRE( few.writeToFile(file.name) );
+
+    PNG read;
+    REQUIRE( read.readFromFile(file.name) );
+    REQUIRE( read == few.toPNG() );
+  }
+}
+
+TEST_CASE("Parallel PNG writes should decode to the same pixels as serial writes", "[weight=0]") {
+  PNG png(800, 700);
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      pixel.h = (x + y) % 360;
+      pixel.s = 0.8;
+      pixel.l = ((x / 16 + y / 16) % 2) ? 0.3 : 0.6;
+    }
+  }
+  std::vector<unsigned char> encoded;
+  REQUIRE( png.writeToMemory(encoded) );
+  PNG expected;
+  REQUIRE( expected.readFromMemory(encoded.data(), encoded.size()) );
+
+  for (int level = 0; level <= 9; level += 3) {
+    uiuc::PNGWriteOptions options;
+    options.compressionLevel = level;
+    options.threads = 4;
+    REQUIRE( png.writeToMemory(encoded, options) );
+
+    PNG result;
+    REQUIRE( result.readFromMemory(encoded.data(), encoded.size()) );
+    REQUIRE( result == expected );
+  }
+
+  SECTION("on the shared thread pool") {
+    TempFile file("test_parallel.png");
+    uiuc::PNGWriteOptions options;
+    options.threads = 0;
+    REQUIRE( png.writeToFile(file.name, options) );
+
+    RGBAImage result;
+    REQUIRE( result.readFromFile(file.name) );
+    REQUIRE( result.toPNG() == expected );
+  }
+
+  SECTION("with transparent pixels") {
+    png.getPixel(400, 650).a = 0.5;
+    REQUIRE( png.writeToMemory(encoded) );
+    REQUIRE( expected.readFromMemory(encoded.data(), encoded.size()) );
+
+    uiuc::PNGWriteOptions options;
+    options.threads = 3;
+    REQUIRE( png.writeToMemory(encoded, options) );
+
+    PNG result;
+    REQUIRE( result.readFromMemory(encoded.data(), encoded.size()) );
+    REQUIRE( result == expected );
+  }
+}
+
+TEST_CASE("Fast filter selection should write byte-identical files", "[weight=0]") {
+  PNG png = createGradientPNG();
+  png.getPixel(10, 10).a = 0.25;
+  std::vector<unsigned char> plain;
+  REQUIRE( png.writeToMemory(plain) );
+
+  uiuc::PNGWriteOptions options;
+  options.fastFilter = true;
+  std::vector<unsigned char> fast;
+  REQUIRE( png.writeToMemory(fast, options) );
+  REQUIRE( fast == plain );
+}
+
+TEST_CASE("PNG should read and write files in memory", "[weight=0]") {
+  PNG png = createGradientPNG();
+  png.getPixel(10, 10).a = 0.25;
+  TempFile file("test_memory.png");
+  REQUIRE( png.writeToFile(file.name) );
+  PNG expected;
+  REQUIRE( expected.readFromFile(file.name) );
+
+  std::vector<unsigned char> encoded;
+  REQUIRE( png.writeToMemory(encoded) );
+  std::vector<char> fileBytes = readFileBytes(file.name);
+  REQUIRE( std::vector<char>(encoded.begin(), encoded.end()) == fileBytes );
+
+  PNG fromMemory;
+  REQUIRE( fromMemory.readFromMemory(encoded.data(), encoded.size()) );
+  REQUIRE( fromMemory == expected );
+
+  PNG fromMappedFile;
+  REQUIRE( fromMappedFile.readFromMappedFile(file.name) );
+  REQUIRE( fromMappedFile == expected );
+
+  SECTION("images split over several IDAT chunks") {
+    PNG large(800, 700);
+    for (unsigned y = 0; y < large.height(); y++) {
+      for (unsigned x = 0; x < large.width(); x++) {
+        large.getPixel(x, y) = HSLAPixel{double((x * 3 + y) % 360), 0.5, ((x ^ y) % 97) / 96.0, 1};
+      }
+    }
+    uiuc::PNGWriteOptions options;
+    options.threads = 4;
+    REQUIRE( large.writeToMemory(encoded, options) );
+
+    RGBAImage rgba(large);
+    REQUIRE( fromMemory.readFromMemory(encoded.data(), encoded.size()) );
+    REQUIRE( fromMemory == rgba.toPNG() );
+  }
+
+  SECTION("bad data leaves the image unchanged") {
+    encoded.resize(encoded.size() / 2);
+    REQUIRE_FALSE( fromMemory.readFromMemory(encoded.data(), encoded.size()) );
+    REQUIRE_FALSE( fromMemory.readFromMemory(encoded.data(), 10) );
+    REQUIRE_FALSE( fromMemory.readFromMappedFile("test_does_not_exist.png") );
+    REQUIRE( fromMemory == expected );
+  }
+}
+
+TEST_CASE("PNG::resize with a filter should scale the whole image", "[weight=0]") {
+  PNG png = createGradientPNG();
+
+  SECTION("crop mode is the plain resize") {
+    PNG cropped = png;
+    cropped.resize(200, 80);
+    png.resize(200, 80, uiuc::ResizeMode::Crop);
+    REQUIRE( png == cropped );
+  }
+
+  SECTION("a solid color stays the same") {
+    uiuc::ResizeMode modes[] = { uiuc::ResizeMode::Bilinear, uiuc::ResizeMode::Bicubic, uiuc::ResizeMode::Lanczos };
+    for (uiuc::ResizeMode mode : modes) {
+      PNG solid(97, 61);
+      for (HSLAPixel & pixel : solid) { pixel = HSLAPixel{120, 0.5, 0.4, 0.75}; }
+      solid.resize(31, 17, mode);
+      REQUIRE( solid.width() == 31 );
+      REQUIRE( solid.height() == 17 );
+      for (HSLAPixel const & pixel : solid) {
+        REQUIRE( pixel.h == Approx(120) );
+        REQUIRE( pixel.s == Approx(0.5) );
+        REQUIRE( pixel.l == Approx(0.4) );
+        REQUIRE( pixel.a == Approx(0.75) );
+      }
+      solid.resize(120, 90, mode);
+      REQUIRE( solid.getPixel(119, 89).l == Approx(0.4) );
+    }
+  }
+
+  SECTION("halving a checkerboard averages it to gray") {
+    PNG checker(64, 64);
+    for (unsigned y = 0; y < 64; y++) {
+      for (unsigned x = 0; x < 64; x++) {
+        checker.getPixel(x, y) = HSLAPixel{0, 0, double((x + y) % 2), 1};
+      }
+    }
+    checker.resize(32, 32, uiuc::ResizeMode::Bilinear);
+    for (unsigned y = 1; y < 31; y++) {
+      for (unsigned x = 1; x < 31; x++) {
+        REQUIRE( checker.getPixel(x, y).l == Approx(0.5) );
+      }
+    }
+  }
+
+  SECTION("transparent pixels do not bleed color") {
+    PNG half(40, 40);
+    for (unsigned y = 0; y < 40; y++) {
+      for (unsigned x = 0; x < 40; x++) {
+        half.getPixel(x, y) = (x < 20) ? HSLAPixel{0, 1, 0.5, 1} : HSLAPixel{240, 1, 0.5, 0};
+      }
+    }
+    half.resize(15, 15, uiuc::ResizeMode::Lanczos);
+    for (HSLAPixel const & pixel : half) {
+      if (pixel.a > 0.01) {
+        REQUIRE( pixel.h == Approx(0).margin(1e-6) );
+        REQUIRE( pixel.s == Approx(1) );
+      }
+    }
+  }
+}
+
+TEST_CASE("MipPyramid should hold every halved level of an image", "[weight=0]") {
+  PNG png = createGradientPNG();
+  uiuc::MipPyramid pyramid(png);
+
+  unsigned widths[] = { 360, 180, 90, 45, 23, 12, 6, 3, 2, 1 };
+  unsigned heights[] = { 100, 50, 25, 13, 7, 4, 2, 1, 1, 1 };
+  REQUIRE( pyramid.levels() == 10 );
+  for (unsigned n = 0; n < pyramid.levels(); n++) {
+    REQUIRE( pyramid.width(n) == widths[n] );
+    REQUIRE( pyramid.height(n) == heights[n] );
+  }
+  REQUIRE( pyramid.toPNG(0) == png );
+  REQUIRE( pyramid.row(2, 3) == pyramid.level(2) + 3 * 90 );
+
+  REQUIRE( pyramid.levelFor(100, 100) == 2 );
+  REQUIRE( pyramid.levelFor(360, 100) == 0 );
+  REQUIRE( pyramid.levelFor(0, 0) == 9 );
+
+  SECTION("each pixel averages a 2x2 block") {
+    // Blocks of 2x2 pixels in one color, on a transparent background that
+    // must not darken them.
+    PNG blocks(8, 6);
+    for (unsigned y = 0; y < 6; y++) {
+      for (unsigned x = 0; x < 8; x++) {
+        double hue = 30.0 * ((x / 2) + (y / 2) * 4);
+        blocks.getPixel(x, y) = HSLAPixel{hue, 1, 0.5, 1};
+      }
+    }
+    blocks.getPixel(7, 5) = HSLAPixel{0, 0, 0, 0};
+
+    uiuc::MipPyramid blockPyramid(blocks);
+    PNG half = blockPyramid.toPNG(1);
+    REQUIRE( half.width() == 4 );
+    REQUIRE( half.height() == 3 );
+    for (unsigned y = 0; y < 3; y++) {
+      for (unsigned x = 0; x < 4; x++) {
+        REQUIRE( half.getPixel(x, y).h == Approx(30.0 * (x + y * 4)) );
+        REQUIRE( half.getPixel(x, y).l == Approx(0.5) );
+      }
+    }
+    REQUIRE( half.getPixel(3, 2).a == Approx(0.75) );
+    REQUIRE( half.getPixel(2, 2).a == Approx(1) );
+  }
+
+  SECTION("an empty image has no levels") {
+    REQUIRE( uiuc::MipPyramid(PNG()).levels() == 0 );
+    REQUIRE( uiuc::MipPyramid().levels() == 0 );
+  }
+}
+
+// Nearest palette hue, found by checking every hue of the palette in turn.
+static double nearestHue(std::vector<double> const & palette, double hue) {
+  double nearest = palette[0];
+  double nearestDistance = 0;
+  for (std::size_t i = 0; i < palette.size(); i++) {
+    double distance = std::abs(hue - palette[i]);
+    if (distance > 180.0) { distance = 360.0 - distance; }
+    if (i == 0 || !(nearestDistance < distance)) {
+      nearest = palette[i];
+      nearestDistance = distance;
+    }
+  }
+  return nearest;
+}
+
+TEST_CASE("HuePalette should snap hues exactly like comparing distances", "[weight=0]") {
+  std::vector<std::vector<double>> palettes = { { 11, 216 }, { 0, 120, 240 }, { 30, 31, 200.25, 359.5 }, { 300, -20, 500 } };
+  std::vector<double> hues = { 0, 360, 359.9999999, 113.5, 293.5, 191, 36, 15.25, 180, -5, 400, std::nan("") };
+  for (unsigned i = 0; i <= 360000; i++) {
+    hues.push_back(i / 1000.0);
+  }
+
+  for (std::vector<double> const & colors : palettes) {
+    uiuc::HuePalette palette(colors);
+    unsigned mismatches = 0;
+    for (double hue : hues) {
+      if (palette.snap(hue) != nearestHue(colors, hue)) { mismatches++; }
+    }
+    REQUIRE( mismatches == 0 );
+  }
+
+  SECTION("the illini preset is illinify") {
+    std::shared_ptr<uiuc::HuePalette const> illini = uiuc::HuePalette::find("illini");
+    REQUIRE( illini );
+    REQUIRE( illini->hues() == std::vector<double>({ 11, 216 }) );
+    REQUIRE_FALSE( uiuc::HuePalette::find("no such palette") );
+
+    PNG png = createGradientPNG();
+    PNG expected = png;
+    for (HSLAPixel & pixel : expected) { pixel.h = nearestHue({ 11, 216 }, pixel.h); }
+    illini->apply(png.data(), png.width() * png.height());
+    REQUIRE( png == expected );
+  }
+
+  SECTION("palettes are stored by name") {
+    uiuc::HuePalette::define("test palette", { 90 });
+    REQUIRE( uiuc::HuePalette::find("test palette")->snap(300) == 90 );
+    uiuc::HuePalette::define("test palette", { 45, 225 });
+    REQUIRE( uiuc::HuePalette::find("test palette")->snap(300) == 225 );
+    REQUIRE( uiuc::HuePalette({}).snap(123.5) == 123.5 );
+  }
+}
+
+TEST_CASE("PNGView should share pixels with its image and clip to it", "[weight=0]") {
+  PNG png = createGradientPNG();
+
+  uiuc::PNGView whole(png);
+  REQUIRE( whole.width() == 360 );
+  REQUIRE( whole.height() == 100 );
+  REQUIRE( whole.row(7) == png.row(7) );
+
+  uiuc::PNGView view(png, -10, 90, 30, 50);
+  REQUIRE( view.x() == 0 );
+  REQUIRE( view.y() == 90 );
+  REQUIRE( view.width() == 20 );
+  REQUIRE( view.height() == 10 );
+  REQUIRE( &view.getPixel(3, 2) == &png.getPixel(3, 92) );
+  REQUIRE( uiuc::PNGView(png, 400, 0, 10, 10).empty() );
+
+  uiuc::PNGView inner = uiuc::PNGView(png, 100, 20, 50, 50).view(40, 10, 20, 20);
+  REQUIRE( inner.x() == 140 );
+  REQUIRE( inner.y() == 30 );
+  REQUIRE( inner.width() == 10 );
+  REQUIRE( inner.height() == 20 );
+  inner.getPixel(0, 0).l = 0.75;
+  REQUIRE( png.getPixel(140, 30).l == 0.75 );
+
+  PNG copy = inner.toPNG();
+  REQUIRE( copy.width() == 10 );
+  REQUIRE( copy.height() == 20 );
+  for (unsigned y = 0; y < copy.height(); y++) {
+    REQUIRE( uiuc::pixelsEqual(copy.row(y), png.row(30 + y) + 140, 10) );
+  }
+
+  SECTION("a scheduler covers every pixel of every view exactly once") {
+    uiuc::ThreadPool pool(4);
+    uiuc::TileScheduler scheduler(pool, 32, 16);
+    std::vector<uiuc::PNGView> views = { uiuc::PNGView(png, 0, 0, 100, 40), uiuc::PNGView(png, 200, 50, 77, 50) };
+    REQUIRE( scheduler.tiles(views[1]).size() == 3 * 4 );
+
+    PNG counts(png.width(), png.height());
+    for (HSLAPixel & pixel : counts) { pixel.l = 0; }
+    std::vector<uiuc::PNGView> countViews = { uiuc::PNGView(counts, 0, 0, 100, 40), uiuc::PNGView(counts, 200, 50, 77, 50) };
+    scheduler.run(countViews, [](uiuc::PNGView const & tile) {
+      for (unsigned y = 0; y < tile.height(); y++) {
+        for (unsigned x = 0; x < tile.width(); x++) { tile.getPixel(x, y).l += 1; }
+      }
+    });
+
+    unsigned mismatches = 0;
+    for (unsigned y = 0; y < counts.height(); y++) {
+      for (unsigned x = 0; x < counts.width(); x++) {
+        bool inside = (x < 100 && y < 40) || (x >= 200 && x < 277 && y >= 50);
+        if (counts.getPixel(x, y).l != (inside ? 1 : 0)) { mismatches++; }
+      }
+    }
+    REQUIRE( mismatches == 0 );
+  }
+}
+
+// This is hidden because of the [.] tag.
+// You can run it explicitly with: ./test [bench]
+TEST_CASE("Benchmark: PNG encoders", "[weight=0][.][bench]") {
+  constexpr int NUM_TEST_RUNS = 3;
+
+  PNG png(1600, 1200);
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      HSLAPixel & pixel = png.getPixel(x, y);
+      pixel.h = (x / 3 + y / 5) % 360;
+      pixel.s = 0.5 + 0.5 * ((x * y) % 7) / 7.0;
+      pixel.l = 0.2 + 0.6 * ((x + 2 * y) % 31) / 31.0;
+    }
+  }
+
+  auto timeWrite = [&](char const * name, uiuc::PNGWriteOptions const & options) {
+    std::vector<unsigned char> encoded;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NUM_TEST_RUNS; i++) {
+      REQUIRE( png.writeToMemory(encoded, options) );
+    }
+    auto stop_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+    std::cout << name << ": " << dur_ms.count() / NUM_TEST_RUNS << "ms, "
+        << encoded.size() << " bytes" << std::endl;
+    return encoded;
+  };
+
+  std::cout << std::endl << "Encoding a " << png.width() << "x" << png.height() << " image on "
+      << uiuc::ThreadPool::shared().size() << " threads:" << std::endl;
+
+  uiuc::PNGWriteOptions plain;
+  std::vector<unsigned char> plainBytes = timeWrite("Plain lodepng", plain);
+
+  uiuc::PNGWriteOptions fast;
+  fast.fastFilter = true;
+  REQUIRE( timeWrite("SIMD, parallel filter selection", fast) == plainBytes );
+
+  uiuc::PNGWriteOptions parallel;
+  parallel.threads = 0;
+  timeWrite("Parallel filtering and compression", parallel);
+}
@@ -0,0 +1,313 @@
+/**
+ * @file BasicPNG.cpp
+ * Implementation of PNG images with a choice of channel type, instantiated
+ * for double, float and 16-bit fixed point.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+#include "lodepng/lodepng.h"
+#include "BasicPNG.h"
+#include "RGB_HSL.h"
+#include "SIMD.h"
+
+namespace uiuc {
+  // ---------------------------------------------------------------------
+  // Conversions
+
+  // BasicHSLAPixel<double> is laid out exactly like HSLAPixel, so the batch
+  // conversions can work on the pixels in place.
+  static_assert(sizeof(BasicHSLAPixel<double>) == sizeof(HSLAPixel), "BasicHSLAPixel<double> must match HSLAPixel");
+  static_assert(std::is_standard_layout<BasicHSLAPixel<double>>::value && std::is_standard_layout<HSLAPixel>::value,
+                "BasicHSLAPixel<double> must match HSLAPixel");
+
+  template <>
+  void rgbaToPixels<double>(unsigned char const * rgba, BasicHSLAPixel<double> * pixels, std::size_t count) {
+    rgb2hslBatch(rgba, reinterpret_cast<HSLAPixel *>(pixels), count);
+  }
+
+  template <>
+  void pixelsToRGBA<double>(BasicHSLAPixel<double> const * pixels, unsigned char * rgba, std::size_t count) {
+    hsl2rgbBatch(reinterpret_cast<HSLAPixel const *>(pixels), rgba, count);
+  }
+
+  // BasicHSLAPixel<float> is four consecutive floats, which is what the
+  // single-precision batch conversions work on.
+  static_assert(sizeof(BasicHSLAPixel<float>) == 4 * sizeof(float), "BasicHSLAPixel<float> must be four floats");
+  static_assert(std::is_standard_layout<BasicHSLAPixel<float>>::value, "BasicHSLAPixel<float> must be four floats");
+
+  template <>
+  void rgbaToPixels<float>(unsigned char const * rgba, BasicHSLAPixel<float> * pixels, std::size_t count) {
+    rgb2hslBatchFloat(rgba, reinterpret_cast<float *>(pixels), count);
+  }
+
+  template <>
+  void pixelsToRGBA<float>(BasicHSLAPixel<float> const * pixels, unsigned char * rgba, std::size_t count) {
+    hsl2rgbBatchFloat(reinterpret_cast<float const *>(pixels), rgba, count);
+  }
+
+  // Fixed point converts through single precision, a block of pixels at a
+  // time, and scales between the two with the same double arithmetic as
+  // ChannelTraits<std::uint16_t>.
+  static const std::size_t kFixedBlock = 256;
+
+#if UIUC_SSE2
+  // ChannelTraits<std::uint16_t>::fromHue and fromUnit for one pixel. Hues
+  // outside [0, 360], which rgb2hslFloat never produces, and NaN hues go to
+  // fromHue itself.
+  static inline __m128i _fromFloatSSE2(float const * hsla) {
+    const __m128d kHueScale = _mm_set_pd(65535.0, 65536.0 / 360.0);
+    const __m128d kUnitScale = _mm_set1_pd(65535.0);
+    const __m128d kHalf = _mm_set1_pd(0.5);
+    const __m128d kZero = _mm_setzero_pd();
+    const __m128d kHueMax = _mm_set_pd(65535.0, 65536.0);
+    const __m128d kUnitMax = _mm_set1_pd(65535.0);
+
+    if (!(hsla[0] >= 0.0f && hsla[0] <= 360.0f)) {
+      typedef ChannelTraits<std::uint16_t> Traits;
+      return _mm_set_epi32(Traits::fromUnit(hsla[3]), Traits::fromUnit(hsla[2]),
+                           Traits::fromUnit(hsla[1]), Traits::fromHue(hsla[0]));
+    }
+
+    __m128 pixel = _mm_loadu_ps(hsla);
+    __m128d hs = _mm_cvtps_pd(pixel);
+    __m128d la = _mm_cvtps_pd(_mm_movehl_ps(pixel, pixel));
+
+    // Everything is at least 0 here, so truncating rounds down like floor.
+    // _mm_max_pd returns its second operand when the first is NaN, so a NaN
+    // channel becomes 0 as in fromUnit.
+    hs = _mm_add_pd(_mm_mul_pd(hs, kHueScale), kHalf);
+    la = _mm_add_pd(_mm_mul_pd(la, kUnitScale), kHalf);
+    hs = _mm_min_pd(_mm_max_pd(hs, kZero), kHueMax);
+    la = _mm_min_pd(_mm_max_pd(la, kZero), kUnitMax);
+    __m128i values = _mm_unpacklo_epi64(_mm_cvttpd_epi32(hs), _mm_cvttpd_epi32(la));
+    return _mm_and_si128(values, _mm_set1_epi32(0xffff));
+  }
+
+  // Packs two pixels of 32-bit channels from 0 to 65535 into 16 bits each.
+  // SSE2 only packs with signed saturation, so the values are moved into
+  // the signed range and back.
+  static inline __m128i _packFixedSSE2(__m128i first, __m128i second) {
+    const __m128i kBias = _mm_set1_epi32(32768);
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(first, kBias), _mm_sub_epi32(second, kBias));
+    return _mm_xor_si128(packed, _mm_set1_epi16(-32768));
+  }
+
+  // ChannelTraits<std::uint16_t>::hue and unit for one pixel, as floats.
+  static inline __m128 _toFloatSSE2(std::uint16_t const * hsla) {
+    const __m128d kHueScale = _mm_set_pd(1.0 / 65535.0, 360.0 / 65536.0);
+    const __m128d kUnitScale = _mm_set1_pd(1.0 / 65535.0);
+
+    __m128i values = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(hsla)), _mm_setzero_si128());
+    __m128d hs = _mm_mul_pd(_mm_cvtepi32_pd(values), kHueScale);
+    __m128d la = _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(values, values)), kUnitScale);
+    return _mm_movelh_ps(_mm_cvtpd_ps(hs), _mm_cvtpd_ps(la));
+  }
+#endif
+
+  static void _fromFloat(float const * hsla, BasicHSLAPixel<std::uint16_t> * pixels, std::size_t count) {
+    typedef ChannelTraits<std::uint16_t> Traits;
+    std::size_t i = 0;
+#if UIUC_SSE2
+    for (; i + 2 <= count; i += 2) {
+      __m128i packed = _packFixedSSE2(_fromFloatSSE2(hsla + (i * 4)), _fromFloatSSE2(hsla + (i * 4) + 4));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), packed);
+    }
+#endif
+    for (; i < count; i++) {
+      pixels[i].h = Traits::fromHue(hsla[(i * 4)]);
+      pixels[i].s = Traits::fromUnit(hsla[(i * 4) + 1]);
+      pixels[i].l = Traits::fromUnit(hsla[(i * 4) + 2]);
+      pixels[i].a = Traits::fromUnit(hsla[(i * 4) + 3]);
+    }
+  }
+
+  static void _toFloat(BasicHSLAPixel<std::uint16_t> const * pixels, float * hsla, std::size_t count) {
+#if UIUC_SSE2
+    for (std::size_t i = 0; i < count; i++) {
+      _mm_storeu_ps(hsla + (i * 4), _toFloatSSE2(&pixels[i].h));
+    }
+#else
+    typedef ChannelTraits<std::uint16_t> Traits;
+    for (std::size_t i = 0; i < count; i++) {
+      hsla[(i * 4)] = float(Traits::hue(pixels[i].h));
+      hsla[(i * 4) + 1] = float(Traits::unit(pixels[i].s));
+      hsla[(i * 4) + 2] = float(Traits::unit(pixels[i].l));
+      hsla[(i * 4) + 3] = float(Traits::unit(pixels[i].a));
+    }
+#endif
+  }
+
+  template <>
+  void rgbaToPixels<std::uint16_t>(unsigned char const * rgba, BasicHSLAPixel<std::uint16_t> * pixels, std::size_t count) {
+    float hsla[4 * kFixedBlock];
+    for (std::size_t i = 0; i < count; i += kFixedBlock) {
+      std::size_t block = std::min(kFixedBlock, count - i);
+      rgb2hslBatchFloat(rgba + (i * 4), hsla, block);
+      _fromFloat(hsla, pixels + i, block);
+    }
+  }
+
+  template <>
+  void pixelsToRGBA<std::uint16_t>(BasicHSLAPixel<std::uint16_t> const * pixels, unsigned char * rgba, std::size_t count) {
+    float hsla[4 * kFixedBlock];
+    for (std::size_t i = 0; i < count; i += kFixedBlock) {
+      std::size_t block = std::min(kFixedBlock, count - i);
+      _toFloat(pixels + i, hsla, block);
+      hsl2rgbBatchFloat(hsla, rgba + (i * 4), block);
+    }
+  }
+
+  // ---------------------------------------------------------------------
+  // BasicPNG
+
+  template <typename Channel>
+  BasicPNG<Channel>::BasicPNG() : width_(0), height_(0) { }
+
+  template <typename Channel>
+  BasicPNG<Channel>::BasicPNG(unsigned int width, unsigned int height)
+    : width_(width), height_(height), pixels_(std::size_t(width) * height, Pixel()) { }
+
+  template <typename Channel>
+  BasicPNG<Channel>::BasicPNG(PNG const & png)
+    : width_(png.width()), height_(png.height()), pixels_(std::size_t(png.width()) * png.height()) {
+    typedef ChannelTraits<Channel> Traits;
+    HSLAPixel const * source = png.data();
+    for (std::size_t i = 0; i < pixels_.size(); i++) {
+      pixels_[i].h = Traits::fromHue(source[i].h);
+      pixels_[i].s = Traits::fromUnit(source[i].s);
+      pixels_[i].l = Traits::fromUnit(source[i].l);
+      pixels_[i].a = Traits::fromUnit(source[i].a);
+    }
+  }
+
+  template <typename Channel>
+  PNG BasicPNG<Channel>::toPNG() const {
+    typedef ChannelTraits<Channel> Traits;
+    PNG png(width_, height_);
+    HSLAPixel * target = png.data();
+    for (std::size_t i = 0; i < pixels_.size(); i++) {
+      target[i].h = Traits::hue(pixels_[i].h);
+      target[i].s = Traits::unit(pixels_[i].s);
+      target[i].l = Traits::unit(pixels_[i].l);
+      target[i].a = Traits::unit(pixels_[i].a);
+    }
+    return png;
+  }
+
+  template <typename Channel>
+  bool BasicPNG<Channel>::operator==(BasicPNG const & other) const {
+    if (width_ != other.width_ || height_ != other.height_) { return false; }
+    for (std::size_t i = 0; i < pixels_.size(); i++) {
+      Pixel const & p1 = pixels_[i];
+      Pixel const & p2 = other.pixels_[i];
+      if (p1.h != p2.h || p1.s != p2.s || p1.l != p2.l || p1.a != p2.a) { return false; }
+    }
+    return true;
+  }
+
+  template <typename Channel>
+  bool BasicPNG<Channel>::operator!=(BasicPNG const & other) const {
+    return !(*this == other);
+  }
+
+  template <typename Channel>
+  bool BasicPNG<Channel>::readFromFile(std::string const & fileName) {
+    std::vector<unsigned char> bytes;
+    unsigned width, height;
+    unsigned error = lodepng::decode(bytes, width, height, fileName);
+    if (error) {
+      std::cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+      return false;
+    }
+
+    std::vector<Pixel> pixels(std::size_t(width) * height);
+    rgbaToPixels(bytes.data(), pixels.data(), pixels.size());
+    width_ = width;
+    height_ = height;
+    pixels_.swap(pixels);
+    return true;
+  }
+
+  template <typename Channel>
+  bool BasicPNG<Channel>::writeToFile(std::string const & fileName) const {
+    std::vector<unsigned char> bytes(pixels_.size() * 4);
+    pixelsToRGBA(pixels_.data(), bytes.data(), pixels_.size());
+    unsigned error = lodepng::encode(fileName, bytes, width_, height_);
+    if (error) {
+      std::cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << std::endl;
+    }
+    return (error == 0);
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::Pixel & BasicPNG<Channel>::getPixel(unsigned int x, unsigned int y) {
+    assert(x < width_ && y < height_);
+    return pixels_[x + std::size_t(y) * width_];
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::Pixel const & BasicPNG<Channel>::getPixel(unsigned int x, unsigned int y) const {
+    assert(x < width_ && y < height_);
+    return pixels_[x + std::size_t(y) * width_];
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::Pixel * BasicPNG<Channel>::row(unsigned int y) {
+    assert(y < height_);
+    return pixels_.data() + std::size_t(y) * width_;
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::Pixel const * BasicPNG<Channel>::row(unsigned int y) const {
+    assert(y < height_);
+    return pixels_.data() + std::size_t(y) * width_;
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::Pixel * BasicPNG<Channel>::data() {
+    return pixels_.empty() ? 0 : pixels_.data();
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::Pixel const * BasicPNG<Channel>::data() const {
+    return pixels_.empty() ? 0 : pixels_.data();
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::iterator BasicPNG<Channel>::begin() {
+    return pixels_.data();
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::iterator BasicPNG<Channel>::end() {
+    return pixels_.data() + pixels_.size();
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::const_iterator BasicPNG<Channel>::begin() const {
+    return pixels_.data();
+  }
+
+  template <typename Channel>
+  typename BasicPNG<Channel>::const_iterator BasicPNG<Channel>::end() const {
+    return pixels_.data() + pixels_.size();
+  }
+
+  template <typename Channel>
+  unsigned int BasicPNG<Channel>::width() const {
+    return width_;
+  }
+
+  template <typename Channel>
+  unsigned int BasicPNG<Channel>::height() const {
+    return height_;
+  }
+
+  template class BasicPNG<double>;
+  template class BasicPNG<float>;
+  template class BasicPNG<std::uint16_t>;
+}
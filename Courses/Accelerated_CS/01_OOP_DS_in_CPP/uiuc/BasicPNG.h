@@ -0,0 +1,179 @@
+/**
+ * @file BasicPNG.h
+ * PNG images whose pixel channels are a compile-time choice: `double` (the
+ * same precision as PNG and HSLAPixel), `float`, or 16-bit fixed point
+ * (`std::uint16_t`).
+ *
+ * Output is 8-bit anyway, so `float` pixels (16 bytes) and fixed-point
+ * pixels (8 bytes) lose nothing visible next to `double` pixels (32 bytes),
+ * while moving a half or a quarter of the memory and fitting two or four
+ * times as many channels in a SIMD register.
+ *
+ * Fixed-point channels store saturation, luminance and alpha as multiples
+ * of 1/65535, and hue as a multiple of 360/65536 degrees, so that hue wraps
+ * around the color wheel exactly as the integer wraps around.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+
+namespace uiuc {
+  /**
+   * How channel values of a given type map to hue in degrees and to the
+   * other channels in [0, 1].
+   */
+  template <typename Channel>
+  struct ChannelTraits {
+    static double hue(Channel h) { return h; }
+    static double unit(Channel v) { return v; }
+    static Channel fromHue(double h) { return Channel(h); }
+    static Channel fromUnit(double v) { return Channel(v); }
+  };
+
+  template <>
+  struct ChannelTraits<std::uint16_t> {
+    static double hue(std::uint16_t h) { return h * (360.0 / 65536.0); }
+    static double unit(std::uint16_t v) { return v * (1.0 / 65535.0); }
+
+    static std::uint16_t fromHue(double h) {
+      h = std::fmod(h, 360.0);
+      if (h < 0) { h += 360.0; }
+      return std::uint16_t(long(std::floor(h * (65536.0 / 360.0) + 0.5)) & 0xffff);
+    }
+
+    static std::uint16_t fromUnit(double v) {
+      if (!(v > 0.0)) { return 0; }
+      if (v >= 1.0) { return 65535; }
+      return std::uint16_t(v * 65535.0 + 0.5);
+    }
+  };
+
+  /**
+   * A pixel with channels of type `Channel`, laid out like HSLAPixel.
+   */
+  template <typename Channel>
+  class BasicHSLAPixel {
+  public:
+    Channel h, s, l, a;
+  };
+
+  template <typename Channel>
+  class BasicPNG {
+  public:
+    typedef BasicHSLAPixel<Channel> Pixel;
+    typedef Pixel * iterator;
+    typedef Pixel const * const_iterator;
+
+    /**
+      * Creates an empty image.
+      */
+    BasicPNG();
+
+    /**
+      * Creates an image of the specified dimensions, with every channel of
+      * every pixel 0.
+      * @param width Width of the new image.
+      * @param height Height of the new image.
+      */
+    BasicPNG(unsigned int width, unsigned int height);
+
+    /**
+      * Creates an image with the pixels of a PNG, narrowed to `Channel`.
+      * @param png Image to be converted.
+      */
+    explicit BasicPNG(PNG const & png);
+
+    /**
+      * Converts the image to a PNG with `double` channels.
+      */
+    PNG toPNG() const;
+
+    /**
+      * Checks if two images are the same size and have equal pixels.
+      */
+    bool operator== (BasicPNG const & other) const;
+    bool operator!= (BasicPNG const & other) const;
+
+    /**
+      * Reads in a PNG image from a file, converting its RGBA bytes straight
+      * to `Channel`. Overwrites any current image content.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromFile(std::string const & fileName);
+
+    /**
+      * Writes the image to a file, converting straight from `Channel` to
+      * RGBA bytes.
+      * @param fileName Name of the file to be written.
+      * @return true, if the image was successfully written.
+      */
+    bool writeToFile(std::string const & fileName) const;
+
+    /**
+      * Gets the pixel at the given coordinates, which must be in the image.
+      */
+    Pixel & getPixel(unsigned int x, unsigned int y);
+    Pixel const & getPixel(unsigned int x, unsigned int y) const;
+
+    /**
+      * Gets the pixels of one row of the image, as PNG::row does.
+      */
+    Pixel * row(unsigned int y);
+    Pixel const * row(unsigned int y) const;
+
+    /**
+      * Gets all width() * height() pixels of the image in row-major order.
+      */
+    Pixel * data();
+    Pixel const * data() const;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    unsigned int width() const;
+    unsigned int height() const;
+
+  private:
+    unsigned int width_;            /*< Width of the image */
+    unsigned int height_;           /*< Height of the image */
+    std::vector<Pixel> pixels_;     /*< Pixels of the image, in row-major order */
+  };
+
+  typedef BasicPNG<float> FloatPNG;
+  typedef BasicPNG<std::uint16_t> FixedPNG;
+
+  /**
+   * Converts `count` pixels of interleaved RGBA bytes to pixels with
+   * `Channel` channels, and back. For `double` these are rgb2hslBatch and
+   * hsl2rgbBatch, and for `float` rgb2hslBatchFloat and hsl2rgbBatchFloat.
+   * Fixed point converts through the single-precision batches.
+   */
+  template <typename Channel>
+  void rgbaToPixels(unsigned char const * rgba, BasicHSLAPixel<Channel> * pixels, std::size_t count);
+
+  template <typename Channel>
+  void pixelsToRGBA(BasicHSLAPixel<Channel> const * pixels, unsigned char * rgba, std::size_t count);
+
+  // The conversions only exist for these channel types, defined in
+  // BasicPNG.cpp.
+  template <> void rgbaToPixels<double>(unsigned char const * rgba, BasicHSLAPixel<double> * pixels, std::size_t count);
+  template <> void rgbaToPixels<float>(unsigned char const * rgba, BasicHSLAPixel<float> * pixels, std::size_t count);
+  template <> void rgbaToPixels<std::uint16_t>(unsigned char const * rgba, BasicHSLAPixel<std::uint16_t> * pixels, std::size_t count);
+  template <> void pixelsToRGBA<double>(BasicHSLAPixel<double> const * pixels, unsigned char * rgba, std::size_t count);
+  template <> void pixelsToRGBA<float>(BasicHSLAPixel<float> const * pixels, unsigned char * rgba, std::size_t count);
+  template <> void pixelsToRGBA<std::uint16_t>(BasicHSLAPixel<std::uint16_t> const * pixels, unsigned char * rgba, std::size_t count);
+
+  extern template class BasicPNG<double>;
+  extern template class BasicPNG<float>;
+  extern template class BasicPNG<std::uint16_t>;
+}
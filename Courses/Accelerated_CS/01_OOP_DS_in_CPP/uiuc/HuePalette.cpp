@@ -0,0 +1,132 @@
+/**
+ * @file HuePalette.cpp
+ * Implementation of table-driven hue palette snapping.
+ */
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include "HuePalette.h"
+
+namespace uiuc {
+  // The hue circle is split into this many buckets of equal width.
+  static const unsigned kBuckets = 4096;
+  static const double kBucketsPerDegree = kBuckets / 360.0;
+
+  // Buckets within this many degrees of a point where the nearest palette
+  // hue changes are computed directly. It is far larger than the rounding
+  // error of finding a hue's bucket.
+  static const double kMargin = 1e-6;
+
+  // Marks a bucket of table_ that has no single answer.
+  static const double kExact = -1.0;
+
+  HuePalette::HuePalette(std::vector<double> hues) : hues_(hues) {
+    if (hues_.size() < 2) { return; }
+
+    // The nearest palette hue only changes at the points halfway between two
+    // palette hues, or opposite them on the wheel, and where the distance to
+    // a palette hue wraps around, opposite it.
+    std::vector<double> edges;
+    for (std::size_t i = 0; i < hues_.size(); i++) {
+      edges.push_back(std::fmod(hues_[i] + 180.0, 360.0));
+      for (std::size_t j = i + 1; j < hues_.size(); j++) {
+        double middle = (hues_[i] + hues_[j]) / 2.0;
+        edges.push_back(std::fmod(middle, 360.0));
+        edges.push_back(std::fmod(middle + 180.0, 360.0));
+      }
+    }
+
+    table_.resize(kBuckets);
+    for (unsigned b = 0; b < kBuckets; b++) {
+      double lo = b / kBucketsPerDegree;
+      double hi = (b + 1) / kBucketsPerDegree;
+      bool split = false;
+      for (double edge : edges) {
+        if (edge < 0) { edge += 360.0; }
+        // Check the edge and its neighbours around the wheel.
+        for (double e = edge - 360.0; e <= edge + 360.0; e += 360.0) {
+          if (e >= lo - kMargin && e <= hi + kMargin) { split = true; }
+        }
+      }
+      table_[b] = split ? kExact : _nearest((lo + hi) / 2.0);
+    }
+  }
+
+  std::vector<double> const & HuePalette::hues() const {
+    return hues_;
+  }
+
+  double HuePalette::_nearest(double hue) const {
+    if (hues_.empty()) { return hue; }
+
+    double nearest = 0.0;
+    double nearestDistance = 0.0;
+    for (std::size_t i = 0; i < hues_.size(); i++) {
+      double distance = std::fabs(hue - hues_[i]);
+      if (distance > 180.0) { distance = 360.0 - distance; }
+      // Written as "not closer" so that ties, and NaN, go to the later hue.
+      if (i == 0 || !(nearestDistance < distance)) {
+        nearest = hues_[i];
+        nearestDistance = distance;
+      }
+    }
+    return nearest;
+  }
+
+  double HuePalette::snap(double hue) const {
+    if (table_.empty()) { return hues_.empty() ? hue : hues_[0]; }
+
+    // Written so that NaN fails the range check too.
+    if (hue >= 0.0 && hue < 360.0) {
+      double snapped = table_[unsigned(hue * kBucketsPerDegree)];
+      if (snapped != kExact) { return snapped; }
+    }
+    return _nearest(hue);
+  }
+
+  void HuePalette::apply(HSLAPixel * pixels, std::size_t count) const {
+    if (table_.empty()) {
+      if (hues_.empty()) { return; }
+      for (std::size_t i = 0; i < count; i++) { pixels[i].h = hues_[0]; }
+      return;
+    }
+
+    double const * table = table_.data();
+    for (std::size_t i = 0; i < count; i++) {
+      double hue = pixels[i].h;
+      double snapped = kExact;
+      if (hue >= 0.0 && hue < 360.0) {
+        snapped = table[unsigned(hue * kBucketsPerDegree)];
+      }
+      pixels[i].h = (snapped != kExact) ? snapped : _nearest(hue);
+    }
+  }
+
+  // Palettes stored by name, guarded by a mutex so that any thread may look
+  // them up.
+  static std::mutex & _paletteMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::map<std::string, std::shared_ptr<HuePalette const>> & _palettes() {
+    static std::map<std::string, std::shared_ptr<HuePalette const>> palettes = {
+      { "illini", std::make_shared<HuePalette const>(std::vector<double>{ 11.0, 216.0 }) }
+    };
+    return palettes;
+  }
+
+  std::shared_ptr<HuePalette const> HuePalette::define(std::string const & id, std::vector<double> hues) {
+    std::shared_ptr<HuePalette const> palette = std::make_shared<HuePalette const>(hues);
+    std::lock_guard<std::mutex> lock(_paletteMutex());
+    _palettes()[id] = palette;
+    return palette;
+  }
+
+  std::shared_ptr<HuePalette const> HuePalette::find(std::string const & id) {
+    std::lock_guard<std::mutex> lock(_paletteMutex());
+    auto found = _palettes().find(id);
+    return (found != _palettes().end()) ? found->second : std::shared_ptr<HuePalette const>();
+  }
+}
@@ -0,0 +1,74 @@
+/**
+ * @file HuePalette.h
+ * Snapping the hue of every pixel to the nearest hue of a palette, as
+ * illinify does with Illini orange and blue, through a precomputed table.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+
+namespace uiuc {
+  class HuePalette {
+  public:
+    /**
+      * Compiles a palette into a table of hues. Hues are compared around the
+      * color wheel, so 350 is 20 degrees away from 10. A hue the same
+      * distance from two palette hues snaps to the later one.
+      * @param hues The hues of the palette, in degrees. An empty palette
+      *             leaves hues unchanged.
+      */
+    explicit HuePalette(std::vector<double> hues);
+
+    /**
+      * Gets the hues of the palette.
+      */
+    std::vector<double> const & hues() const;
+
+    /**
+      * Gets the palette hue nearest to `hue`. Hues in [0, 360) are looked up
+      * in the table; the few that fall right next to the point halfway
+      * between two palette hues, and any hue out of range, are compared
+      * against each palette hue directly, so the result is always exact.
+      * @param hue The hue to snap, in degrees.
+      * @return The nearest palette hue.
+      */
+    double snap(double hue) const;
+
+    /**
+      * Snaps the hue of `count` consecutive pixels in place.
+      */
+    void apply(HSLAPixel * pixels, std::size_t count) const;
+
+    /**
+      * Compiles a palette and stores it under `id`, replacing any palette
+      * already stored under that name.
+      * @param id Name to store the palette under.
+      * @param hues The hues of the palette.
+      * @return The compiled palette.
+      */
+    static std::shared_ptr<HuePalette const> define(std::string const & id, std::vector<double> hues);
+
+    /**
+      * Gets a palette stored with define, or one of the presets: "illini"
+      * (orange 11 and blue 216, as used by illinify). Palettes are compiled
+      * once and shared, so this is cheap to call for every image.
+      * @param id Name of the palette.
+      * @return The palette, or NULL if there is none by that name.
+      */
+    static std::shared_ptr<HuePalette const> find(std::string const & id);
+
+  private:
+    std::vector<double> hues_;          /*< Hues of the palette */
+    std::vector<double> table_;         /*< Palette hue of each bucket of hues, or -1 if it must be computed */
+
+    /**
+     * Finds the nearest palette hue by comparing against each one.
+     */
+    double _nearest(double hue) const;
+  };
+}
@@ -0,0 +1,152 @@
+/**
+ * @file ImageCompare.cpp
+ * Implementation of vectorized image comparison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include "ImageCompare.h"
+#include "SIMD.h"
+
+namespace uiuc {
+  // Pixels compared between checks for a difference.
+  static const std::size_t kBlock = 64;
+
+  ImageDiff::ImageDiff()
+    : sameSize(false), changedPixels(0), maxAbsDiff(0), meanSquaredError(0),
+      psnr(std::numeric_limits<double>::infinity()), minX(1), minY(1), maxX(0), maxY(0) { }
+
+  // Difference of two hues the shorter way around, on a scale of 0 to 1.
+  static inline double _hueDiff(double h1, double h2) {
+    double d = std::fabs(h1 - h2);
+    return std::min(d, 360.0 - d) / 360.0;
+  }
+
+  static inline bool _pixelEqual(HSLAPixel const & p1, HSLAPixel const & p2) {
+    return p1.h == p2.h && p1.s == p2.s && p1.l == p2.l && p1.a == p2.a;
+  }
+
+  bool pixelsEqual(HSLAPixel const * first, HSLAPixel const * second, std::size_t count) {
+    std::size_t i = 0;
+#if UIUC_SSE2
+    for (; i + kBlock <= count; i += kBlock) {
+      // All ones while every channel so far is equal; NaN never is.
+      __m128d equal = _mm_cmpeq_pd(_mm_setzero_pd(), _mm_setzero_pd());
+      for (std::size_t j = i; j < i + kBlock; j++) {
+        equal = _mm_and_pd(equal, _mm_cmpeq_pd(_mm_loadu_pd(&first[j].h), _mm_loadu_pd(&second[j].h)));
+        equal = _mm_and_pd(equal, _mm_cmpeq_pd(_mm_loadu_pd(&first[j].l), _mm_loadu_pd(&second[j].l)));
+      }
+      if (_mm_movemask_pd(equal) != 0x3) { return false; }
+    }
+#endif
+    for (; i < count; i++) {
+      if (!_pixelEqual(first[i], second[i])) { return false; }
+    }
+    return true;
+  }
+
+  bool pixelsNearlyEqual(HSLAPixel const * first, HSLAPixel const * second, std::size_t count,
+                         double tolerance) {
+    std::size_t i = 0;
+#if UIUC_SSE2
+    const __m128d kAbs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d kHueScale = _mm_set_pd(1.0, 1.0 / 360.0);
+    const __m128d kHueWrap = _mm_set_pd(std::numeric_limits<double>::infinity(), 360.0);
+    const __m128d kTolerance = _mm_set1_pd(tolerance);
+    for (; i + kBlock <= count; i += kBlock) {
+      __m128d within = _mm_cmpeq_pd(_mm_setzero_pd(), _mm_setzero_pd());
+      for (std::size_t j = i; j < i + kBlock; j++) {
+        // (h, s): the hue difference wraps around; the saturation one does
+        // not, since 360 is replaced by infinity in its lane.
+        __m128d hs = _mm_and_pd(kAbs, _mm_sub_pd(_mm_loadu_pd(&first[j].h), _mm_loadu_pd(&second[j].h)));
+        hs = _mm_mul_pd(_mm_min_pd(hs, _mm_sub_pd(kHueWrap, hs)), kHueScale);
+        __m128d la = _mm_and_pd(kAbs, _mm_sub_pd(_mm_loadu_pd(&first[j].l), _mm_loadu_pd(&second[j].l)));
+        within = _mm_and_pd(within, _mm_cmple_pd(hs, kTolerance));
+        within = _mm_and_pd(within, _mm_cmple_pd(la, kTolerance));
+      }
+      if (_mm_movemask_pd(within) != 0x3) { return false; }
+    }
+#endif
+    for (; i < count; i++) {
+      HSLAPixel const & p1 = first[i];
+      HSLAPixel const & p2 = second[i];
+      if (!(_hueDiff(p1.h, p2.h) <= tolerance && std::fabs(p1.s - p2.s) <= tolerance &&
+            std::fabs(p1.l - p2.l) <= tolerance && std::fabs(p1.a - p2.a) <= tolerance)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  ImageDiff diff(PNG const & first, PNG const & second, ThreadPool & pool) {
+    ImageDiff result;
+    if (first.width() != second.width() || first.height() != second.height()) { return result; }
+    result.sameSize = true;
+
+    unsigned width = first.width();
+    unsigned height = first.height();
+    if (width == 0 || height == 0) { return result; }
+
+    double sumSquared = 0;
+    std::mutex mutex;
+    pool.parallelFor(0, height, ThreadPool::rowsPerChunk(width), [&](unsigned y0, unsigned y1) {
+      ImageDiff chunk;
+      double chunkSquared = 0;
+      for (unsigned y = y0; y < y1; y++) {
+        HSLAPixel const * row1 = first.row(y);
+        HSLAPixel const * row2 = second.row(y);
+
+        // Most rows of a regression check are equal; skip them at full speed.
+        if (pixelsEqual(row1, row2, width)) { continue; }
+
+        for (unsigned x = 0; x < width; x++) {
+          HSLAPixel const & p1 = row1[x];
+          HSLAPixel const & p2 = row2[x];
+          if (_pixelEqual(p1, p2)) { continue; }
+
+          double dh = _hueDiff(p1.h, p2.h);
+          double ds = std::fabs(p1.s - p2.s);
+          double dl = std::fabs(p1.l - p2.l);
+          double da = std::fabs(p1.a - p2.a);
+          chunk.maxAbsDiff = std::max(std::max(chunk.maxAbsDiff, dh), std::max(std::max(ds, dl), da));
+          chunkSquared += (dh * dh) + (ds * ds) + (dl * dl) + (da * da);
+
+          if (chunk.changedPixels == 0) {
+            chunk.minX = chunk.maxX = x;
+            chunk.minY = chunk.maxY = y;
+          } else {
+            chunk.minX = std::min(chunk.minX, x);
+            chunk.maxX = std::max(chunk.maxX, x);
+            chunk.maxY = y;
+          }
+          chunk.changedPixels++;
+        }
+      }
+
+      if (chunk.changedPixels == 0) { return; }
+      std::lock_guard<std::mutex> lock(mutex);
+      if (result.changedPixels == 0) {
+        result.minX = chunk.minX;
+        result.minY = chunk.minY;
+        result.maxX = chunk.maxX;
+        result.maxY = chunk.maxY;
+      } else {
+        result.minX = std::min(result.minX, chunk.minX);
+        result.minY = std::min(result.minY, chunk.minY);
+        result.maxX = std::max(result.maxX, chunk.maxX);
+        result.maxY = std::max(result.maxY, chunk.maxY);
+      }
+      result.changedPixels += chunk.changedPixels;
+      result.maxAbsDiff = std::max(result.maxAbsDiff, chunk.maxAbsDiff);
+      sumSquared += chunkSquared;
+    });
+
+    result.meanSquaredError = sumSquared / (4.0 * width * height);
+    if (result.meanSquaredError > 0) {
+      result.psnr = 10.0 * std::log10(1.0 / result.meanSquaredError);
+    }
+    return result;
+  }
+}
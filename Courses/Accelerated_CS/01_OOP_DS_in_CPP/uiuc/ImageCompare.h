@@ -0,0 +1,57 @@
+/**
+ * @file ImageCompare.h
+ * Fast comparison of images: exact and tolerance-based equality, and
+ * difference metrics for checking images against golden images.
+ *
+ * Pixels are compared a block at a time with SSE2, two channels per
+ * instruction, and a comparison stops at the first block that differs.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  /**
+   * How two images of the same size differ. Channels are compared on a
+   * scale of 0 to 1: saturation, luminance and alpha as they are, and hue as
+   * the shorter way around the color wheel, divided by 360.
+   */
+  struct ImageDiff {
+    bool sameSize;              /*< Whether the images are the same size; if not, nothing else is set */
+    std::size_t changedPixels;  /*< Number of pixels with any channel not exactly equal */
+    double maxAbsDiff;          /*< Largest difference of any channel */
+    double meanSquaredError;    /*< Mean of the squared differences of every channel */
+    double psnr;                /*< Peak signal-to-noise ratio in dB, for a peak of 1; infinite if equal */
+    unsigned int minX, minY;    /*< Top left corner of the box of changed pixels */
+    unsigned int maxX, maxY;    /*< Bottom right corner (inclusive); the box is empty if nothing changed */
+
+    ImageDiff();
+  };
+
+  /**
+   * Checks whether `count` pixels are exactly equal, channel by channel, as
+   * PNG::operator== defines it.
+   */
+  bool pixelsEqual(HSLAPixel const * first, HSLAPixel const * second, std::size_t count);
+
+  /**
+   * Checks whether `count` pixels are equal to within `tolerance` in every
+   * channel. Differences are on the scale described for ImageDiff.
+   */
+  bool pixelsNearlyEqual(HSLAPixel const * first, HSLAPixel const * second, std::size_t count,
+                         double tolerance);
+
+  /**
+   * Measures how two images differ, comparing their rows in parallel on the
+   * given thread pool.
+   * @param first The first image, such as the image under test.
+   * @param second The second image, such as the golden image.
+   * @param pool The thread pool to compare on.
+   * @return The difference metrics.
+   */
+  ImageDiff diff(PNG const & first, PNG const & second, ThreadPool & pool = ThreadPool::shared());
+}
@@ -0,0 +1,104 @@
+/**
+ * @file ImageHash.cpp
+ * Implementation of a fast, stable, parallel hash of image contents.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "ImageHash.h"
+
+namespace uiuc {
+  // Constants from wyhash (public domain).
+  static const std::uint64_t kSecret0 = 0xa0761d6478bd642full;
+  static const std::uint64_t kSecret1 = 0xe7037ed1a0b428dbull;
+  static const std::uint64_t kSecret2 = 0x8ebc6af09c88c6e3ull;
+  static const std::uint64_t kSecret3 = 0x589965cc75374cc3ull;
+  static const std::uint64_t kSecret4 = 0x1d8e4e27c47d124full;
+
+  // Multiplies two 64-bit values and folds the 128-bit product to 64 bits.
+  static inline std::uint64_t _mum(std::uint64_t a, std::uint64_t b) {
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    uint128 product = uint128(a) * b;
+    return std::uint64_t(product) ^ std::uint64_t(product >> 64);
+#else
+    std::uint64_t aHi = a >> 32, aLo = a & 0xffffffffull;
+    std::uint64_t bHi = b >> 32, bLo = b & 0xffffffffull;
+    std::uint64_t hh = aHi * bHi, hl = aHi * bLo, lh = aLo * bHi, ll = aLo * bLo;
+    std::uint64_t middle = (ll >> 32) + (hl & 0xffffffffull) + (lh & 0xffffffffull);
+    std::uint64_t lo = (middle << 32) | (ll & 0xffffffffull);
+    std::uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (middle >> 32);
+    return lo ^ hi;
+#endif
+  }
+
+  // Gets the bits of a channel value. Adding 0.0 turns -0.0 into +0.0, so
+  // that values which compare equal hash equal.
+  static inline std::uint64_t _bits(double value) {
+    value += 0.0;
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  ImageHasher::ImageHasher(unsigned int width, std::uint64_t seed)
+    : width_(width), rows_(0), seed_(seed), state_(seed ^ kSecret0) { }
+
+  void ImageHasher::addRow(HSLAPixel const * pixels) {
+    addRowHash(hashRow(pixels, width_, seed_));
+  }
+
+  void ImageHasher::addRowHash(std::uint64_t rowHash) {
+    state_ = _mum(state_ ^ rowHash, kSecret1 ^ rows_);
+    rows_++;
+  }
+
+  std::uint64_t ImageHasher::digest() const {
+    return _mum(state_ ^ kSecret2 ^ width_, kSecret3 ^ rows_);
+  }
+
+  std::uint64_t ImageHasher::hashRow(HSLAPixel const * pixels, unsigned int count, std::uint64_t seed) {
+    // Four independent lanes, each taking two channels of a pixel per step,
+    // so consecutive multiplies do not depend on each other.
+    std::uint64_t lane0 = seed ^ kSecret0;
+    std::uint64_t lane1 = seed ^ kSecret1;
+    std::uint64_t lane2 = seed ^ kSecret2;
+    std::uint64_t lane3 = seed ^ kSecret3;
+
+    unsigned i = 0;
+    for (; i + 2 <= count; i += 2) {
+      HSLAPixel const & p0 = pixels[i];
+      HSLAPixel const & p1 = pixels[i + 1];
+      lane0 = _mum(_bits(p0.h) ^ kSecret1, _bits(p0.s) ^ lane0);
+      lane1 = _mum(_bits(p0.l) ^ kSecret2, _bits(p0.a) ^ lane1);
+      lane2 = _mum(_bits(p1.h) ^ kSecret3, _bits(p1.s) ^ lane2);
+      lane3 = _mum(_bits(p1.l) ^ kSecret4, _bits(p1.a) ^ lane3);
+    }
+    if (i < count) {
+      HSLAPixel const & p0 = pixels[i];
+      lane0 = _mum(_bits(p0.h) ^ kSecret1, _bits(p0.s) ^ lane0);
+      lane1 = _mum(_bits(p0.l) ^ kSecret2, _bits(p0.a) ^ lane1);
+    }
+
+    return _mum(lane0 ^ _mum(lane2, kSecret4 ^ count), lane1 ^ _mum(lane3, kSecret0));
+  }
+
+  std::uint64_t contentHash(PNG const & image, ThreadPool & pool, std::uint64_t seed) {
+    unsigned width = image.width();
+    unsigned height = image.height();
+    ImageHasher hasher(width, seed);
+
+    std::vector<std::uint64_t> rowHashes(height);
+    pool.parallelFor(0, height, ThreadPool::rowsPerChunk(width), [&](unsigned y0, unsigned y1) {
+      for (unsigned y = y0; y < y1; y++) {
+        rowHashes[y] = ImageHasher::hashRow(image.row(y), width, seed);
+      }
+    });
+
+    for (std::uint64_t rowHash : rowHashes) {
+      hasher.addRowHash(rowHash);
+    }
+    return hasher.digest();
+  }
+}
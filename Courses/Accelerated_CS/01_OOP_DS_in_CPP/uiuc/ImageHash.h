@@ -0,0 +1,76 @@
+/**
+ * @file ImageHash.h
+ * A fast, stable 64-bit hash of image contents for deduplication and cache
+ * keys.
+ *
+ * Each row is hashed on its own with four independent multiply-mix lanes
+ * (in the style of wyhash), and the row hashes are then folded together in
+ * row order. Rows can therefore be hashed on any number of threads, or fed
+ * in one at a time as they are produced, and the result is always the same.
+ * Unlike PNG::computeHash, every bit of each channel is hashed, and -0.0 and
+ * +0.0 hash the same since they compare equal.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  class ImageHasher {
+  public:
+    /**
+      * Starts hashing an image of the given width.
+      * @param width Width of the rows that will be added.
+      * @param seed Seed for the hash; images hashed with different seeds
+      *             get unrelated hashes.
+      */
+    explicit ImageHasher(unsigned int width, std::uint64_t seed = 0);
+
+    /**
+      * Adds the next row of the image, top to bottom.
+      * @param pixels The width pixels of the row.
+      */
+    void addRow(HSLAPixel const * pixels);
+
+    /**
+      * Adds the hash of the next row, as computed by hashRow. This lets rows
+      * be hashed in parallel and then combined in order.
+      * @param rowHash The hash of the row.
+      */
+    void addRowHash(std::uint64_t rowHash);
+
+    /**
+      * Gets the hash of all rows added so far, including the image size.
+      */
+    std::uint64_t digest() const;
+
+    /**
+      * Hashes a single row of pixels.
+      * @param pixels The pixels of the row.
+      * @param count The number of pixels in the row.
+      * @param seed The same seed the ImageHasher was created with.
+      * @return The hash of the row.
+      */
+    static std::uint64_t hashRow(HSLAPixel const * pixels, unsigned int count, std::uint64_t seed = 0);
+
+  private:
+    unsigned int width_;        /*< Width of each row */
+    unsigned int rows_;         /*< Number of rows added so far */
+    std::uint64_t seed_;        /*< Seed the hasher was created with */
+    std::uint64_t state_;       /*< Hash of the rows added so far */
+  };
+
+  /**
+   * Computes the content hash of a whole image, hashing its rows in
+   * parallel on the given thread pool. This gives the same result as
+   * adding every row to an ImageHasher in order.
+   * @param image The image to be hashed.
+   * @param pool The thread pool to hash the rows on.
+   * @param seed Seed for the hash.
+   * @return The hash of the image.
+   */
+  std::uint64_t contentHash(PNG const & image, ThreadPool & pool, std::uint64_t seed = 0);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file MappedFile.cpp
+ * Implementation of read-only memory mapped files.
+ */
+
+#include <fstream>
+#include <iterator>
+#include "MappedFile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define UIUC_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace uiuc {
+  MappedFile::MappedFile() : data_(0), size_(0), mapped_(false) { }
+
+  MappedFile::~MappedFile() {
+    close();
+  }
+
+  bool MappedFile::open(std::string const & fileName) {
+    close();
+
+#ifdef UIUC_HAVE_MMAP
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+      ::close(fd);
+      return false;
+    }
+
+    // An empty file cannot be mapped, but opens fine with no contents.
+    if (info.st_size > 0) {
+      void * data = mmap(0, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        return false;
+      }
+      data_ = static_cast<unsigned char const *>(data);
+      size_ = std::size_t(info.st_size);
+      mapped_ = true;
+    }
+
+    // The mapping stays valid after the file is closed.
+    ::close(fd);
+    return true;
+#else
+    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!file) { return false; }
+    buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+      buffer_.clear();
+      return false;
+    }
+    data_ = buffer_.empty() ? 0 : buffer_.data();
+    size_ = buffer_.size();
+    return true;
+#endif
+  }
+
+  void MappedFile::close() {
+#ifdef UIUC_HAVE_MMAP
+    if (mapped_) {
+      munmap(const_cast<unsigned char *>(data_), size_);
+    }
+#endif
+    data_ = 0;
+    size_ = 0;
+    mapped_ = false;
+    buffer_.clear();
+  }
+
+  unsigned char const * MappedFile::data() const {
+    return data_;
+  }
+
+  std::size_t MappedFile::size() const {
+    return size_;
+  }
+}
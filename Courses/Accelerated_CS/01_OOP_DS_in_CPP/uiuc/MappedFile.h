@@ -0,0 +1,59 @@
+/**
+ * @file MappedFile.h
+ * Read-only access to the contents of a whole file through memory mapping.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace uiuc {
+  class MappedFile {
+  public:
+    /**
+      * Creates a MappedFile with no file open.
+      */
+    MappedFile();
+
+    /**
+      * Unmaps the file, if one is open.
+      */
+    ~MappedFile();
+
+    /**
+      * Maps a file into memory, read-only. The pages are loaded by the OS as
+      * they are first touched, so nothing is read up front. On systems
+      * without mmap the file is read into memory instead.
+      * @param fileName Name of the file to be mapped.
+      * @return true, if the file was successfully mapped.
+      */
+    bool open(std::string const & fileName);
+
+    /**
+      * Unmaps the file. data() is no longer valid afterwards.
+      */
+    void close();
+
+    /**
+      * Gets the contents of the file, or NULL if no file is open or the file
+      * is empty.
+      */
+    unsigned char const * data() const;
+
+    /**
+      * Gets the size of the file in bytes.
+      */
+    std::size_t size() const;
+
+  private:
+    unsigned char const * data_;        /*< Contents of the file */
+    std::size_t size_;                  /*< Size of the file */
+    bool mapped_;                       /*< Whether data_ was mapped, rather than read into buffer_ */
+    std::vector<unsigned char> buffer_; /*< Contents of the file, if it could not be mapped */
+
+    MappedFile(MappedFile const &);
+    MappedFile & operator=(MappedFile const &);
+  };
+}
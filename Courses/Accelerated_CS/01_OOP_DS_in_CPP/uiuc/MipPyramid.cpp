@@ -0,0 +1,114 @@
+/**
+ * @file MipPyramid.cpp
+ * Implementation of image pyramids built with a parallel 2x2 box filter.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "MipPyramid.h"
+#include "Resample.h"
+#include "SIMD.h"
+
+namespace uiuc {
+  // Averages four premultiplied RGBA pixels.
+  static inline void _average(float const * a, float const * b, float const * c, float const * d, float * out) {
+#if UIUC_SSE2
+    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)),
+                            _mm_add_ps(_mm_loadu_ps(c), _mm_loadu_ps(d)));
+    _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+    for (unsigned i = 0; i < 4; i++) {
+      out[i] = ((a[i] + b[i]) + (c[i] + d[i])) * 0.25f;
+    }
+#endif
+  }
+
+  MipPyramid::MipPyramid() { }
+
+  MipPyramid::MipPyramid(PNG const & image, ThreadPool & pool) {
+    unsigned width = image.width();
+    unsigned height = image.height();
+    if (width == 0 || height == 0) { return; }
+
+    std::size_t total = 0;
+    for (;;) {
+      Level level = { width, height, total };
+      levels_.push_back(level);
+      total += std::size_t(width) * height;
+      if (width == 1 && height == 1) { break; }
+      width = (width + 1) / 2;
+      height = (height + 1) / 2;
+    }
+    arena_.reset(new HSLAPixel[total]);
+
+    // Level 0 is kept exactly as it is; a premultiplied copy of it is where
+    // the rest of the levels start from.
+    Level const & top = levels_[0];
+    std::copy(image.data(), image.data() + std::size_t(top.width) * top.height, arena_.get());
+    std::vector<float> above(std::size_t(top.width) * top.height * 4);
+    std::vector<float> below;
+    pool.parallelFor(0, top.height, ThreadPool::rowsPerChunk(top.width), [&](unsigned y0, unsigned y1) {
+      toPremultipliedRGBA(image.row(y0), &above[std::size_t(y0) * top.width * 4], std::size_t(y1 - y0) * top.width);
+    });
+
+    for (unsigned n = 1; n < levels_.size(); n++) {
+      Level const & src = levels_[n - 1];
+      Level const & dst = levels_[n];
+      below.resize(std::size_t(dst.width) * dst.height * 4);
+
+      pool.parallelFor(0, dst.height, ThreadPool::rowsPerChunk(dst.width), [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+          // An odd last row or column is averaged with itself.
+          float const * row0 = &above[std::size_t(2 * y) * src.width * 4];
+          float const * row1 = &above[std::size_t(std::min(2 * y + 1, src.height - 1)) * src.width * 4];
+          float * out = &below[std::size_t(y) * dst.width * 4];
+          for (unsigned x = 0; x < dst.width; x++) {
+            unsigned x0 = 2 * x * 4;
+            unsigned x1 = std::min(2 * x + 1, src.width - 1) * 4;
+            _average(row0 + x0, row0 + x1, row1 + x0, row1 + x1, out + x * 4);
+          }
+          fromPremultipliedRGBA(out, arena_.get() + dst.offset + std::size_t(y) * dst.width, dst.width);
+        }
+      });
+
+      above.swap(below);
+    }
+  }
+
+  unsigned int MipPyramid::levels() const {
+    return levels_.size();
+  }
+
+  unsigned int MipPyramid::width(unsigned int n) const {
+    assert(n < levels_.size());
+    return levels_[n].width;
+  }
+
+  unsigned int MipPyramid::height(unsigned int n) const {
+    assert(n < levels_.size());
+    return levels_[n].height;
+  }
+
+  HSLAPixel const * MipPyramid::level(unsigned int n) const {
+    assert(n < levels_.size());
+    return arena_.get() + levels_[n].offset;
+  }
+
+  HSLAPixel const * MipPyramid::row(unsigned int n, unsigned int y) const {
+    assert(n < levels_.size() && y < levels_[n].height);
+    return level(n) + std::size_t(y) * levels_[n].width;
+  }
+
+  unsigned int MipPyramid::levelFor(unsigned int maxWidth, unsigned int maxHeight) const {
+    for (unsigned n = 0; n < levels_.size(); n++) {
+      if (levels_[n].width <= maxWidth && levels_[n].height <= maxHeight) { return n; }
+    }
+    return levels_.empty() ? 0 : levels_.size() - 1;
+  }
+
+  PNG MipPyramid::toPNG(unsigned int n) const {
+    PNG image(width(n), height(n));
+    std::copy(level(n), level(n) + std::size_t(width(n)) * height(n), image.data());
+    return image;
+  }
+}
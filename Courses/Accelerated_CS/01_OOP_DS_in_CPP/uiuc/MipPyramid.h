@@ -0,0 +1,91 @@
+/**
+ * @file MipPyramid.h
+ * An image together with every halved version of it down to 1x1, for
+ * serving the same image at several zoom levels.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  class MipPyramid {
+  public:
+    /**
+      * Creates an empty pyramid with no levels.
+      */
+    MipPyramid();
+
+    /**
+      * Builds every level of the pyramid for an image. Level 0 is a copy of
+      * the image, and each level after it is half the size of the one above
+      * (rounded up), each pixel the average of a 2x2 block. Averaging is done
+      * in premultiplied RGBA, as in Resample.h; each level is made from the
+      * one above without converting it back and forth, and the rows of each
+      * level are made in parallel. All levels are stored in one allocation.
+      * @param image The image to build the pyramid from.
+      * @param pool The thread pool to build on.
+      */
+    explicit MipPyramid(PNG const & image, ThreadPool & pool = ThreadPool::shared());
+
+    MipPyramid(MipPyramid && other) = default;
+    MipPyramid & operator= (MipPyramid && other) = default;
+
+    /**
+      * Gets the number of levels, or 0 for an empty image.
+      */
+    unsigned int levels() const;
+
+    /**
+      * Gets the width of level `n`.
+      */
+    unsigned int width(unsigned int n) const;
+
+    /**
+      * Gets the height of level `n`.
+      */
+    unsigned int height(unsigned int n) const;
+
+    /**
+      * Gets the width(n) * height(n) pixels of level `n`, in row-major order.
+      * Like PNG::row, this is only bounds checked by asserts.
+      */
+    HSLAPixel const * level(unsigned int n) const;
+
+    /**
+      * Gets one row of level `n`.
+      */
+    HSLAPixel const * row(unsigned int n, unsigned int y) const;
+
+    /**
+      * Gets the largest level that fits in the given size, or the last
+      * (1x1) level if none do. Use it to pick a level to preview on:
+      *
+      *   PNG preview = grayscale(pyramid.toPNG(pyramid.levelFor(320, 240)));
+      */
+    unsigned int levelFor(unsigned int maxWidth, unsigned int maxHeight) const;
+
+    /**
+      * Copies level `n` into a new image.
+      */
+    PNG toPNG(unsigned int n) const;
+
+  private:
+    /**
+     * Where a level is in the arena.
+     */
+    struct Level {
+      unsigned int width;
+      unsigned int height;
+      std::size_t offset;
+    };
+
+    std::vector<Level> levels_;               /*< Size and position of each level */
+    std::unique_ptr<HSLAPixel[]> arena_;      /*< Pixels of every level, one after another */
+  };
+}
@@ -15,40 +15,57 @@
 #include "HSLAPixel.h"
 #include "PNG.h"
 #include "RGB_HSL.h"
+#include "ImageCompare.h"
+#include "ImageHash.h"
+#include "MappedFile.h"
+#include "PNGStream.h"
+#include "Resample.h"
 
 namespace uiuc {
+  // Runs lodepng's row tasks on a ThreadPool, in chunks of a few rows.
+  static void _parallelRows(void (*task)(void *, size_t, size_t), void * taskContext, size_t count, void * context) {
+    ThreadPool & pool = *static_cast<ThreadPool *>(context);
+    pool.parallelFor(0, count, 16, [&](unsigned begin, unsigned end) {
+      task(taskContext, begin, end);
+    });
+  }
+
   void PNG::_copy(PNG const & other) {
-    // Clear self
-    delete[] imageData_;
+    // Reuse the current pixel array if it is already the right size
+    if (width_ * height_ != other.width_ * other.height_) {
+      imageData_.reset(new HSLAPixel[other.width_ * other.height_]);
+    }
 
     // Copy `other` to self
     width_ = other.width_;
     height_ = other.height_;
-    imageData_ = new HSLAPixel[width_ * height_];
-    for (unsigned i = 0; i < width_ * height_; i++) {
-      imageData_[i] = other.imageData_[i];
-    }
+    std::copy(other.imageData_.get(), other.imageData_.get() + (width_ * height_), imageData_.get());
   }
 
   PNG::PNG() {
     width_ = 0;
     height_ = 0;
-    imageData_ = NULL;
   }
 
   PNG::PNG(unsigned int width, unsigned int height) {
     width_ = width;
     height_ = height;
-    imageData_ = new HSLAPixel[width * height];
+    imageData_.reset(new HSLAPixel[width * height]);
   }
 
   PNG::PNG(PNG const & other) {
-    imageData_ = NULL;
+    width_ = 0;
+    height_ = 0;
     _copy(other);
   }
 
+  PNG::PNG(PNG && other) noexcept : width_(other.width_), height_(other.height_),
+      imageData_(std::move(other.imageData_)) {
+    other.width_ = 0;
+    other.height_ = 0;
+  }
+
   PNG::~PNG() {
-    delete[] imageData_;
   }
 
   PNG const & PNG::operator=(PNG const & other) {
@@ -56,17 +73,29 @@ namespace uiuc {
     return *this;
   }
 
+  PNG & PNG::operator=(PNG && other) noexcept {
+    if (this != &other) {
+      width_ = other.width_;
+      height_ = other.height_;
+      imageData_ = std::move(other.imageData_);
+      other.width_ = 0;
+      other.height_ = 0;
+    }
+    return *this;
+  }
+
   bool PNG::operator==(PNG const & other) const {
     if (width_ != other.width_) { return false; }
     if (height_ != other.height_) { return false; }
 
-    for (unsigned i = 0; i < width_ * height_; i++) {
-      HSLAPixel & p1 = imageData_[i];
-      HSLAPixel & p2 = other.imageData_[i];
-      if (p1.h != p2.h || p1.s != p2.s || p1.l != p2.l || p1.a != p2.a) { return false; }
-    }
+    return pixelsEqual(imageData_.get(), other.imageData_.get(), std::size_t(width_) * height_);
+  }
 
-    return true;
+  bool PNG::equals(PNG const & other, double tolerance) const {
+    if (width_ != other.width_) { return false; }
+    if (height_ != other.height_) { return false; }
+
+    return pixelsNearlyEqual(imageData_.get(), other.imageData_.get(), std::size_t(width_) * height_, tolerance);
   }
 
   bool PNG::operator!=(PNG const & other) const {
@@ -98,61 +127,122 @@ namespace uiuc {
     return imageData_[index];
   }
 
+  HSLAPixel * PNG::row(unsigned int y) {
+    assert(y < height_);
+    return imageData_.get() + (y * width_);
+  }
+
+  HSLAPixel const * PNG::row(unsigned int y) const {
+    assert(y < height_);
+    return imageData_.get() + (y * width_);
+  }
+
+  HSLAPixel * PNG::data() {
+    return imageData_.get();
+  }
+
+  HSLAPixel const * PNG::data() const {
+    return imageData_.get();
+  }
+
+  PNG::iterator PNG::begin() {
+    return imageData_.get();
+  }
+
+  PNG::iterator PNG::end() {
+    return imageData_.get() + (width_ * height_);
+  }
+
+  PNG::const_iterator PNG::begin() const {
+    return imageData_.get();
+  }
+
+  PNG::const_iterator PNG::end() const {
+    return imageData_.get() + (width_ * height_);
+  }
+
   bool PNG::readFromFile(string const & fileName) {
-    vector<unsigned char> byteData;
-    unsigned error = lodepng::decode(byteData, width_, height_, fileName);
+    PNGStreamReader reader;
+    return reader.open(fileName) && _read(reader);
+  }
 
-    if (error) {
-      cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << endl;
+  bool PNG::readFromMappedFile(string const & fileName) {
+    MappedFile file;
+    if (!file.open(fileName)) {
+      cerr << "PNG decoder error 78: " << lodepng_error_text(78) << endl;
       return false;
     }
+    return readFromMemory(file.data(), file.size());
+  }
 
-    delete[] imageData_;
-    imageData_ = new HSLAPixel[width_ * height_];
-
-    for (unsigned i = 0; i < byteData.size(); i += 4) {
-      rgbaColor rgb;
-      rgb.r = byteData[i];
-      rgb.g = byteData[i + 1];
-      rgb.b = byteData[i + 2];
-      rgb.a = byteData[i + 3];
-
-      hslaColor hsl = rgb2hsl(rgb);
-      HSLAPixel & pixel = imageData_[i/4];
-      pixel.h = hsl.h;
-      pixel.s = hsl.s;
-      pixel.l = hsl.l;
-      pixel.a = hsl.a;
-    }
+  bool PNG::readFromMemory(unsigned char const * data, std::size_t size) {
+    PNGStreamReader reader;
+    return reader.open(data, size) && _read(reader);
+  }
 
+  bool PNG::_read(PNGStreamReader & reader) {
+    // Rows are decoded straight into the pixel array a band at a time, so
+    // the whole RGBA image is never held in memory.
+    unsigned width = reader.width();
+    std::unique_ptr<HSLAPixel[]> imageData(new HSLAPixel[std::size_t(width) * reader.height()]);
+    bool read = reader.read([&](HSLAPixel * pixels, unsigned y, unsigned rows) {
+      std::copy(pixels, pixels + std::size_t(rows) * width, &imageData[std::size_t(y) * width]);
+      return true;
+    });
+    if (!read) { return false; }
+
+    width_ = width;
+    height_ = reader.height();
+    imageData_ = std::move(imageData);
     return true;
   }
 
   bool PNG::writeToFile(string const & fileName) {
-    unsigned char *byteData = new unsigned char[width_ * height_ * 4];
+    return writeToFile(fileName, PNGWriteOptions());
+  }
+
+  bool PNG::writeToFile(string const & fileName, PNGWriteOptions const & options) const {
+    vector<unsigned char> encoded;
+    if (!writeToMemory(encoded, options)) { return false; }
+
+    unsigned error = lodepng::save_file(encoded, fileName);
+    if (error) {
+      cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << endl;
+    }
+
+    return (error == 0);
+  }
 
-    for (unsigned i = 0; i < width_ * height_; i++) {
-      hslaColor hsl;
-      hsl.h = imageData_[i].h;
-      hsl.s = imageData_[i].s;
-      hsl.l = imageData_[i].l;
-      hsl.a = imageData_[i].a;
+  bool PNG::writeToMemory(vector<unsigned char> & out, PNGWriteOptions const & options) const {
+    vector<unsigned char> encoded;
+    unsigned error;
 
-      rgbaColor rgb = hsl2rgb(hsl);
+    if (options.threads == 1) {
+      vector<unsigned char> byteData(width_ * height_ * 4);
+      hsl2rgbBatch(imageData_.get(), byteData.data(), width_ * height_);
 
-      byteData[(i * 4)]     = rgb.r;
-      byteData[(i * 4) + 1] = rgb.g;
-      byteData[(i * 4) + 2] = rgb.b;
-      byteData[(i * 4) + 3] = rgb.a;
+      lodepng::State state;
+      setCompressionLevel(state.encoder.zlibsettings, options.compressionLevel);
+      if (options.fastFilter) {
+        state.encoder.fast_filter = 1;
+        state.encoder.parallel_for = _parallelRows;
+        state.encoder.parallel_context = &ThreadPool::shared();
+      }
+      error = lodepng::encode(encoded, byteData, width_, height_, state);
+    } else if (options.threads == 0) {
+      error = encodeParallel(encoded, imageData_.get(), width_, height_, options.compressionLevel, ThreadPool::shared());
+    } else {
+      ThreadPool pool(options.threads);
+      error = encodeParallel(encoded, imageData_.get(), width_, height_, options.compressionLevel, pool);
     }
 
-    unsigned error = lodepng::encode(fileName, byteData, width_, height_);
     if (error) {
       cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << endl;
+      return false;
     }
 
-    delete[] byteData;
-    return (error == 0);
+    out.swap(encoded);
+    return true;
   }
 
   unsigned int PNG::width() const {
@@ -164,28 +254,25 @@ namespace uiuc {
   }
 
   void PNG::resize(unsigned int newWidth, unsigned int newHeight) {
+    resize(newWidth, newHeight, ResizeMode::Crop);
+  }
+
+  void PNG::resize(unsigned int newWidth, unsigned int newHeight, ResizeMode mode) {
+    if (mode != ResizeMode::Crop && newWidth == width_ && newHeight == height_) { return; }
+
     // Create a new vector to store the image data for the new (resized) image
-    HSLAPixel * newImageData = new HSLAPixel[newWidth * newHeight];
-
-    // Copy the current data to the new image data, using the existing pixel
-    // for coordinates within the bounds of the old image size
-    for (unsigned x = 0; x < newWidth; x++) {
-      for (unsigned y = 0; y < newHeight; y++) {
-        if (x < width_ && y < height_) {
-          HSLAPixel & oldPixel = this->getPixel(x, y);
-          HSLAPixel & newPixel = newImageData[ (x + (y * newWidth)) ];
-          newPixel = oldPixel;
-        }
-      }
-    }
+    std::unique_ptr<HSLAPixel[]> newImageData(new HSLAPixel[std::size_t(newWidth) * newHeight]);
 
-    // Clear the existing image
-    delete[] imageData_;
+    // Fill in the new image data: when cropping, using the existing pixel for
+    // coordinates within the bounds of the old image size
+    resample(imageData_.get(), width_, height_, newImageData.get(), newWidth, newHeight,
+             mode, ThreadPool::shared());
 
-    // Update the image to reflect the new image size and data
+    // Update the image to reflect the new image size and data, which frees
+    // the existing image
     width_ = newWidth;
     height_ = newHeight;
-    imageData_ = newImageData;
+    imageData_ = std::move(newImageData);
   }
 
   std::size_t PNG::computeHash() const {
@@ -193,9 +280,11 @@ namespace uiuc {
     std::size_t hash = 0;
 
 
-    for (unsigned x = 0; x < this->width(); x++) {
-      for (unsigned y = 0; y < this->height(); y++) {
-        HSLAPixel & pixel = this->getPixel(x, y);
+    // The hash is defined over a column-major walk of the image, which is
+    // kept so that existing hashes stay the same.
+    for (unsigned x = 0; x < width_; x++) {
+      for (unsigned y = 0; y < height_; y++) {
+        HSLAPixel const & pixel = imageData_[x + (y * width_)];
         hash = (hash << 1) + hash + hashFunction(pixel.h);
         hash = (hash << 1) + hash + hashFunction(pixel.s);
         hash = (hash << 1) + hash + hashFunction(pixel.l);
@@ -206,6 +295,10 @@ namespace uiuc {
     return hash;
   }
 
+  std::uint64_t PNG::computeContentHash() const {
+    return contentHash(*this, ThreadPool::shared());
+  }
+
   std::ostream & operator << ( std::ostream& os, PNG const& png ) {
     os << "PNG(w=" << png.width() << ", h=" << png.height() << ", hash=" << std::hex << png.computeHash() << std::dec << ")";
     return os;
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include "HSLAPixel.h"
@@ -14,8 +16,56 @@
 using namespace std;
 
 namespace uiuc {
+  class PNGStreamReader;
+
+  /**
+   * How PNG::resize fills in the resized image.
+   */
+  enum class ResizeMode {
+    Crop,       /*< Keep pixels where they are, cropping or padding the edges */
+    Bilinear,   /*< Interpolate with a triangle filter */
+    Bicubic,    /*< Interpolate with a Catmull-Rom cubic filter */
+    Lanczos     /*< Interpolate with a 3-lobe Lanczos filter; the sharpest */
+  };
+
+  /**
+   * Settings for writing a PNG image.
+   */
+  struct PNGWriteOptions {
+    /**
+      * How hard to compress, from 0 (no compression, fastest) to 9
+      * (smallest file, slowest). The default of 6 matches lodepng's own
+      * defaults.
+      */
+    int compressionLevel;
+
+    /**
+      * Number of threads to filter and compress with. 1 (the default) uses
+      * the plain lodepng encoder, which picks the smallest color type for the
+      * image. Anything else splits the image into bands of rows that are
+      * compressed in parallel into one stream, and writes 8-bit RGBA, or RGB
+      * for opaque images; 0 uses the shared thread pool.
+      */
+    unsigned int threads;
+
+    /**
+      * With the plain lodepng encoder (threads of 1), choose each row's
+      * filter with SIMD and filter the rows on the shared thread pool. The
+      * file is byte-for-byte the same; only compression stays serial.
+      */
+    bool fastFilter;
+
+    PNGWriteOptions() : compressionLevel(6), threads(1), fastFilter(false) { }
+  };
+
   class PNG {
   public:
+    /**
+      * Iterators over the pixels of the image, in row-major order.
+      */
+    typedef HSLAPixel * iterator;
+    typedef HSLAPixel const * const_iterator;
+
     /**
       * Creates an empty PNG image.
       */
@@ -35,6 +85,13 @@ namespace uiuc {
       */
     PNG(PNG const & other);
 
+    /**
+      * Move constructor: creates a new PNG image that takes over the pixels
+      * of another, leaving `other` as an empty image. No pixels are copied.
+      * @param other PNG to be moved from.
+      */
+    PNG(PNG && other) noexcept;
+
     /**
       * Destructor: frees all memory associated with a given PNG object.
       * Invoked by the system.
@@ -48,6 +105,14 @@ namespace uiuc {
       */
     PNG const & operator= (PNG const & other);
 
+    /**
+      * Move assignment operator: frees the current pixels and takes over the
+      * pixels of another image, leaving `other` as an empty image.
+      * @param other Image to move into the current image.
+      * @return The current image for assignment chaining.
+      */
+    PNG & operator= (PNG && other) noexcept;
+
     /**
       * Equality operator: checks if two images are the same.
       * @param other Image to be checked.
@@ -62,6 +127,17 @@ namespace uiuc {
       */
     bool operator!= (PNG const & other) const;
 
+    /**
+      * Checks if two images are the same size and every channel of every
+      * pixel is within `tolerance` of the other image's. Hue is compared the
+      * shorter way around the color wheel and divided by 360, so that every
+      * channel is on a scale of 0 to 1. See ImageCompare.h.
+      * @param other Image to be checked.
+      * @param tolerance Largest difference allowed in any channel.
+      * @return Whether the images are equal to within the tolerance.
+      */
+    bool equals(PNG const & other, double tolerance) const;
+
 
     /**
       * Reads in a PNG image from a file.
@@ -71,6 +147,24 @@ namespace uiuc {
       */
     bool readFromFile(string const & fileName);
 
+    /**
+      * Reads in a PNG image from a file by mapping it into memory, rather
+      * than reading it through a stream. This saves a copy of the file.
+      * Overwrites any current image content in the PNG.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromMappedFile(string const & fileName);
+
+    /**
+      * Reads in a PNG image from the contents of a PNG file in memory.
+      * Overwrites any current image content in the PNG.
+      * @param data The bytes of the PNG file.
+      * @param size The number of bytes.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromMemory(unsigned char const * data, std::size_t size);
+
     /**
       * Writes a PNG image to a file.
       * @param fileName Name of the file to be written.
@@ -78,6 +172,22 @@ namespace uiuc {
       */
     bool writeToFile(string const & fileName);
 
+    /**
+      * Writes a PNG image to a file with the given settings.
+      * @param fileName Name of the file to be written.
+      * @param options Compression level and number of threads to use.
+      * @return true, if the image was successfully written.
+      */
+    bool writeToFile(string const & fileName, PNGWriteOptions const & options) const;
+
+    /**
+      * Encodes a PNG image into memory, exactly as writeToFile would write it.
+      * @param out Receives the bytes of the PNG file.
+      * @param options Compression level and number of threads to use.
+      * @return true, if the image was successfully encoded.
+      */
+    bool writeToMemory(vector<unsigned char> & out, PNGWriteOptions const & options = PNGWriteOptions()) const;
+
     /**
       * Pixel access operator. Gets a reference to the pixel at the given
       * coordinates in the image. (0,0) is the upper left corner.
@@ -88,6 +198,33 @@ namespace uiuc {
       */
     HSLAPixel & getPixel(unsigned int x, unsigned int y) const;
 
+    /**
+      * Gets the pixels of one row of the image. The row holds width()
+      * consecutive pixels, and rows are stored one after another, top to
+      * bottom. Unlike getPixel, this does no bounds checking other than an
+      * assert in debug builds, so it is meant for inner loops.
+      * @param y Y-coordinate of the row.
+      * @return A pointer to the leftmost pixel of the row.
+      */
+    HSLAPixel * row(unsigned int y);
+    HSLAPixel const * row(unsigned int y) const;
+
+    /**
+      * Gets all width() * height() pixels of the image in row-major order,
+      * or NULL for an empty image.
+      */
+    HSLAPixel * data();
+    HSLAPixel const * data() const;
+
+    /**
+      * Iterators over all of the pixels of the image in row-major order.
+      * Like row, these are not bounds checked.
+      */
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
     /**
       * Gets the width of this image.
       * @return Width of the image.
@@ -109,21 +246,43 @@ namespace uiuc {
       */
     void resize(unsigned int newWidth, unsigned int newHeight);
 
+    /**
+      * Resizes the image to the given coordinates. With ResizeMode::Crop
+      * this is the same as resize(newWidth, newHeight); the other modes
+      * scale the whole image to the new size, resampling it on the shared
+      * thread pool. See Resample.h.
+      * @param newWidth New width of the image.
+      * @param newHeight New height of the image.
+      * @param mode How to fill in the resized image.
+      */
+    void resize(unsigned int newWidth, unsigned int newHeight, ResizeMode mode);
+
     /**
      * Computes a hash of the contents of the image.
      */
     std::size_t computeHash() const;
 
+    /**
+     * Computes a fast, stable 64-bit hash of the contents of the image,
+     * hashing rows in parallel on the shared thread pool. See ImageHash.h.
+     */
+    std::uint64_t computeContentHash() const;
+
   private:
     unsigned int width_;            /*< Width of the image */
     unsigned int height_;           /*< Height of the image */
-    HSLAPixel *imageData_;          /*< Array of pixels */
+    std::unique_ptr<HSLAPixel[]> imageData_; /*< Array of pixels */
     HSLAPixel defaultPixel_;        /*< Default pixel, returned in cases of errors */
 
     /**
      * Copeies the contents of `other` to self
      */
      void _copy(PNG const & other);
+
+    /**
+     * Reads the image from an opened reader, leaving self unchanged on failure.
+     */
+     bool _read(PNGStreamReader & reader);
   };
 
   std::ostream & operator<<(std::ostream & out, PNG const & pixel);
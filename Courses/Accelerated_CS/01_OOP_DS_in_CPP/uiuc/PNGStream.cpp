@@ -0,0 +1,525 @@
+/**
+ * @file PNGStream.cpp
+ * Implementation of reading and writing PNG files a band of rows at a time.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include "PNGStream.h"
+#include "RGB_HSL.h"
+
+namespace uiuc {
+  // Bands of rows are about this many pixels, which is large enough for
+  // the rows to be split across threads by whoever receives them.
+  static const unsigned kPixelsPerBand = 1 << 18;
+
+  // Filtered rows are compressed about this many bytes at a time.
+  static const std::size_t kBytesPerBand = 1 << 20;
+
+  // Bytes of filtered data kept as the dictionary for the next band; the
+  // most that deflate can refer back.
+  static const std::size_t kDictionaryBytes = 32768;
+
+  // Returned by PNGStreamReader::_receive when the callback asks to stop.
+  static const unsigned kStopped = ~0u;
+
+  // PNG file signature, and the zlib header that lodepng writes.
+  static const unsigned char kSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  static const unsigned char kZlibHeader[2] = {0x78, 0x01};
+
+  // Deflate settings for each compression level: window size, length at
+  // which a match is good enough, and whether to use lazy matching. Level 6
+  // is lodepng's default.
+  static const struct { unsigned windowsize, nicematch, lazymatching; } kLevels[10] = {
+    {     0,   0, 0 },
+    {   256,  16, 0 },
+    {   512,  32, 0 },
+    {  1024,  64, 0 },
+    {  1024,  64, 1 },
+    {  2048,  96, 1 },
+    {  2048, 128, 1 },
+    {  4096, 128, 1 },
+    {  8192, 258, 1 },
+    { 32768, 258, 1 },
+  };
+
+  static bool _decodeError(unsigned error) {
+    std::cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+    return false;
+  }
+
+  static bool _encodeError(unsigned error) {
+    std::cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << std::endl;
+    return false;
+  }
+
+  static void _write32(unsigned char * out, unsigned value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)(value);
+  }
+
+  static void _appendChunk(std::vector<unsigned char> & out, char const * type,
+                           unsigned char const * data, std::size_t size) {
+    std::size_t start = out.size();
+    out.resize(start + size + 12);
+    unsigned char * chunk = &out[start];
+    _write32(&chunk[0], (unsigned) size);
+    std::copy(type, type + 4, &chunk[4]);
+    if (size > 0) { std::copy(data, data + size, &chunk[8]); }
+    _write32(&chunk[8 + size], lodepng_crc32(&chunk[4], size + 4));
+  }
+
+  static void _appendHeader(std::vector<unsigned char> & out, unsigned width, unsigned height,
+                            LodePNGColorType colorType = LCT_RGBA) {
+    out.insert(out.end(), kSignature, kSignature + sizeof(kSignature));
+
+    // 8-bit, deflate, adaptive filtering, no interlacing
+    unsigned char header[13] = {0, 0, 0, 0, 0, 0, 0, 0, 8, (unsigned char) colorType, 0, 0, 0};
+    _write32(&header[0], width);
+    _write32(&header[4], height);
+    _appendChunk(out, "IHDR", header, sizeof(header));
+  }
+
+  void setCompressionLevel(LodePNGCompressSettings & settings, int level) {
+    level = std::max(0, std::min(9, level));
+    if (level == 0) {
+      settings.btype = 0;
+      return;
+    }
+    settings.btype = 2;
+    settings.windowsize = kLevels[level].windowsize;
+    settings.nicematch = kLevels[level].nicematch;
+    settings.lazymatching = kLevels[level].lazymatching;
+  }
+
+  PNGStreamReader::PNGStreamReader() : memory_(0), memorySize_(0), width_(0), height_(0),
+                                       compressed_(0), compressedSize_(0), callback_(0) {
+    lodepng_state_init(&state_);
+  }
+
+  PNGStreamReader::~PNGStreamReader() {
+    lodepng_state_cleanup(&state_);
+  }
+
+  void PNGStreamReader::_reset() {
+    lodepng_state_cleanup(&state_);
+    lodepng_state_init(&state_);
+    fileName_.clear();
+    memory_ = 0;
+    memorySize_ = 0;
+    width_ = 0;
+    height_ = 0;
+    idat_.clear();
+    compressed_ = 0;
+    compressedSize_ = 0;
+  }
+
+  bool PNGStreamReader::open(std::string const & fileName) {
+    _reset();
+    fileName_ = fileName;
+
+    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!file) { return _decodeError(78); }
+
+    unsigned char header[33];
+    if (!file.read((char *) header, sizeof(header))) { return _decodeError(27); }
+
+    unsigned width, height;
+    unsigned error = lodepng_inspect(&width, &height, &state_, header, sizeof(header));
+    if (error) { return _decodeError(error); }
+
+    // Read the chunks one at a time, keeping only the compressed image data
+    // and whatever changes how it is decoded.
+    std::vector<unsigned char> chunk;
+    for (;;) {
+      chunk.resize(8);
+      if (!file.read((char *) chunk.data(), 8)) { return _decodeError(30); }
+
+      unsigned length = lodepng_chunk_length(chunk.data());
+      if (length > 2147483647) { return _decodeError(63); }
+      chunk.resize(std::size_t(length) + 12);
+      if (!file.read((char *) &chunk[8], std::size_t(length) + 4)) { return _decodeError(30); }
+
+      if (lodepng_chunk_type_equals(chunk.data(), "IEND")) {
+        break;
+      } else if (lodepng_chunk_type_equals(chunk.data(), "IDAT")) {
+        if (!state_.decoder.ignore_crc && lodepng_chunk_check_crc(chunk.data())) { return _decodeError(57); }
+        idat_.insert(idat_.end(), chunk.begin() + 8, chunk.begin() + 8 + length);
+      } else {
+        error = lodepng_inspect_chunk(&state_, chunk.data(), chunk.size());
+        if (error) { return _decodeError(error); }
+      }
+    }
+
+    width_ = width;
+    height_ = height;
+    compressed_ = idat_.data();
+    compressedSize_ = idat_.size();
+    return true;
+  }
+
+  bool PNGStreamReader::open(unsigned char const * data, std::size_t size) {
+    _reset();
+
+    unsigned width, height;
+    unsigned error = lodepng_inspect(&width, &height, &state_, data, size);
+    if (error) { return _decodeError(error); }
+
+    // The compressed image data is used in place if it is all in one chunk.
+    unsigned char const * idat = 0;
+    std::size_t idatSize = 0;
+    unsigned idatChunks = 0;
+    for (std::size_t pos = 33; ; ) {
+      if (size - pos < 12) { return _decodeError(30); }
+      unsigned char const * chunk = data + pos;
+      unsigned length = lodepng_chunk_length(chunk);
+      if (length > 2147483647) { return _decodeError(63); }
+      if (size - pos - 12 < length) { return _decodeError(30); }
+
+      if (lodepng_chunk_type_equals(chunk, "IEND")) {
+        break;
+      } else if (lodepng_chunk_type_equals(chunk, "IDAT")) {
+        if (!state_.decoder.ignore_crc && lodepng_chunk_check_crc(chunk)) { return _decodeError(57); }
+        if (idatChunks == 0) {
+          idat = chunk + 8;
+          idatSize = length;
+        } else {
+          if (idatChunks == 1) { idat_.assign(idat, idat + idatSize); }
+          idat_.insert(idat_.end(), chunk + 8, chunk + 8 + length);
+        }
+        idatChunks++;
+      } else {
+        error = lodepng_inspect_chunk(&state_, chunk, std::size_t(length) + 12);
+        if (error) { return _decodeError(error); }
+      }
+      pos += std::size_t(length) + 12;
+    }
+
+    memory_ = data;
+    memorySize_ = size;
+    width_ = width;
+    height_ = height;
+    compressed_ = (idatChunks > 1) ? idat_.data() : idat;
+    compressedSize_ = (idatChunks > 1) ? idat_.size() : idatSize;
+    return true;
+  }
+
+  unsigned int PNGStreamReader::width() const {
+    return width_;
+  }
+
+  unsigned int PNGStreamReader::height() const {
+    return height_;
+  }
+
+  bool PNGStreamReader::read(RowCallback const & callback) {
+    if (width_ == 0 || height_ == 0) {
+      std::cerr << "ERROR: Call to uiuc::PNGStreamReader::read made with no image open." << std::endl;
+      return false;
+    }
+
+    rowsPerBand_ = std::min(height_, std::max(1u, kPixelsPerBand / width_));
+    band_.resize(std::size_t(rowsPerBand_) * width_);
+    rgba_.resize(std::size_t(rowsPerBand_) * width_ * 4);
+    bandRows_ = 0;
+    y_ = 0;
+    callback_ = &callback;
+
+    if (state_.info_png.interlace_method != 0) {
+      // Adam7 interlaced rows are spread over the whole compressed stream,
+      // so they can only be decoded whole.
+      std::vector<unsigned char> bytes;
+      unsigned width, height;
+      unsigned error = memory_ ? lodepng::decode(bytes, width, height, memory_, memorySize_)
+                               : lodepng::decode(bytes, width, height, fileName_);
+      if (error) { return _decodeError(error); }
+
+      for (unsigned y = 0; y < height_; y += rowsPerBand_) {
+        bandRows_ = std::min(rowsPerBand_, height_ - y);
+        std::copy(&bytes[std::size_t(y) * width_ * 4], &bytes[std::size_t(y + bandRows_) * width_ * 4], rgba_.begin());
+        if (!_deliver()) { return false; }
+      }
+      return true;
+    }
+
+    std::size_t lineBytes = (std::size_t(width_) * lodepng_get_bpp(&state_.info_png.color) + 7) / 8;
+    scanline_.resize(lineBytes + 1);
+    current_.resize(lineBytes);
+    previous_.resize(lineBytes);
+    filled_ = 0;
+
+    unsigned error = lodepng_zlib_decompress_stream(compressed_, compressedSize_, _receive, this,
+                                                    &state_.decoder.zlibsettings);
+    if (error == kStopped) { return false; }
+    if (!error && (filled_ != 0 || y_ + bandRows_ != height_)) { error = 91; }
+    if (error) { return _decodeError(error); }
+
+    return bandRows_ == 0 || _deliver();
+  }
+
+  unsigned PNGStreamReader::_receive(unsigned char const * data, std::size_t size, void * context) {
+    PNGStreamReader & reader = *static_cast<PNGStreamReader *>(context);
+    LodePNGColorMode const & color = reader.state_.info_png.color;
+    std::size_t lineBytes = reader.current_.size();
+    std::size_t byteWidth = (lodepng_get_bpp(&color) + 7) / 8;
+
+    LodePNGColorMode rgba;
+    lodepng_color_mode_init(&rgba);
+
+    while (size > 0) {
+      std::size_t amount = std::min(size, reader.scanline_.size() - reader.filled_);
+      std::copy(data, data + amount, &reader.scanline_[reader.filled_]);
+      reader.filled_ += amount;
+      data += amount;
+      size -= amount;
+      if (reader.filled_ < reader.scanline_.size()) { break; }
+
+      // A whole scanline is in: unfilter it and convert it to RGBA.
+      unsigned y = reader.y_ + reader.bandRows_;
+      if (y >= reader.height_) { return 91; }
+
+      unsigned char const * previous = (y > 0) ? reader.previous_.data() : 0;
+      unsigned error = lodepng_unfilter_scanline(reader.current_.data(), &reader.scanline_[1], previous,
+                                                 byteWidth, reader.scanline_[0], lineBytes);
+      if (!error) {
+        unsigned char * out = &reader.rgba_[std::size_t(reader.bandRows_) * reader.width_ * 4];
+        error = lodepng_convert(out, reader.current_.data(), &rgba, &color, reader.width_, 1);
+      }
+      if (error) { return error; }
+
+      std::swap(reader.current_, reader.previous_);
+      reader.filled_ = 0;
+      reader.bandRows_++;
+      if (reader.bandRows_ == reader.rowsPerBand_ && !reader._deliver()) { return kStopped; }
+    }
+
+    return 0;
+  }
+
+  bool PNGStreamReader::_deliver() {
+    rgb2hslBatch(rgba_.data(), band_.data(), std::size_t(bandRows_) * width_);
+    bool keepGoing = (*callback_)(band_.data(), y_, bandRows_);
+    y_ += bandRows_;
+    bandRows_ = 0;
+    return keepGoing;
+  }
+
+
+  PNGStreamWriter::PNGStreamWriter() : width_(0), height_(0), rowsWritten_(0), adler_(1),
+                                       headerWritten_(false), dictionary_(0) {
+    lodepng_compress_settings_init(&settings_);
+  }
+
+  PNGStreamWriter::~PNGStreamWriter() {
+    if (file_.is_open()) { file_.close(); }
+  }
+
+  bool PNGStreamWriter::open(std::string const & fileName, unsigned int width, unsigned int height,
+                             PNGWriteOptions const & options) {
+    if (file_.is_open()) { file_.close(); }
+    if (width == 0 || height == 0) { return _encodeError(93); }
+
+    file_.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_) { return _encodeError(79); }
+
+    width_ = width;
+    height_ = height;
+    rowsWritten_ = 0;
+    adler_ = 1;
+    headerWritten_ = false;
+    current_.assign(std::size_t(width) * 4, 0);
+    previous_.assign(std::size_t(width) * 4, 0);
+    filtered_.clear();
+    dictionary_ = 0;
+    lodepng_compress_settings_init(&settings_);
+    setCompressionLevel(settings_, options.compressionLevel);
+
+    std::vector<unsigned char> header;
+    _appendHeader(header, width, height);
+    file_.write((char const *) header.data(), header.size());
+    if (!file_) { return _encodeError(79); }
+    return true;
+  }
+
+  bool PNGStreamWriter::writeRows(HSLAPixel const * pixels, unsigned int rows) {
+    if (!file_.is_open()) {
+      std::cerr << "ERROR: Call to uiuc::PNGStreamWriter::writeRows made with no file open." << std::endl;
+      return false;
+    }
+    if (rows > height_ - rowsWritten_) {
+      std::cerr << "ERROR: Call to uiuc::PNGStreamWriter::writeRows writes " << rows << " rows, but only "
+          << (height_ - rowsWritten_) << " of the image's " << height_ << " rows are left." << std::endl;
+      return false;
+    }
+
+    std::size_t lineBytes = current_.size();
+    for (unsigned r = 0; r < rows; r++) {
+      hsl2rgbBatch(pixels + std::size_t(r) * width_, current_.data(), width_);
+
+      std::size_t at = filtered_.size();
+      filtered_.resize(at + 1 + lineBytes);
+      unsigned char const * previous = (rowsWritten_ > 0) ? previous_.data() : 0;
+      unsigned error = lodepng_filter_scanline(&filtered_[at], current_.data(), previous, lineBytes, 4, LFS_MINSUM);
+      if (error) { return _encodeError(error); }
+      adler_ = lodepng_update_adler32(adler_, &filtered_[at], 1 + lineBytes);
+
+      std::swap(current_, previous_);
+      rowsWritten_++;
+      if (filtered_.size() - dictionary_ >= kBytesPerBand && !_flush(false)) { return false; }
+    }
+    return true;
+  }
+
+  bool PNGStreamWriter::close() {
+    if (!file_.is_open()) { return false; }
+    if (rowsWritten_ != height_) {
+      std::cerr << "ERROR: Call to uiuc::PNGStreamWriter::close made after writing only " << rowsWritten_
+          << " of the image's " << height_ << " rows." << std::endl;
+      file_.close();
+      return false;
+    }
+
+    bool ok = _flush(true) && _writeChunk("IEND", 0, 0);
+    file_.close();
+    return ok && !file_.fail();
+  }
+
+  bool PNGStreamWriter::_flush(bool final) {
+    unsigned char * deflated = 0;
+    std::size_t deflatedSize = 0;
+    unsigned error = lodepng_deflate_part(&deflated, &deflatedSize, filtered_.data(), dictionary_,
+                                          filtered_.size(), final ? 1 : 0, &settings_);
+    if (error) {
+      std::free(deflated);
+      return _encodeError(error);
+    }
+
+    // The IDAT chunks together make up one zlib stream: a two byte header,
+    // the deflate parts, and the Adler-32 of the filtered data.
+    std::vector<unsigned char> idat;
+    idat.reserve(deflatedSize + 6);
+    if (!headerWritten_) {
+      idat.insert(idat.end(), kZlibHeader, kZlibHeader + sizeof(kZlibHeader));
+      headerWritten_ = true;
+    }
+    idat.insert(idat.end(), deflated, deflated + deflatedSize);
+    std::free(deflated);
+    if (final) {
+      idat.resize(idat.size() + 4);
+      _write32(&idat[idat.size() - 4], adler_);
+    }
+
+    std::size_t keep = std::min(kDictionaryBytes, filtered_.size());
+    filtered_.erase(filtered_.begin(), filtered_.end() - keep);
+    dictionary_ = keep;
+
+    return _writeChunk("IDAT", idat.data(), idat.size());
+  }
+
+  bool PNGStreamWriter::_writeChunk(char const * type, unsigned char const * data, std::size_t size) {
+    std::vector<unsigned char> chunk;
+    _appendChunk(chunk, type, data, size);
+    file_.write((char const *) chunk.data(), chunk.size());
+    if (!file_) { return _encodeError(79); }
+    return true;
+  }
+
+  unsigned encodeParallel(std::vector<unsigned char> & out, HSLAPixel const * pixels,
+                          unsigned int width, unsigned int height, int compressionLevel, ThreadPool & pool) {
+    if (width == 0 || height == 0) { return 93; }
+
+    LodePNGCompressSettings settings;
+    lodepng_compress_settings_init(&settings);
+    setCompressionLevel(settings, compressionLevel);
+
+    unsigned rowsPerBand = std::max<std::size_t>(1, kBytesPerBand / 2 / (std::size_t(width) * 4 + 1));
+    unsigned bands = (height + rowsPerBand - 1) / rowsPerBand;
+
+    // Like lodepng, leave out the alpha channel when every pixel is opaque.
+    std::vector<unsigned char> opaque(bands, 1);
+    pool.parallelFor(0, bands, 1, [&](unsigned b0, unsigned b1) {
+      for (unsigned band = b0; band < b1; band++) {
+        HSLAPixel const * begin = pixels + std::size_t(band) * rowsPerBand * width;
+        HSLAPixel const * end = pixels + std::size_t(std::min(height, (band + 1) * rowsPerBand)) * width;
+        for (HSLAPixel const * pixel = begin; pixel != end && opaque[band]; pixel++) {
+          opaque[band] = ((unsigned char) round(pixel->a * 255) == 255);
+        }
+      }
+    });
+    bool rgb = std::find(opaque.begin(), opaque.end(), 0) == opaque.end();
+
+    std::size_t bytesPerPixel = rgb ? 3 : 4;
+    std::size_t lineBytes = std::size_t(width) * bytesPerPixel;
+    std::size_t filteredLine = lineBytes + 1;
+
+    // Convert and filter every band. A band only needs the unfiltered row
+    // above it, which is converted again rather than shared.
+    std::vector<unsigned char> filtered(filteredLine * height);
+    std::vector<unsigned> errors(bands, 0);
+    pool.parallelFor(0, bands, 1, [&](unsigned b0, unsigned b1) {
+      std::vector<unsigned char> current(std::size_t(width) * 4), previous(std::size_t(width) * 4);
+      auto convert = [&](unsigned y, std::vector<unsigned char> & row) {
+        hsl2rgbBatch(pixels + std::size_t(y) * width, row.data(), width);
+        if (rgb) {
+          for (std::size_t x = 0; x < width; x++) { std::copy(&row[x * 4], &row[x * 4 + 3], &row[x * 3]); }
+        }
+      };
+
+      for (unsigned band = b0; band < b1; band++) {
+        unsigned y0 = band * rowsPerBand;
+        unsigned y1 = std::min(height, y0 + rowsPerBand);
+        if (y0 > 0) { convert(y0 - 1, previous); }
+        for (unsigned y = y0; y < y1 && !errors[band]; y++) {
+          convert(y, current);
+          errors[band] = lodepng_filter_scanline(&filtered[y * filteredLine], current.data(),
+                                                 (y > 0) ? previous.data() : 0, lineBytes, bytesPerPixel,
+                                                 LFS_MINSUM);
+          std::swap(current, previous);
+        }
+      }
+    });
+    for (unsigned error : errors) { if (error) { return error; } }
+
+    // Compress every band with the bytes before it as the dictionary.
+    std::vector< std::vector<unsigned char> > parts(bands);
+    pool.parallelFor(0, bands, 1, [&](unsigned b0, unsigned b1) {
+      for (unsigned band = b0; band < b1; band++) {
+        std::size_t start = std::size_t(band) * rowsPerBand * filteredLine;
+        std::size_t end = std::min(filtered.size(), start + std::size_t(rowsPerBand) * filteredLine);
+        std::size_t dictionary = std::min(start, kDictionaryBytes);
+
+        unsigned char * deflated = 0;
+        std::size_t deflatedSize = 0;
+        errors[band] = lodepng_deflate_part(&deflated, &deflatedSize, &filtered[start - dictionary],
+                                            dictionary, end - start + dictionary,
+                                            band == bands - 1 ? 1 : 0, &settings);
+        if (!errors[band]) { parts[band].assign(deflated, deflated + deflatedSize); }
+        std::free(deflated);
+      }
+    });
+    for (unsigned error : errors) { if (error) { return error; } }
+
+    unsigned adler = lodepng_update_adler32(1, filtered.data(), filtered.size());
+
+    // One IDAT chunk per band; together they are a single zlib stream.
+    out.clear();
+    _appendHeader(out, width, height, rgb ? LCT_RGB : LCT_RGBA);
+    for (unsigned band = 0; band < bands; band++) {
+      std::vector<unsigned char> & idat = parts[band];
+      if (band == 0) { idat.insert(idat.begin(), kZlibHeader, kZlibHeader + sizeof(kZlibHeader)); }
+      if (band == bands - 1) {
+        idat.resize(idat.size() + 4);
+        _write32(&idat[idat.size() - 4], adler);
+      }
+      _appendChunk(out, "IDAT", idat.data(), idat.size());
+      std::vector<unsigned char>().swap(idat);
+    }
+    _appendChunk(out, "IEND", 0, 0);
+    return 0;
+  }
+}
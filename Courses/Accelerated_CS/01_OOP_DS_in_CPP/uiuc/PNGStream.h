@@ -0,0 +1,208 @@
+/**
+ * @file PNGStream.h
+ * Reading and writing PNG files a band of rows at a time, so that an image
+ * never has to be held in memory all at once.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "lodepng/lodepng.h"
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  class PNGStreamReader {
+  public:
+    /**
+      * Receives the next band of decoded rows. `pixels` holds `rows` full
+      * rows, top to bottom, the first of which is row `y` of the image. The
+      * pixels may be changed in place; they are only valid during the call.
+      * Return false to stop reading.
+      */
+    typedef std::function<bool(HSLAPixel * pixels, unsigned int y, unsigned int rows)> RowCallback;
+
+    /**
+      * Creates a reader with no file open.
+      */
+    PNGStreamReader();
+
+    ~PNGStreamReader();
+
+    /**
+      * Opens a PNG file and reads everything but the pixels: the header, the
+      * palette and the compressed image data.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the file was successfully opened.
+      */
+    bool open(std::string const & fileName);
+
+    /**
+      * Opens a PNG file that is already in memory. Nothing is copied except
+      * the compressed image data when it is split over several IDAT chunks,
+      * so the buffer must stay valid until read returns.
+      * @param data The contents of the PNG file.
+      * @param size The size of the file in bytes.
+      * @return true, if the file was successfully opened.
+      */
+    bool open(unsigned char const * data, std::size_t size);
+
+    /**
+      * Gets the width of the opened image.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of the opened image.
+      */
+    unsigned int height() const;
+
+    /**
+      * Decodes the image and hands it to `callback` one band of rows at a
+      * time. Only the current band and the deflate window are held in memory.
+      * Interlaced files cannot be decoded in rows and are decoded whole.
+      * @param callback Called with each band of rows, in order.
+      * @return true, if the whole image was decoded and passed on.
+      */
+    bool read(RowCallback const & callback);
+
+  private:
+    std::string fileName_;                  /*< Name of the opened file */
+    unsigned char const * memory_;          /*< Contents of the opened file, if opened from memory */
+    std::size_t memorySize_;                /*< Size of memory_ */
+    unsigned int width_;                    /*< Width of the image */
+    unsigned int height_;                   /*< Height of the image */
+    LodePNGState state_;                    /*< Header and palette of the file */
+    std::vector<unsigned char> idat_;       /*< Compressed image data, when it had to be copied */
+    unsigned char const * compressed_;      /*< Compressed image data */
+    std::size_t compressedSize_;            /*< Size of compressed_ */
+
+    // State while decoding
+    RowCallback const * callback_;          /*< Receives the decoded bands */
+    std::vector<unsigned char> scanline_;   /*< Filtered scanline being filled in */
+    std::vector<unsigned char> current_;    /*< Unfiltered current scanline */
+    std::vector<unsigned char> previous_;   /*< Unfiltered previous scanline */
+    std::vector<unsigned char> rgba_;       /*< Band of RGBA rows */
+    std::vector<HSLAPixel> band_;           /*< Band of HSLA rows */
+    std::size_t filled_;                    /*< Bytes of scanline_ filled in */
+    unsigned int bandRows_;                 /*< Rows held in rgba_ */
+    unsigned int rowsPerBand_;              /*< Rows rgba_ can hold */
+    unsigned int y_;                        /*< Image row of the first row in rgba_ */
+
+    PNGStreamReader(PNGStreamReader const &);
+    PNGStreamReader & operator=(PNGStreamReader const &);
+
+    /**
+     * Forgets the opened image.
+     */
+    void _reset();
+
+    /**
+     * Receives decompressed image data from lodepng.
+     */
+    static unsigned _receive(unsigned char const * data, std::size_t size, void * context);
+
+    /**
+     * Converts the rows in rgba_ to HSLA and hands them to the callback.
+     */
+    bool _deliver();
+  };
+
+  class PNGStreamWriter {
+  public:
+    /**
+      * Creates a writer with no file open.
+      */
+    PNGStreamWriter();
+
+    /**
+      * Closes the file, if it is still open. An image that was not finished
+      * is left incomplete.
+      */
+    ~PNGStreamWriter();
+
+    /**
+      * Creates a PNG file and writes its header.
+      * @param fileName Name of the file to be written.
+      * @param width Width of the image.
+      * @param height Height of the image.
+      * @param options Settings to write with. Only the compression level is
+      *                used; rows are compressed as they arrive.
+      * @return true, if the file was successfully created.
+      */
+    bool open(std::string const & fileName, unsigned int width, unsigned int height,
+              PNGWriteOptions const & options = PNGWriteOptions());
+
+    /**
+      * Appends rows to the image. Rows are filtered and buffered, and are
+      * compressed and written out about a megabyte at a time.
+      * @param pixels `rows` full rows of pixels, top to bottom.
+      * @param rows Number of rows.
+      * @return true, if the rows were successfully written.
+      */
+    bool writeRows(HSLAPixel const * pixels, unsigned int rows);
+
+    /**
+      * Writes the rest of the image and closes the file. All rows of the
+      * image must have been written.
+      * @return true, if the file was successfully completed.
+      */
+    bool close();
+
+  private:
+    std::ofstream file_;                    /*< File being written */
+    unsigned int width_;                    /*< Width of the image */
+    unsigned int height_;                   /*< Height of the image */
+    unsigned int rowsWritten_;              /*< Rows written so far */
+    unsigned int adler_;                    /*< Adler-32 of the filtered data */
+    bool headerWritten_;                    /*< Whether the zlib header was written */
+    LodePNGCompressSettings settings_;      /*< Deflate settings */
+    std::vector<unsigned char> current_;    /*< RGBA current row */
+    std::vector<unsigned char> previous_;   /*< RGBA previous row */
+    std::vector<unsigned char> filtered_;   /*< Dictionary followed by filtered rows */
+    std::size_t dictionary_;                /*< Bytes of filtered_ that are dictionary */
+
+    PNGStreamWriter(PNGStreamWriter const &);
+    PNGStreamWriter & operator=(PNGStreamWriter const &);
+
+    /**
+     * Compresses the buffered rows into an IDAT chunk.
+     */
+    bool _flush(bool final);
+
+    /**
+     * Writes one chunk to the file.
+     */
+    bool _writeChunk(char const * type, unsigned char const * data, std::size_t size);
+  };
+
+  /**
+   * Sets deflate settings for a compression level from 0 to 9, as described
+   * for PNGWriteOptions.
+   * @param settings The settings to change.
+   * @param level The compression level; out of range levels are clamped.
+   */
+  void setCompressionLevel(LodePNGCompressSettings & settings, int level);
+
+  /**
+   * Encodes an image as an 8-bit RGBA PNG file in memory, or RGB if every
+   * pixel is opaque. The image is split
+   * into bands of rows, which are converted, filtered and compressed on the
+   * thread pool. Each band is compressed with the end of the band above it
+   * as its dictionary, and all bands form one zlib stream, so the file is
+   * nearly as small as a serial encode.
+   * @param out Receives the encoded file.
+   * @param pixels The width * height pixels of the image, in row-major order.
+   * @param width Width of the image.
+   * @param height Height of the image.
+   * @param compressionLevel Compression level from 0 to 9.
+   * @param pool Thread pool to encode on.
+   * @return 0 on success, or a lodepng error code.
+   */
+  unsigned encodeParallel(std::vector<unsigned char> & out, HSLAPixel const * pixels,
+                          unsigned int width, unsigned int height, int compressionLevel, ThreadPool & pool);
+}
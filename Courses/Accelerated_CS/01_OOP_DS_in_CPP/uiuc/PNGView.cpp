@@ -0,0 +1,129 @@
+/**
+ * @file PNGView.cpp
+ * Implementation of views of PNG images and of the tile scheduler.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "PNGView.h"
+
+namespace uiuc {
+  /**
+   * Clips the span [begin, begin + length) to [0, limit), storing the
+   * clipped start and length.
+   */
+  static void _clip(long long begin, long long length, unsigned int limit,
+                    unsigned int & clippedBegin, unsigned int & clippedLength) {
+    long long end = std::min(begin + length, (long long)limit);
+    begin = std::max(begin, 0LL);
+    if (end <= begin) {
+      clippedBegin = 0;
+      clippedLength = 0;
+      return;
+    }
+    clippedBegin = (unsigned)begin;
+    clippedLength = (unsigned)(end - begin);
+  }
+
+  PNGView::PNGView() : image_(NULL), x_(0), y_(0), width_(0), height_(0) { }
+
+  PNGView::PNGView(PNG & image)
+    : image_(&image), x_(0), y_(0), width_(image.width()), height_(image.height()) { }
+
+  PNGView::PNGView(PNG & image, int x, int y, unsigned int width, unsigned int height) : image_(&image) {
+    _clip(x, width, image.width(), x_, width_);
+    _clip(y, height, image.height(), y_, height_);
+    if (width_ == 0 || height_ == 0) { x_ = y_ = width_ = height_ = 0; }
+  }
+
+  PNGView PNGView::view(int x, int y, unsigned int width, unsigned int height) const {
+    PNGView view;
+    view.image_ = image_;
+    _clip(x, width, width_, view.x_, view.width_);
+    _clip(y, height, height_, view.y_, view.height_);
+    if (view.width_ == 0 || view.height_ == 0) {
+      view.x_ = view.y_ = view.width_ = view.height_ = 0;
+    } else {
+      view.x_ += x_;
+      view.y_ += y_;
+    }
+    return view;
+  }
+
+  unsigned int PNGView::x() const {
+    return x_;
+  }
+
+  unsigned int PNGView::y() const {
+    return y_;
+  }
+
+  unsigned int PNGView::width() const {
+    return width_;
+  }
+
+  unsigned int PNGView::height() const {
+    return height_;
+  }
+
+  bool PNGView::empty() const {
+    return width_ == 0 || height_ == 0;
+  }
+
+  PNG * PNGView::image() const {
+    return image_;
+  }
+
+  HSLAPixel * PNGView::row(unsigned int y) const {
+    assert(y < height_);
+    return image_->row(y_ + y) + x_;
+  }
+
+  HSLAPixel & PNGView::getPixel(unsigned int x, unsigned int y) const {
+    assert(x < width_);
+    return row(y)[x];
+  }
+
+  PNG PNGView::toPNG() const {
+    PNG png(width_, height_);
+    for (unsigned y = 0; y < height_; y++) {
+      std::copy(row(y), row(y) + width_, png.row(y));
+    }
+    return png;
+  }
+
+  TileScheduler::TileScheduler(unsigned int tileWidth, unsigned int tileHeight)
+    : pool_(&ThreadPool::shared()), tileWidth_(std::max(1u, tileWidth)), tileHeight_(std::max(1u, tileHeight)) { }
+
+  TileScheduler::TileScheduler(ThreadPool & pool, unsigned int tileWidth, unsigned int tileHeight)
+    : pool_(&pool), tileWidth_(std::max(1u, tileWidth)), tileHeight_(std::max(1u, tileHeight)) { }
+
+  std::vector<PNGView> TileScheduler::tiles(PNGView const & view) const {
+    std::vector<PNGView> tiles;
+    for (unsigned y = 0; y < view.height(); y += tileHeight_) {
+      for (unsigned x = 0; x < view.width(); x += tileWidth_) {
+        tiles.push_back(view.view(x, y, tileWidth_, tileHeight_));
+      }
+    }
+    return tiles;
+  }
+
+  void TileScheduler::run(PNGView const & view, TileFunction const & function) const {
+    run(std::vector<PNGView>(1, view), function);
+  }
+
+  void TileScheduler::run(std::vector<PNGView> const & views, TileFunction const & function) const {
+    std::vector<PNGView> all;
+    for (PNGView const & view : views) {
+      std::vector<PNGView> viewTiles = tiles(view);
+      all.insert(all.end(), viewTiles.begin(), viewTiles.end());
+    }
+    if (all.empty()) { return; }
+
+    pool_->parallelFor(0, all.size(), 1, [&](unsigned t0, unsigned t1) {
+      for (unsigned t = t0; t < t1; t++) {
+        function(all[t]);
+      }
+    });
+  }
+}
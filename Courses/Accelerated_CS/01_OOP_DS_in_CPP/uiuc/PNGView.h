@@ -0,0 +1,162 @@
+/**
+ * @file PNGView.h
+ * Rectangular regions of a PNG image that share its pixels, and a scheduler
+ * that splits regions into tiles and spreads them over a thread pool, so
+ * that work can be limited to the part of an image that changed.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  class PNGView {
+  public:
+    /**
+      * Creates an empty view of no image.
+      */
+    PNGView();
+
+    /**
+      * Creates a view of a whole image.
+      * @param image The image to view. It must outlive the view, and must
+      *              not be resized while the view is in use.
+      */
+    explicit PNGView(PNG & image);
+
+    /**
+      * Creates a view of a rectangle of an image. The rectangle is clipped
+      * to the image, so it may be partly or wholly outside of it.
+      * @param image The image to view.
+      * @param x Image x-coordinate of the left edge of the rectangle.
+      * @param y Image y-coordinate of the top edge of the rectangle.
+      * @param width Width of the rectangle.
+      * @param height Height of the rectangle.
+      */
+    PNGView(PNG & image, int x, int y, unsigned int width, unsigned int height);
+
+    /**
+      * Creates a view of a rectangle within this view, clipped to this view.
+      * @param x X-coordinate of the left edge, relative to this view.
+      * @param y Y-coordinate of the top edge, relative to this view.
+      * @param width Width of the rectangle.
+      * @param height Height of the rectangle.
+      * @return The view of the rectangle.
+      */
+    PNGView view(int x, int y, unsigned int width, unsigned int height) const;
+
+    /**
+      * Gets the image x-coordinate of the left edge of the view.
+      */
+    unsigned int x() const;
+
+    /**
+      * Gets the image y-coordinate of the top edge of the view.
+      */
+    unsigned int y() const;
+
+    /**
+      * Gets the width of the view.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of the view.
+      */
+    unsigned int height() const;
+
+    /**
+      * Checks if the view holds no pixels.
+      */
+    bool empty() const;
+
+    /**
+      * Gets the image the view is of, or NULL for a view of no image.
+      */
+    PNG * image() const;
+
+    /**
+      * Gets the pixels of one row of the view: width() consecutive pixels,
+      * in the image's own memory. Like PNG::row, this is not bounds checked.
+      * @param y Y-coordinate of the row, relative to the view.
+      * @return A pointer to the leftmost pixel of the row.
+      */
+    HSLAPixel * row(unsigned int y) const;
+
+    /**
+      * Gets the pixel at coordinates relative to the view, which must be in
+      * the view.
+      */
+    HSLAPixel & getPixel(unsigned int x, unsigned int y) const;
+
+    /**
+      * Copies the pixels of the view into a new image.
+      */
+    PNG toPNG() const;
+
+  private:
+    PNG * image_;                   /*< Image the view is of */
+    unsigned int x_;                /*< Image x-coordinate of the left edge */
+    unsigned int y_;                /*< Image y-coordinate of the top edge */
+    unsigned int width_;            /*< Width of the view */
+    unsigned int height_;           /*< Height of the view */
+  };
+
+  class TileScheduler {
+  public:
+    /**
+      * Work on one tile. Tiles never overlap, so a tile's pixels may be
+      * changed in place, but tiles are run concurrently.
+      */
+    typedef std::function<void(PNGView const & tile)> TileFunction;
+
+    /**
+      * Creates a scheduler that runs on the shared thread pool.
+      * @param tileWidth Width of each tile; tiles on the right edge may be
+      *                  narrower.
+      * @param tileHeight Height of each tile; tiles on the bottom edge may
+      *                   be shorter.
+      */
+    TileScheduler(unsigned int tileWidth = 256, unsigned int tileHeight = 64);
+
+    /**
+      * Creates a scheduler that runs on the given thread pool.
+      * @param pool Thread pool to run on. It must outlive the scheduler.
+      */
+    TileScheduler(ThreadPool & pool, unsigned int tileWidth = 256, unsigned int tileHeight = 64);
+
+    /**
+      * Splits a view into tiles, left to right and top to bottom.
+      * @param view The view to split.
+      * @return The tiles, which cover the view exactly.
+      */
+    std::vector<PNGView> tiles(PNGView const & view) const;
+
+    /**
+      * Calls `function` for every tile of a view, in parallel, and returns
+      * once every tile is done.
+      * @param view The view to process.
+      * @param function The work to do on each tile.
+      */
+    void run(PNGView const & view, TileFunction const & function) const;
+
+    /**
+      * Calls `function` for every tile of several views, such as the dirty
+      * rectangles of a frame, spreading the tiles of all of them over the
+      * pool at once. The views must not overlap, or their shared pixels
+      * would be processed more than once.
+      * @param views The views to process.
+      * @param function The work to do on each tile.
+      */
+    void run(std::vector<PNGView> const & views, TileFunction const & function) const;
+
+  private:
+    ThreadPool * pool_;             /*< Pool the tiles are spread over */
+    unsigned int tileWidth_;        /*< Width of a full tile */
+    unsigned int tileHeight_;       /*< Height of a full tile */
+  };
+}
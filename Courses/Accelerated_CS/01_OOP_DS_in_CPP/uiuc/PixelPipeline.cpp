@@ -0,0 +1,84 @@
+/**
+ * @file PixelPipeline.cpp
+ * Implementation of a fused, multi-threaded chain of per-pixel operations.
+ */
+
+#include <algorithm>
+#include "PixelPipeline.h"
+#include "PNGStream.h"
+
+namespace uiuc {
+  PixelPipeline::PixelPipeline() : pool_(&ThreadPool::shared()) { }
+
+  PixelPipeline::PixelPipeline(ThreadPool & pool) : pool_(&pool) { }
+
+  PixelPipeline & PixelPipeline::addStage(Stage stage) {
+    stages_.push_back(stage);
+    return *this;
+  }
+
+  unsigned int PixelPipeline::stages() const {
+    return stages_.size();
+  }
+
+  void PixelPipeline::apply(PNG & image) const {
+    if (image.width() == 0 || image.height() == 0) { return; }
+    apply(image.data(), image.width(), 0, image.height());
+  }
+
+  void PixelPipeline::apply(HSLAPixel * pixels, unsigned int width, unsigned int y, unsigned int rows) const {
+    if (width == 0 || rows == 0 || stages_.empty()) { return; }
+
+    pool_->parallelFor(0, rows, ThreadPool::rowsPerChunk(width), [&](unsigned r0, unsigned r1) {
+      for (unsigned r = r0; r < r1; r++) {
+        _applyRow(pixels + std::size_t(r) * width, 0, y + r, width);
+      }
+    });
+  }
+
+  void PixelPipeline::apply(PNGView const & view) const {
+    if (view.empty() || stages_.empty()) { return; }
+
+    pool_->parallelFor(0, view.height(), ThreadPool::rowsPerChunk(view.width()), [&](unsigned r0, unsigned r1) {
+      for (unsigned r = r0; r < r1; r++) {
+        _applyRow(view.row(r), view.x(), view.y() + r, view.width());
+      }
+    });
+  }
+
+  void PixelPipeline::apply(std::vector<PNGView> const & views, TileScheduler const & scheduler) const {
+    if (stages_.empty()) { return; }
+
+    scheduler.run(views, [this](PNGView const & tile) {
+      for (unsigned r = 0; r < tile.height(); r++) {
+        _applyRow(tile.row(r), tile.x(), tile.y() + r, tile.width());
+      }
+    });
+  }
+
+  PNG PixelPipeline::operator()(PNG image) const {
+    apply(image);
+    return image;
+  }
+
+  void PixelPipeline::_applyRow(HSLAPixel * pixels, unsigned int x, unsigned int y, unsigned int count) const {
+    for (Stage const & stage : stages_) {
+      stage(pixels, x, y, count);
+    }
+  }
+
+  bool PixelPipeline::applyToFile(std::string const & inFile, std::string const & outFile) const {
+    PNGStreamReader reader;
+    if (!reader.open(inFile)) { return false; }
+
+    PNGStreamWriter writer;
+    if (!writer.open(outFile, reader.width(), reader.height())) { return false; }
+
+    unsigned width = reader.width();
+    bool read = reader.read([&](HSLAPixel * pixels, unsigned y, unsigned rows) {
+      apply(pixels, width, y, rows);
+      return writer.writeRows(pixels, rows);
+    });
+    return writer.close() && read;
+  }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file PixelPipeline.h
+ * A chain of per-pixel image operations that is applied in a single
+ * row-major pass over the image, with the rows split across a thread pool.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "PNGView.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  class PixelPipeline {
+  public:
+    /**
+      * One operation of the pipeline. It is called with a pointer to `count`
+      * consecutive pixels of one row, the first of which is at image
+      * coordinates (`x`, `y`), and changes them in place. Stages are called
+      * concurrently for different rows, so they must not keep mutable state.
+      */
+    typedef std::function<void(HSLAPixel * pixels, unsigned int x, unsigned int y, unsigned int count)> Stage;
+
+    /**
+      * Creates an empty pipeline that runs on the shared thread pool.
+      */
+    PixelPipeline();
+
+    /**
+      * Creates an empty pipeline that runs on the given thread pool.
+      * @param pool Thread pool to run on. It must outlive the pipeline.
+      */
+    explicit PixelPipeline(ThreadPool & pool);
+
+    /**
+      * Appends an operation to the end of the pipeline.
+      * @param stage The operation to append.
+      * @return The current pipeline for chaining.
+      */
+    PixelPipeline & addStage(Stage stage);
+
+    /**
+      * Gets the number of operations in the pipeline.
+      */
+    unsigned int stages() const;
+
+    /**
+      * Runs every operation of the pipeline, in order, over the image in
+      * place. Each row is passed through all of the operations while it is
+      * still in cache before moving on to the next row.
+      * @param image The image to be modified.
+      */
+    void apply(PNG & image) const;
+
+    /**
+      * Runs every operation of the pipeline over the pixels of a view in
+      * place, leaving the rest of the image unchanged. Stages are passed
+      * image coordinates, so a view gets exactly what a whole image would
+      * within it.
+      * @param view The region of an image to be modified.
+      */
+    void apply(PNGView const & view) const;
+
+    /**
+      * Runs the pipeline over a region of an image, such as a rectangle
+      * that changed, split into tiles that are spread over the thread pool.
+      * The views must not overlap.
+      * @param views The regions of an image to be modified.
+      * @param scheduler How to split the regions into tiles.
+      */
+    void apply(std::vector<PNGView> const & views, TileScheduler const & scheduler) const;
+
+    /**
+      * Runs the pipeline over an image and returns the result.
+      * @param image The image to be transformed.
+      * @return The transformed image.
+      */
+    PNG operator() (PNG image) const;
+
+    /**
+      * Runs the pipeline over a band of consecutive full rows of an image in
+      * place, splitting the rows across the thread pool.
+      * @param pixels The rows of pixels, top to bottom.
+      * @param width Width of each row.
+      * @param y Image row of the first row in `pixels`.
+      * @param rows Number of rows.
+      */
+    void apply(HSLAPixel * pixels, unsigned int width, unsigned int y, unsigned int rows) const;
+
+    /**
+      * Runs the pipeline over a PNG file and writes the result to another
+      * file, a band of rows at a time, so that the image never has to fit in
+      * memory.
+      * @param inFile Name of the file to be read from.
+      * @param outFile Name of the file to be written.
+      * @return true, if the image was successfully read, transformed and written.
+      */
+    bool applyToFile(std::string const & inFile, std::string const & outFile) const;
+
+  private:
+    std::vector<Stage> stages_;     /*< Operations, in the order they run */
+    ThreadPool * pool_;             /*< Pool the rows are split across */
+
+    /**
+     * Runs every stage over `count` pixels of one row.
+     */
+    void _applyRow(HSLAPixel * pixels, unsigned int x, unsigned int y, unsigned int count) const;
+  };
+}
@@ -0,0 +1,187 @@
+/**
+ * @file RGBAImage.cpp
+ * Implementation of a compact PNG image that stores RGBA bytes and converts
+ * to HSLA on demand.
+ */
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include "lodepng/lodepng.h"
+#include "RGBAImage.h"
+
+namespace uiuc {
+  static HSLAPixel _toHSLA(unsigned char const * rgba) {
+    rgbaColor rgb;
+    rgb.r = rgba[0];
+    rgb.g = rgba[1];
+    rgb.b = rgba[2];
+    rgb.a = rgba[3];
+
+    hslaColor hsl = rgb2hsl(rgb);
+    HSLAPixel pixel;
+    pixel.h = hsl.h;
+    pixel.s = hsl.s;
+    pixel.l = hsl.l;
+    pixel.a = hsl.a;
+    return pixel;
+  }
+
+  static void _toRGBA(HSLAPixel const & pixel, unsigned char * rgba) {
+    hslaColor hsl;
+    hsl.h = pixel.h;
+    hsl.s = pixel.s;
+    hsl.l = pixel.l;
+    hsl.a = pixel.a;
+
+    rgbaColor rgb = hsl2rgb(hsl);
+    rgba[0] = rgb.r;
+    rgba[1] = rgb.g;
+    rgba[2] = rgb.b;
+    rgba[3] = rgb.a;
+  }
+
+  RGBAImage::PixelRef::PixelRef(unsigned char * rgba) : rgba_(rgba) { }
+
+  RGBAImage::PixelRef::operator HSLAPixel() const {
+    return _toHSLA(rgba_);
+  }
+
+  RGBAImage::PixelRef & RGBAImage::PixelRef::operator=(HSLAPixel const & pixel) {
+    _toRGBA(pixel, rgba_);
+    return *this;
+  }
+
+  RGBAImage::PixelRef & RGBAImage::PixelRef::operator=(PixelRef const & other) {
+    std::copy(other.rgba_, other.rgba_ + 4, rgba_);
+    return *this;
+  }
+
+  RGBAImage::RGBAImage() {
+    width_ = 0;
+    height_ = 0;
+  }
+
+  RGBAImage::RGBAImage(unsigned int width, unsigned int height) {
+    width_ = width;
+    height_ = height;
+    bytes_.assign(std::size_t(width) * height * 4, 0);
+  }
+
+  RGBAImage::RGBAImage(PNG const & png) {
+    width_ = png.width();
+    height_ = png.height();
+    bytes_.resize(std::size_t(width_) * height_ * 4);
+    hsl2rgbBatch(png.data(), bytes_.data(), std::size_t(width_) * height_);
+  }
+
+  bool RGBAImage::operator==(RGBAImage const & other) const {
+    return width_ == other.width_ && height_ == other.height_ && bytes_ == other.bytes_;
+  }
+
+  bool RGBAImage::operator!=(RGBAImage const & other) const {
+    return !(*this == other);
+  }
+
+  bool RGBAImage::readFromFile(string const & fileName) {
+    vector<unsigned char> byteData;
+    unsigned width, height;
+    unsigned error = lodepng::decode(byteData, width, height, fileName);
+
+    if (error) {
+      cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << endl;
+      return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    bytes_.swap(byteData);
+    return true;
+  }
+
+  bool RGBAImage::writeToFile(string const & fileName) const {
+    unsigned error = lodepng::encode(fileName, bytes_, width_, height_);
+    if (error) {
+      cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << endl;
+    }
+    return (error == 0);
+  }
+
+  std::size_t RGBAImage::_offset(unsigned int x, unsigned int y) const {
+    if (width_ == 0 || height_ == 0) {
+      cerr << "ERROR: Call to uiuc::RGBAImage pixel access made on an image with no pixels." << endl;
+      assert(width_ > 0);
+      assert(height_ > 0);
+    }
+
+    if (x >= width_) {
+      cerr << "WARNING: Call to uiuc::RGBAImage pixel access (" << x << "," << y << ") tries to access x=" << x
+          << ", which is outside of the image (image width: " << width_ << ")." << endl;
+      cerr << "       : Truncating x to " << (width_ - 1) << endl;
+      x = width_ - 1;
+    }
+
+    if (y >= height_) {
+      cerr << "WARNING: Call to uiuc::RGBAImage pixel access (" << x << "," << y << ") tries to access y=" << y
+          << ", which is outside of the image (image height: " << height_ << ")." << endl;
+      cerr << "       : Truncating y to " << (height_ - 1) << endl;
+      y = height_ - 1;
+    }
+
+    return (x + (std::size_t(y) * width_)) * 4;
+  }
+
+  HSLAPixel RGBAImage::getPixel(unsigned int x, unsigned int y) const {
+    return _toHSLA(&bytes_[_offset(x, y)]);
+  }
+
+  void RGBAImage::setPixel(unsigned int x, unsigned int y, HSLAPixel const & pixel) {
+    _toRGBA(pixel, &bytes_[_offset(x, y)]);
+  }
+
+  RGBAImage::PixelRef RGBAImage::pixel(unsigned int x, unsigned int y) {
+    return PixelRef(&bytes_[_offset(x, y)]);
+  }
+
+  rgbaColor RGBAImage::getRGBA(unsigned int x, unsigned int y) const {
+    unsigned char const * rgba = &bytes_[_offset(x, y)];
+    rgbaColor rgb;
+    rgb.r = rgba[0];
+    rgb.g = rgba[1];
+    rgb.b = rgba[2];
+    rgb.a = rgba[3];
+    return rgb;
+  }
+
+  void RGBAImage::setRGBA(unsigned int x, unsigned int y, rgbaColor rgba) {
+    unsigned char * bytes = &bytes_[_offset(x, y)];
+    bytes[0] = rgba.r;
+    bytes[1] = rgba.g;
+    bytes[2] = rgba.b;
+    bytes[3] = rgba.a;
+  }
+
+  unsigned char * RGBAImage::data() {
+    return bytes_.data();
+  }
+
+  unsigned char const * RGBAImage::data() const {
+    return bytes_.data();
+  }
+
+  PNG RGBAImage::toPNG() const {
+    PNG png(width_, height_);
+    rgb2hslBatch(bytes_.data(), png.data(), std::size_t(width_) * height_);
+    return png;
+  }
+
+  unsigned int RGBAImage::width() const {
+    return width_;
+  }
+
+  unsigned int RGBAImage::height() const {
+    return height_;
+  }
+
+}
@@ -0,0 +1,182 @@
+/**
+ * @file RGBAImage.h
+ * A compact PNG image that stores its pixels in the native 8-bit RGBA form
+ * used by lodepng, converting to and from HSLA only when a pixel is read or
+ * written through the HSLA accessors.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "RGB_HSL.h"
+
+namespace uiuc {
+  class RGBAImage {
+  public:
+    /**
+      * Proxy for a single pixel of an RGBAImage. Reading it converts the
+      * stored RGBA bytes to an HSLAPixel; assigning an HSLAPixel to it
+      * converts back and stores the result as RGBA bytes.
+      */
+    class PixelRef {
+    public:
+      /**
+        * Converts the stored RGBA value to HSLA.
+        */
+      operator HSLAPixel() const;
+
+      /**
+        * Converts `pixel` to RGBA and stores it.
+        * @param pixel The HSLA value to store.
+        * @return This proxy, for assignment chaining.
+        */
+      PixelRef & operator= (HSLAPixel const & pixel);
+
+      /**
+        * Copies the value of another pixel proxy into this pixel.
+        * @param other The proxy for the pixel to be copied.
+        * @return This proxy, for assignment chaining.
+        */
+      PixelRef & operator= (PixelRef const & other);
+
+    private:
+      friend class RGBAImage;
+      explicit PixelRef(unsigned char * rgba);
+
+      unsigned char * rgba_;        /*< The four RGBA bytes of the pixel */
+    };
+
+    /**
+      * Creates an empty image.
+      */
+    RGBAImage();
+
+    /**
+      * Creates an image of the specified dimensions. All pixels start as
+      * transparent black.
+      * @param width Width of the new image.
+      * @param height Height of the new image.
+      */
+    RGBAImage(unsigned int width, unsigned int height);
+
+    /**
+      * Creates an image holding the RGBA form of an HSLA image. The result
+      * is the same image that `png.writeToFile` would have written.
+      * @param png Image to be converted.
+      */
+    explicit RGBAImage(PNG const & png);
+
+    /**
+      * Equality operator: checks if two images have the same RGBA bytes.
+      * @param other Image to be checked.
+      * @return Whether the current image is equal to the other image.
+      */
+    bool operator== (RGBAImage const & other) const;
+
+    /**
+      * Inequality operator: checks if two images are different.
+      * @param other Image to be checked.
+      * @return Whether the current image differs from the other image.
+      */
+    bool operator!= (RGBAImage const & other) const;
+
+    /**
+      * Reads in a PNG image from a file. The decoded bytes are kept as-is,
+      * so no color conversion is done.
+      * Overwrites any current image content.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromFile(string const & fileName);
+
+    /**
+      * Writes the image to a PNG file. The stored bytes are encoded as-is,
+      * so no color conversion is done.
+      * @param fileName Name of the file to be written.
+      * @return true, if the image was successfully written.
+      */
+    bool writeToFile(string const & fileName) const;
+
+    /**
+      * Gets the HSLA value of the pixel at the given coordinates, converting
+      * it from RGBA. (0,0) is the upper left corner. Coordinates outside of
+      * the image are truncated, as with PNG::getPixel.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @return The pixel converted to HSLA.
+      */
+    HSLAPixel getPixel(unsigned int x, unsigned int y) const;
+
+    /**
+      * Converts an HSLA value to RGBA and stores it at the given coordinates.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @param pixel The HSLA value to store.
+      */
+    void setPixel(unsigned int x, unsigned int y, HSLAPixel const & pixel);
+
+    /**
+      * Gets an HSLA proxy for the pixel at the given coordinates, so that
+      * `image.pixel(x, y) = hsla` and `HSLAPixel p = image.pixel(x, y)`
+      * both work.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @return A proxy referring to the pixel.
+      */
+    PixelRef pixel(unsigned int x, unsigned int y);
+
+    /**
+      * Gets the stored RGBA value of the pixel at the given coordinates.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @return The stored RGBA value.
+      */
+    rgbaColor getRGBA(unsigned int x, unsigned int y) const;
+
+    /**
+      * Stores an RGBA value at the given coordinates.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @param rgba The RGBA value to store.
+      */
+    void setRGBA(unsigned int x, unsigned int y, rgbaColor rgba);
+
+    /**
+      * Gets the raw RGBA bytes, four per pixel in row-major order.
+      */
+    unsigned char * data();
+    unsigned char const * data() const;
+
+    /**
+      * Converts the whole image to an HSLA PNG. The result is the same image
+      * that PNG::readFromFile would have produced from the same bytes.
+      */
+    PNG toPNG() const;
+
+    /**
+      * Gets the width of this image.
+      * @return Width of the image.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of this image.
+      * @return Height of the image.
+      */
+    unsigned int height() const;
+
+  private:
+    unsigned int width_;            /*< Width of the image */
+    unsigned int height_;           /*< Height of the image */
+    vector<unsigned char> bytes_;   /*< RGBA bytes, four per pixel */
+
+    /**
+     * Returns the byte offset of pixel (x, y), truncating out of range
+     * coordinates with a warning.
+     */
+    std::size_t _offset(unsigned int x, unsigned int y) const;
+  };
+}
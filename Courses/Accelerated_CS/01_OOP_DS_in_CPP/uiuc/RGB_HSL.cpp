@@ -0,0 +1,710 @@
+/**
+ * @file RGB_HSL.cpp
+ * Batch RGBA <-> HSLA conversion, vectorized with SSE2 and AVX2.
+ *
+ * The vector kernels follow rgb2hsl and hsl2rgb operation by operation, so
+ * that every lane sees exactly the same IEEE double operations as the scalar
+ * code and produces bit-identical results. The only rewrites are:
+ *
+ *  - fmod((g - b) / chroma, 6) is dropped in rgb2hsl, since when r is the
+ *    maximum channel |g - b| <= chroma and the fmod is the identity.
+ *  - fmod(hh, 2) is computed as hh - 2 * trunc(hh / 2), which is exact.
+ *  - round(v) followed by the conversion to unsigned char is computed as a
+ *    truncating conversion of v + copysign(0.49999999999999994, v), which is
+ *    exact for |v| < 2^52.
+ *
+ * Any block of pixels with a value whose conversion would leave the range
+ * where those rewrites are exact (including NaN and infinity) is handed to
+ * the scalar code instead, so the batch functions never disagree with
+ * rgb2hsl/hsl2rgb.
+ *
+ * The single-precision kernels follow rgb2hslFloat and hsl2rgbFloat in the
+ * same way, with twice as many pixels per vector. They make the same first
+ * two rewrites; unitToByteFloat already clamps, so its vector form is a
+ * multiply, add, clamp and truncating conversion, exactly as in the scalar
+ * code.
+ */
+
+#include <cstddef>
+#include "HSLAPixel.h"
+#include "RGB_HSL.h"
+#include "SIMD.h"
+
+// The AVX2 kernels are chosen at run time, which takes GCC's target
+// attribute and __builtin_cpu_supports, so they need GCC or Clang as well.
+#if UIUC_SSE2 && defined(__GNUC__)
+#define UIUC_RGB_HSL_X86 1
+#include <immintrin.h>
+#else
+#define UIUC_RGB_HSL_X86 0
+#endif
+
+namespace uiuc {
+  typedef void (*Rgb2HslKernel)(unsigned char const *, HSLAPixel *, std::size_t);
+  typedef void (*Hsl2RgbKernel)(HSLAPixel const *, unsigned char *, std::size_t);
+  typedef void (*Rgb2HslFloatKernel)(unsigned char const *, float *, std::size_t);
+  typedef void (*Hsl2RgbFloatKernel)(float const *, unsigned char *, std::size_t);
+
+  static void rgb2hslScalar(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      rgbaColor rgb;
+      rgb.r = rgba[(i * 4)];
+      rgb.g = rgba[(i * 4) + 1];
+      rgb.b = rgba[(i * 4) + 2];
+      rgb.a = rgba[(i * 4) + 3];
+
+      hslaColor hsl = rgb2hsl(rgb);
+      hsla[i].h = hsl.h;
+      hsla[i].s = hsl.s;
+      hsla[i].l = hsl.l;
+      hsla[i].a = hsl.a;
+    }
+  }
+
+  static void hsl2rgbScalar(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      hslaColor hsl;
+      hsl.h = hsla[i].h;
+      hsl.s = hsla[i].s;
+      hsl.l = hsla[i].l;
+      hsl.a = hsla[i].a;
+
+      rgbaColor rgb = hsl2rgb(hsl);
+      rgba[(i * 4)]     = rgb.r;
+      rgba[(i * 4) + 1] = rgb.g;
+      rgba[(i * 4) + 2] = rgb.b;
+      rgba[(i * 4) + 3] = rgb.a;
+    }
+  }
+
+  static void rgb2hslFloatScalar(unsigned char const * rgba, float * hsla, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      rgb2hslFloat(rgba + (i * 4), hsla + (i * 4));
+    }
+  }
+
+  static void hsl2rgbFloatScalar(float const * hsla, unsigned char * rgba, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      hsl2rgbFloat(hsla + (i * 4), rgba + (i * 4));
+    }
+  }
+
+#if UIUC_RGB_HSL_X86
+  // Largest magnitude for which the truncating conversions below are exact.
+  static const double kVectorLimit = 1073741824.0; // 2^30
+  // The largest double below 0.5; adding it before truncating rounds half away from zero.
+  static const double kRoundBias = 0.49999999999999994;
+  // Largest hue / 60 for which hh - 2 * trunc(hh / 2) is exact in float.
+  static const float kVectorLimitFloat = 4194304.0f; // 2^22
+
+  // ---------------------------------------------------------------------
+  // SSE2: two pixels per step
+
+  static inline __m128d _blendSSE2(__m128d a, __m128d b, __m128d mask) {
+    return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+  }
+
+  static inline __m128d _absSSE2(__m128d v) {
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), v);
+  }
+
+  static inline __m128i _roundSSE2(__m128d v) {
+    __m128d bias = _mm_or_pd(_mm_and_pd(_mm_set1_pd(-0.0), v), _mm_set1_pd(kRoundBias));
+    return _mm_cvttpd_epi32(_mm_add_pd(v, bias));
+  }
+
+  static void rgb2hslSSE2(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128d k255 = _mm_set1_pd(255.0);
+    const __m128d kEpsilon = _mm_set1_pd(0.0001);
+    const __m128d kZero = _mm_setzero_pd();
+    const __m128d kOne = _mm_set1_pd(1.0);
+    const __m128d kTwo = _mm_set1_pd(2.0);
+    const __m128d kFour = _mm_set1_pd(4.0);
+    const __m128d kHalf = _mm_set1_pd(0.5);
+    const __m128d k60 = _mm_set1_pd(60.0);
+    const __m128d k360 = _mm_set1_pd(360.0);
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+      __m128i packed = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(rgba + (i * 4)));
+      __m128d r = _mm_div_pd(_mm_cvtepi32_pd(_mm_and_si128(packed, byteMask)), k255);
+      __m128d g = _mm_div_pd(_mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(packed, 8), byteMask)), k255);
+      __m128d b = _mm_div_pd(_mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(packed, 16), byteMask)), k255);
+      __m128d a = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_epi32(packed, 24)), k255);
+
+      __m128d min = _mm_min_pd(_mm_min_pd(r, g), b);
+      __m128d max = _mm_max_pd(_mm_max_pd(r, g), b);
+      __m128d chroma = _mm_sub_pd(max, min);
+      __m128d l = _mm_mul_pd(kHalf, _mm_add_pd(max, min));
+      __m128d gray = _mm_or_pd(_mm_cmplt_pd(chroma, kEpsilon), _mm_cmplt_pd(max, kEpsilon));
+
+      __m128d s = _mm_div_pd(chroma, _mm_sub_pd(kOne, _absSSE2(_mm_sub_pd(_mm_mul_pd(kTwo, l), kOne))));
+
+      __m128d h = _mm_add_pd(_mm_div_pd(_mm_sub_pd(r, g), chroma), kFour);
+      h = _blendSSE2(h, _mm_add_pd(_mm_div_pd(_mm_sub_pd(b, r), chroma), kTwo), _mm_cmpeq_pd(max, g));
+      h = _blendSSE2(h, _mm_div_pd(_mm_sub_pd(g, b), chroma), _mm_cmpeq_pd(max, r));
+      h = _mm_mul_pd(h, k60);
+      h = _blendSSE2(h, _mm_add_pd(h, k360), _mm_cmplt_pd(h, kZero));
+
+      h = _mm_andnot_pd(gray, h);
+      s = _mm_andnot_pd(gray, s);
+
+      _mm_storeu_pd(&hsla[i].h, _mm_unpacklo_pd(h, s));
+      _mm_storeu_pd(&hsla[i].l, _mm_unpacklo_pd(l, a));
+      _mm_storeu_pd(&hsla[i + 1].h, _mm_unpackhi_pd(h, s));
+      _mm_storeu_pd(&hsla[i + 1].l, _mm_unpackhi_pd(l, a));
+    }
+
+    rgb2hslScalar(rgba + (i * 4), hsla + i, count - i);
+  }
+
+  static void hsl2rgbSSE2(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128d kLimit = _mm_set1_pd(kVectorLimit);
+    const __m128d kLowSaturation = _mm_set1_pd(0.001);
+    const __m128d kZero = _mm_setzero_pd();
+    const __m128d kOne = _mm_set1_pd(1.0);
+    const __m128d kTwo = _mm_set1_pd(2.0);
+    const __m128d kThree = _mm_set1_pd(3.0);
+    const __m128d kFour = _mm_set1_pd(4.0);
+    const __m128d kFive = _mm_set1_pd(5.0);
+    const __m128d kHalf = _mm_set1_pd(0.5);
+    const __m128d k60 = _mm_set1_pd(60.0);
+    const __m128d k255 = _mm_set1_pd(255.0);
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+      __m128d hs0 = _mm_loadu_pd(&hsla[i].h);
+      __m128d la0 = _mm_loadu_pd(&hsla[i].l);
+      __m128d hs1 = _mm_loadu_pd(&hsla[i + 1].h);
+      __m128d la1 = _mm_loadu_pd(&hsla[i + 1].l);
+      __m128d h = _mm_unpacklo_pd(hs0, hs1);
+      __m128d s = _mm_unpackhi_pd(hs0, hs1);
+      __m128d l = _mm_unpacklo_pd(la0, la1);
+      __m128d a = _mm_unpackhi_pd(la0, la1);
+
+      __m128d c = _mm_mul_pd(_mm_sub_pd(kOne, _absSSE2(_mm_sub_pd(_mm_mul_pd(kTwo, l), kOne))), s);
+      __m128d hh = _mm_div_pd(h, k60);
+      __m128d half = _mm_mul_pd(hh, kHalf);
+      __m128d hhMod2 = _mm_sub_pd(hh, _mm_mul_pd(kTwo, _mm_cvtepi32_pd(_mm_cvttpd_epi32(half))));
+      __m128d x = _mm_mul_pd(c, _mm_sub_pd(kOne, _absSSE2(_mm_sub_pd(hhMod2, kOne))));
+
+      __m128d r = c, g = kZero, b = x;
+      __m128d mask = _mm_cmple_pd(hh, kFive);
+      r = _blendSSE2(r, x, mask); g = _blendSSE2(g, kZero, mask); b = _blendSSE2(b, c, mask);
+      mask = _mm_cmple_pd(hh, kFour);
+      r = _blendSSE2(r, kZero, mask); g = _blendSSE2(g, x, mask); b = _blendSSE2(b, c, mask);
+      mask = _mm_cmple_pd(hh, kThree);
+      r = _blendSSE2(r, kZero, mask); g = _blendSSE2(g, c, mask); b = _blendSSE2(b, x, mask);
+      mask = _mm_cmple_pd(hh, kTwo);
+      r = _blendSSE2(r, x, mask); g = _blendSSE2(g, c, mask); b = _blendSSE2(b, kZero, mask);
+      mask = _mm_cmple_pd(hh, kOne);
+      r = _blendSSE2(r, c, mask); g = _blendSSE2(g, x, mask); b = _blendSSE2(b, kZero, mask);
+
+      __m128d m = _mm_sub_pd(l, _mm_mul_pd(kHalf, c));
+      __m128d gray = _mm_mul_pd(l, k255);
+      __m128d lowSaturation = _mm_cmple_pd(s, kLowSaturation);
+      r = _blendSSE2(_mm_mul_pd(_mm_add_pd(r, m), k255), gray, lowSaturation);
+      g = _blendSSE2(_mm_mul_pd(_mm_add_pd(g, m), k255), gray, lowSaturation);
+      b = _blendSSE2(_mm_mul_pd(_mm_add_pd(b, m), k255), gray, lowSaturation);
+      a = _mm_mul_pd(a, k255);
+
+      __m128d inRange = _mm_cmplt_pd(_absSSE2(hh), kLimit);
+      inRange = _mm_and_pd(inRange, _mm_cmplt_pd(_absSSE2(r), kLimit));
+      inRange = _mm_and_pd(inRange, _mm_cmplt_pd(_absSSE2(g), kLimit));
+      inRange = _mm_and_pd(inRange, _mm_cmplt_pd(_absSSE2(b), kLimit));
+      inRange = _mm_and_pd(inRange, _mm_cmplt_pd(_absSSE2(a), kLimit));
+      if (_mm_movemask_pd(inRange) != 0x3) {
+        hsl2rgbScalar(hsla + i, rgba + (i * 4), 2);
+        continue;
+      }
+
+      __m128i packed = _mm_and_si128(_roundSSE2(r), byteMask);
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_and_si128(_roundSSE2(g), byteMask), 8));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_and_si128(_roundSSE2(b), byteMask), 16));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_roundSSE2(a), 24));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(rgba + (i * 4)), packed);
+    }
+
+    hsl2rgbScalar(hsla + i, rgba + (i * 4), count - i);
+  }
+
+  // ---------------------------------------------------------------------
+  // SSE2, single precision: four pixels per step
+
+  static inline __m128 _blendSSE2(__m128 a, __m128 b, __m128 mask) {
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+  }
+
+  static inline __m128 _absSSE2(__m128 v) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+  }
+
+  // unitToByteFloat for four channels. _mm_max_ps returns its second
+  // operand when the first is NaN, so NaN becomes 0 as in the scalar code.
+  static inline __m128i _toBytesSSE2(__m128 v) {
+    v = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    return _mm_cvttps_epi32(v);
+  }
+
+  static void rgb2hslFloatSSE2(unsigned char const * rgba, float * hsla, std::size_t count) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128 k255 = _mm_set1_ps(255.0f);
+    const __m128 kEpsilon = _mm_set1_ps(0.0001f);
+    const __m128 kZero = _mm_setzero_ps();
+    const __m128 kOne = _mm_set1_ps(1.0f);
+    const __m128 kTwo = _mm_set1_ps(2.0f);
+    const __m128 kFour = _mm_set1_ps(4.0f);
+    const __m128 kHalf = _mm_set1_ps(0.5f);
+    const __m128 k60 = _mm_set1_ps(60.0f);
+    const __m128 k360 = _mm_set1_ps(360.0f);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      __m128i packed = _mm_loadu_si128(reinterpret_cast<__m128i const *>(rgba + (i * 4)));
+      __m128 r = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(packed, byteMask)), k255);
+      __m128 g = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 8), byteMask)), k255);
+      __m128 b = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 16), byteMask)), k255);
+      __m128 a = _mm_div_ps(_mm_cvtepi32_ps(_mm_srli_epi32(packed, 24)), k255);
+
+      __m128 min = _mm_min_ps(_mm_min_ps(r, g), b);
+      __m128 max = _mm_max_ps(_mm_max_ps(r, g), b);
+      __m128 chroma = _mm_sub_ps(max, min);
+      __m128 l = _mm_mul_ps(kHalf, _mm_add_ps(max, min));
+      __m128 gray = _mm_or_ps(_mm_cmplt_ps(chroma, kEpsilon), _mm_cmplt_ps(max, kEpsilon));
+
+      __m128 s = _mm_div_ps(chroma, _mm_sub_ps(kOne, _absSSE2(_mm_sub_ps(_mm_mul_ps(kTwo, l), kOne))));
+
+      __m128 h = _mm_add_ps(_mm_div_ps(_mm_sub_ps(r, g), chroma), kFour);
+      h = _blendSSE2(h, _mm_add_ps(_mm_div_ps(_mm_sub_ps(b, r), chroma), kTwo), _mm_cmpeq_ps(max, g));
+      h = _blendSSE2(h, _mm_div_ps(_mm_sub_ps(g, b), chroma), _mm_cmpeq_ps(max, r));
+      h = _mm_mul_ps(h, k60);
+      h = _blendSSE2(h, _mm_add_ps(h, k360), _mm_cmplt_ps(h, kZero));
+
+      h = _mm_andnot_ps(gray, h);
+      s = _mm_andnot_ps(gray, s);
+
+      // Transpose the four channel vectors back into four HSLA pixels.
+      _MM_TRANSPOSE4_PS(h, s, l, a);
+      _mm_storeu_ps(hsla + (i * 4), h);
+      _mm_storeu_ps(hsla + (i * 4) + 4, s);
+      _mm_storeu_ps(hsla + (i * 4) + 8, l);
+      _mm_storeu_ps(hsla + (i * 4) + 12, a);
+    }
+
+    rgb2hslFloatScalar(rgba + (i * 4), hsla + (i * 4), count - i);
+  }
+
+  static void hsl2rgbFloatSSE2(float const * hsla, unsigned char * rgba, std::size_t count) {
+    const __m128 kLimit = _mm_set1_ps(kVectorLimitFloat);
+    const __m128 kLowSaturation = _mm_set1_ps(0.001f);
+    const __m128 kZero = _mm_setzero_ps();
+    const __m128 kOne = _mm_set1_ps(1.0f);
+    const __m128 kTwo = _mm_set1_ps(2.0f);
+    const __m128 kThree = _mm_set1_ps(3.0f);
+    const __m128 kFour = _mm_set1_ps(4.0f);
+    const __m128 kFive = _mm_set1_ps(5.0f);
+    const __m128 kHalf = _mm_set1_ps(0.5f);
+    const __m128 k60 = _mm_set1_ps(60.0f);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      // Transpose four HSLA pixels into one vector per channel.
+      __m128 h = _mm_loadu_ps(hsla + (i * 4));
+      __m128 s = _mm_loadu_ps(hsla + (i * 4) + 4);
+      __m128 l = _mm_loadu_ps(hsla + (i * 4) + 8);
+      __m128 a = _mm_loadu_ps(hsla + (i * 4) + 12);
+      _MM_TRANSPOSE4_PS(h, s, l, a);
+
+      __m128 hh = _mm_div_ps(h, k60);
+      if (_mm_movemask_ps(_mm_cmplt_ps(_absSSE2(hh), kLimit)) != 0xF) {
+        hsl2rgbFloatScalar(hsla + (i * 4), rgba + (i * 4), 4);
+        continue;
+      }
+
+      __m128 c = _mm_mul_ps(_mm_sub_ps(kOne, _absSSE2(_mm_sub_ps(_mm_mul_ps(kTwo, l), kOne))), s);
+      __m128 half = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(hh, kHalf)));
+      __m128 hhMod2 = _mm_sub_ps(hh, _mm_mul_ps(kTwo, half));
+      __m128 x = _mm_mul_ps(c, _mm_sub_ps(kOne, _absSSE2(_mm_sub_ps(hhMod2, kOne))));
+
+      __m128 r = c, g = kZero, b = x;
+      __m128 mask = _mm_cmple_ps(hh, kFive);
+      r = _blendSSE2(r, x, mask); g = _blendSSE2(g, kZero, mask); b = _blendSSE2(b, c, mask);
+      mask = _mm_cmple_ps(hh, kFour);
+      r = _blendSSE2(r, kZero, mask); g = _blendSSE2(g, x, mask); b = _blendSSE2(b, c, mask);
+      mask = _mm_cmple_ps(hh, kThree);
+      r = _blendSSE2(r, kZero, mask); g = _blendSSE2(g, c, mask); b = _blendSSE2(b, x, mask);
+      mask = _mm_cmple_ps(hh, kTwo);
+      r = _blendSSE2(r, x, mask); g = _blendSSE2(g, c, mask); b = _blendSSE2(b, kZero, mask);
+      mask = _mm_cmple_ps(hh, kOne);
+      r = _blendSSE2(r, c, mask); g = _blendSSE2(g, x, mask); b = _blendSSE2(b, kZero, mask);
+
+      __m128 m = _mm_sub_ps(l, _mm_mul_ps(kHalf, c));
+      __m128 lowSaturation = _mm_cmple_ps(s, kLowSaturation);
+      r = _blendSSE2(_mm_add_ps(r, m), l, lowSaturation);
+      g = _blendSSE2(_mm_add_ps(g, m), l, lowSaturation);
+      b = _blendSSE2(_mm_add_ps(b, m), l, lowSaturation);
+
+      __m128i packed = _toBytesSSE2(r);
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_toBytesSSE2(g), 8));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_toBytesSSE2(b), 16));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_toBytesSSE2(a), 24));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + (i * 4)), packed);
+    }
+
+    hsl2rgbFloatScalar(hsla + (i * 4), rgba + (i * 4), count - i);
+  }
+
+  // ---------------------------------------------------------------------
+  // AVX2: four pixels per step
+
+#define UIUC_AVX2 __attribute__((target("avx2")))
+
+  static inline UIUC_AVX2 __m256d _absAVX2(__m256d v) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+  }
+
+  static inline UIUC_AVX2 __m128i _roundAVX2(__m256d v) {
+    __m256d bias = _mm256_or_pd(_mm256_and_pd(_mm256_set1_pd(-0.0), v), _mm256_set1_pd(kRoundBias));
+    return _mm256_cvttpd_epi32(_mm256_add_pd(v, bias));
+  }
+
+  static UIUC_AVX2 void rgb2hslAVX2(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m256d k255 = _mm256_set1_pd(255.0);
+    const __m256d kEpsilon = _mm256_set1_pd(0.0001);
+    const __m256d kZero = _mm256_setzero_pd();
+    const __m256d kOne = _mm256_set1_pd(1.0);
+    const __m256d kTwo = _mm256_set1_pd(2.0);
+    const __m256d kFour = _mm256_set1_pd(4.0);
+    const __m256d kHalf = _mm256_set1_pd(0.5);
+    const __m256d k60 = _mm256_set1_pd(60.0);
+    const __m256d k360 = _mm256_set1_pd(360.0);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      __m128i packed = _mm_loadu_si128(reinterpret_cast<__m128i const *>(rgba + (i * 4)));
+      __m256d r = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_and_si128(packed, byteMask)), k255);
+      __m256d g = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(packed, 8), byteMask)), k255);
+      __m256d b = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(packed, 16), byteMask)), k255);
+      __m256d a = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_srli_epi32(packed, 24)), k255);
+
+      __m256d min = _mm256_min_pd(_mm256_min_pd(r, g), b);
+      __m256d max = _mm256_max_pd(_mm256_max_pd(r, g), b);
+      __m256d chroma = _mm256_sub_pd(max, min);
+      __m256d l = _mm256_mul_pd(kHalf, _mm256_add_pd(max, min));
+      __m256d gray = _mm256_or_pd(_mm256_cmp_pd(chroma, kEpsilon, _CMP_LT_OQ),
+                                  _mm256_cmp_pd(max, kEpsilon, _CMP_LT_OQ));
+
+      __m256d s = _mm256_div_pd(chroma, _mm256_sub_pd(kOne, _absAVX2(_mm256_sub_pd(_mm256_mul_pd(kTwo, l), kOne))));
+
+      __m256d h = _mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(r, g), chroma), kFour);
+      h = _mm256_blendv_pd(h, _mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(b, r), chroma), kTwo),
+                           _mm256_cmp_pd(max, g, _CMP_EQ_OQ));
+      h = _mm256_blendv_pd(h, _mm256_div_pd(_mm256_sub_pd(g, b), chroma), _mm256_cmp_pd(max, r, _CMP_EQ_OQ));
+      h = _mm256_mul_pd(h, k60);
+      h = _mm256_blendv_pd(h, _mm256_add_pd(h, k360), _mm256_cmp_pd(h, kZero, _CMP_LT_OQ));
+
+      h = _mm256_andnot_pd(gray, h);
+      s = _mm256_andnot_pd(gray, s);
+
+      // Transpose the four channel vectors back into four HSLA pixels.
+      __m256d hl01 = _mm256_permute2f128_pd(h, l, 0x20);
+      __m256d hl23 = _mm256_permute2f128_pd(h, l, 0x31);
+      __m256d sa01 = _mm256_permute2f128_pd(s, a, 0x20);
+      __m256d sa23 = _mm256_permute2f128_pd(s, a, 0x31);
+      _mm256_storeu_pd(&hsla[i].h, _mm256_unpacklo_pd(hl01, sa01));
+      _mm256_storeu_pd(&hsla[i + 1].h, _mm256_unpackhi_pd(hl01, sa01));
+      _mm256_storeu_pd(&hsla[i + 2].h, _mm256_unpacklo_pd(hl23, sa23));
+      _mm256_storeu_pd(&hsla[i + 3].h, _mm256_unpackhi_pd(hl23, sa23));
+    }
+
+    rgb2hslScalar(rgba + (i * 4), hsla + i, count - i);
+  }
+
+  static UIUC_AVX2 void hsl2rgbAVX2(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m256d kLimit = _mm256_set1_pd(kVectorLimit);
+    const __m256d kLowSaturation = _mm256_set1_pd(0.001);
+    const __m256d kZero = _mm256_setzero_pd();
+    const __m256d kOne = _mm256_set1_pd(1.0);
+    const __m256d kTwo = _mm256_set1_pd(2.0);
+    const __m256d kThree = _mm256_set1_pd(3.0);
+    const __m256d kFour = _mm256_set1_pd(4.0);
+    const __m256d kFive = _mm256_set1_pd(5.0);
+    const __m256d kHalf = _mm256_set1_pd(0.5);
+    const __m256d k60 = _mm256_set1_pd(60.0);
+    const __m256d k255 = _mm256_set1_pd(255.0);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      // Transpose four HSLA pixels into one vector per channel.
+      __m256d p0 = _mm256_loadu_pd(&hsla[i].h);
+      __m256d p1 = _mm256_loadu_pd(&hsla[i + 1].h);
+      __m256d p2 = _mm256_loadu_pd(&hsla[i + 2].h);
+      __m256d p3 = _mm256_loadu_pd(&hsla[i + 3].h);
+      __m256d hl01 = _mm256_unpacklo_pd(p0, p1);
+      __m256d sa01 = _mm256_unpackhi_pd(p0, p1);
+      __m256d hl23 = _mm256_unpacklo_pd(p2, p3);
+      __m256d sa23 = _mm256_unpackhi_pd(p2, p3);
+      __m256d h = _mm256_permute2f128_pd(hl01, hl23, 0x20);
+      __m256d l = _mm256_permute2f128_pd(hl01, hl23, 0x31);
+      __m256d s = _mm256_permute2f128_pd(sa01, sa23, 0x20);
+      __m256d a = _mm256_permute2f128_pd(sa01, sa23, 0x31);
+
+      __m256d c = _mm256_mul_pd(_mm256_sub_pd(kOne, _absAVX2(_mm256_sub_pd(_mm256_mul_pd(kTwo, l), kOne))), s);
+      __m256d hh = _mm256_div_pd(h, k60);
+      __m256d half = _mm256_round_pd(_mm256_mul_pd(hh, kHalf), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      __m256d hhMod2 = _mm256_sub_pd(hh, _mm256_mul_pd(kTwo, half));
+      __m256d x = _mm256_mul_pd(c, _mm256_sub_pd(kOne, _absAVX2(_mm256_sub_pd(hhMod2, kOne))));
+
+      __m256d r = c, g = kZero, b = x;
+      __m256d mask = _mm256_cmp_pd(hh, kFive, _CMP_LE_OQ);
+      r = _mm256_blendv_pd(r, x, mask); g = _mm256_blendv_pd(g, kZero, mask); b = _mm256_blendv_pd(b, c, mask);
+      mask = _mm256_cmp_pd(hh, kFour, _CMP_LE_OQ);
+      r = _mm256_blendv_pd(r, kZero, mask); g = _mm256_blendv_pd(g, x, mask); b = _mm256_blendv_pd(b, c, mask);
+      mask = _mm256_cmp_pd(hh, kThree, _CMP_LE_OQ);
+      r = _mm256_blendv_pd(r, kZero, mask); g = _mm256_blendv_pd(g, c, mask); b = _mm256_blendv_pd(b, x, mask);
+      mask = _mm256_cmp_pd(hh, kTwo, _CMP_LE_OQ);
+      r = _mm256_blendv_pd(r, x, mask); g = _mm256_blendv_pd(g, c, mask); b = _mm256_blendv_pd(b, kZero, mask);
+      mask = _mm256_cmp_pd(hh, kOne, _CMP_LE_OQ);
+      r = _mm256_blendv_pd(r, c, mask); g = _mm256_blendv_pd(g, x, mask); b = _mm256_blendv_pd(b, kZero, mask);
+
+      __m256d m = _mm256_sub_pd(l, _mm256_mul_pd(kHalf, c));
+      __m256d gray = _mm256_mul_pd(l, k255);
+      __m256d lowSaturation = _mm256_cmp_pd(s, kLowSaturation, _CMP_LE_OQ);
+      r = _mm256_blendv_pd(_mm256_mul_pd(_mm256_add_pd(r, m), k255), gray, lowSaturation);
+      g = _mm256_blendv_pd(_mm256_mul_pd(_mm256_add_pd(g, m), k255), gray, lowSaturation);
+      b = _mm256_blendv_pd(_mm256_mul_pd(_mm256_add_pd(b, m), k255), gray, lowSaturation);
+      a = _mm256_mul_pd(a, k255);
+
+      __m256d inRange = _mm256_cmp_pd(_absAVX2(hh), kLimit, _CMP_LT_OQ);
+      inRange = _mm256_and_pd(inRange, _mm256_cmp_pd(_absAVX2(r), kLimit, _CMP_LT_OQ));
+      inRange = _mm256_and_pd(inRange, _mm256_cmp_pd(_absAVX2(g), kLimit, _CMP_LT_OQ));
+      inRange = _mm256_and_pd(inRange, _mm256_cmp_pd(_absAVX2(b), kLimit, _CMP_LT_OQ));
+      inRange = _mm256_and_pd(inRange, _mm256_cmp_pd(_absAVX2(a), kLimit, _CMP_LT_OQ));
+      if (_mm256_movemask_pd(inRange) != 0xF) {
+        hsl2rgbScalar(hsla + i, rgba + (i * 4), 4);
+        continue;
+      }
+
+      __m128i packed = _mm_and_si128(_roundAVX2(r), byteMask);
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_and_si128(_roundAVX2(g), byteMask), 8));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_and_si128(_roundAVX2(b), byteMask), 16));
+      packed = _mm_or_si128(packed, _mm_slli_epi32(_roundAVX2(a), 24));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + (i * 4)), packed);
+    }
+
+    hsl2rgbScalar(hsla + i, rgba + (i * 4), count - i);
+  }
+
+  // ---------------------------------------------------------------------
+  // AVX2, single precision: eight pixels per step
+
+  static inline UIUC_AVX2 __m256 _absAVX2(__m256 v) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+  }
+
+  static inline UIUC_AVX2 __m256i _toBytesAVX2(__m256 v) {
+    v = _mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f));
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    return _mm256_cvttps_epi32(v);
+  }
+
+  // Transposes four vectors of eight floats as two 4x4 blocks, one in each
+  // 128-bit half. With a row per pixel, pixels i..i+3 in the low halves and
+  // i+4..i+7 in the high halves, this gives one vector per channel with the
+  // pixels in order, and back.
+  static inline UIUC_AVX2 void _transposeAVX2(__m256 & v0, __m256 & v1, __m256 & v2, __m256 & v3) {
+    __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+    __m256 t1 = _mm256_unpackhi_ps(v0, v1);
+    __m256 t2 = _mm256_unpacklo_ps(v2, v3);
+    __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+    v0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    v1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    v2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    v3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  }
+
+  static inline UIUC_AVX2 __m256 _loadPixelsAVX2(float const * hsla, std::size_t i) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(hsla + (i * 4))), _mm_loadu_ps(hsla + ((i + 4) * 4)), 1);
+  }
+
+  static inline UIUC_AVX2 void _storePixelsAVX2(float * hsla, std::size_t i, __m256 v) {
+    _mm_storeu_ps(hsla + (i * 4), _mm256_castps256_ps128(v));
+    _mm_storeu_ps(hsla + ((i + 4) * 4), _mm256_extractf128_ps(v, 1));
+  }
+
+  static UIUC_AVX2 void rgb2hslFloatAVX2(unsigned char const * rgba, float * hsla, std::size_t count) {
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256 k255 = _mm256_set1_ps(255.0f);
+    const __m256 kEpsilon = _mm256_set1_ps(0.0001f);
+    const __m256 kZero = _mm256_setzero_ps();
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+    const __m256 kTwo = _mm256_set1_ps(2.0f);
+    const __m256 kFour = _mm256_set1_ps(4.0f);
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+    const __m256 k60 = _mm256_set1_ps(60.0f);
+    const __m256 k360 = _mm256_set1_ps(360.0f);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      __m256i packed = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(rgba + (i * 4)));
+      __m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(packed, byteMask)), k255);
+      __m256 g = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(packed, 8), byteMask)), k255);
+      __m256 b = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(packed, 16), byteMask)), k255);
+      __m256 a = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(packed, 24)), k255);
+
+      __m256 min = _mm256_min_ps(_mm256_min_ps(r, g), b);
+      __m256 max = _mm256_max_ps(_mm256_max_ps(r, g), b);
+      __m256 chroma = _mm256_sub_ps(max, min);
+      __m256 l = _mm256_mul_ps(kHalf, _mm256_add_ps(max, min));
+      __m256 gray = _mm256_or_ps(_mm256_cmp_ps(chroma, kEpsilon, _CMP_LT_OQ),
+                                 _mm256_cmp_ps(max, kEpsilon, _CMP_LT_OQ));
+
+      __m256 s = _mm256_div_ps(chroma, _mm256_sub_ps(kOne, _absAVX2(_mm256_sub_ps(_mm256_mul_ps(kTwo, l), kOne))));
+
+      __m256 h = _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(r, g), chroma), kFour);
+      h = _mm256_blendv_ps(h, _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(b, r), chroma), kTwo),
+                           _mm256_cmp_ps(max, g, _CMP_EQ_OQ));
+      h = _mm256_blendv_ps(h, _mm256_div_ps(_mm256_sub_ps(g, b), chroma), _mm256_cmp_ps(max, r, _CMP_EQ_OQ));
+      h = _mm256_mul_ps(h, k60);
+      h = _mm256_blendv_ps(h, _mm256_add_ps(h, k360), _mm256_cmp_ps(h, kZero, _CMP_LT_OQ));
+
+      h = _mm256_andnot_ps(gray, h);
+      s = _mm256_andnot_ps(gray, s);
+
+      _transposeAVX2(h, s, l, a);
+      _storePixelsAVX2(hsla, i, h);
+      _storePixelsAVX2(hsla, i + 1, s);
+      _storePixelsAVX2(hsla, i + 2, l);
+      _storePixelsAVX2(hsla, i + 3, a);
+    }
+
+    rgb2hslFloatScalar(rgba + (i * 4), hsla + (i * 4), count - i);
+  }
+
+  static UIUC_AVX2 void hsl2rgbFloatAVX2(float const * hsla, unsigned char * rgba, std::size_t count) {
+    const __m256 kLimit = _mm256_set1_ps(kVectorLimitFloat);
+    const __m256 kLowSaturation = _mm256_set1_ps(0.001f);
+    const __m256 kZero = _mm256_setzero_ps();
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+    const __m256 kTwo = _mm256_set1_ps(2.0f);
+    const __m256 kThree = _mm256_set1_ps(3.0f);
+    const __m256 kFour = _mm256_set1_ps(4.0f);
+    const __m256 kFive = _mm256_set1_ps(5.0f);
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+    const __m256 k60 = _mm256_set1_ps(60.0f);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      __m256 h = _loadPixelsAVX2(hsla, i);
+      __m256 s = _loadPixelsAVX2(hsla, i + 1);
+      __m256 l = _loadPixelsAVX2(hsla, i + 2);
+      __m256 a = _loadPixelsAVX2(hsla, i + 3);
+      _transposeAVX2(h, s, l, a);
+
+      __m256 hh = _mm256_div_ps(h, k60);
+      if (_mm256_movemask_ps(_mm256_cmp_ps(_absAVX2(hh), kLimit, _CMP_LT_OQ)) != 0xFF) {
+        hsl2rgbFloatScalar(hsla + (i * 4), rgba + (i * 4), 8);
+        continue;
+      }
+
+      __m256 c = _mm256_mul_ps(_mm256_sub_ps(kOne, _absAVX2(_mm256_sub_ps(_mm256_mul_ps(kTwo, l), kOne))), s);
+      __m256 half = _mm256_round_ps(_mm256_mul_ps(hh, kHalf), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      __m256 hhMod2 = _mm256_sub_ps(hh, _mm256_mul_ps(kTwo, half));
+      __m256 x = _mm256_mul_ps(c, _mm256_sub_ps(kOne, _absAVX2(_mm256_sub_ps(hhMod2, kOne))));
+
+      __m256 r = c, g = kZero, b = x;
+      __m256 mask = _mm256_cmp_ps(hh, kFive, _CMP_LE_OQ);
+      r = _mm256_blendv_ps(r, x, mask); g = _mm256_blendv_ps(g, kZero, mask); b = _mm256_blendv_ps(b, c, mask);
+      mask = _mm256_cmp_ps(hh, kFour, _CMP_LE_OQ);
+      r = _mm256_blendv_ps(r, kZero, mask); g = _mm256_blendv_ps(g, x, mask); b = _mm256_blendv_ps(b, c, mask);
+      mask = _mm256_cmp_ps(hh, kThree, _CMP_LE_OQ);
+      r = _mm256_blendv_ps(r, kZero, mask); g = _mm256_blendv_ps(g, c, mask); b = _mm256_blendv_ps(b, x, mask);
+      mask = _mm256_cmp_ps(hh, kTwo, _CMP_LE_OQ);
+      r = _mm256_blendv_ps(r, x, mask); g = _mm256_blendv_ps(g, c, mask); b = _mm256_blendv_ps(b, kZero, mask);
+      mask = _mm256_cmp_ps(hh, kOne, _CMP_LE_OQ);
+      r = _mm256_blendv_ps(r, c, mask); g = _mm256_blendv_ps(g, x, mask); b = _mm256_blendv_ps(b, kZero, mask);
+
+      __m256 m = _mm256_sub_ps(l, _mm256_mul_ps(kHalf, c));
+      __m256 lowSaturation = _mm256_cmp_ps(s, kLowSaturation, _CMP_LE_OQ);
+      r = _mm256_blendv_ps(_mm256_add_ps(r, m), l, lowSaturation);
+      g = _mm256_blendv_ps(_mm256_add_ps(g, m), l, lowSaturation);
+      b = _mm256_blendv_ps(_mm256_add_ps(b, m), l, lowSaturation);
+
+      __m256i packed = _toBytesAVX2(r);
+      packed = _mm256_or_si256(packed, _mm256_slli_epi32(_toBytesAVX2(g), 8));
+      packed = _mm256_or_si256(packed, _mm256_slli_epi32(_toBytesAVX2(b), 16));
+      packed = _mm256_or_si256(packed, _mm256_slli_epi32(_toBytesAVX2(a), 24));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + (i * 4)), packed);
+    }
+
+    hsl2rgbFloatScalar(hsla + (i * 4), rgba + (i * 4), count - i);
+  }
+
+#undef UIUC_AVX2
+#endif
+
+  static Rgb2HslKernel _selectRgb2Hsl() {
+#if UIUC_RGB_HSL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return rgb2hslAVX2; }
+    return rgb2hslSSE2;
+#else
+    return rgb2hslScalar;
+#endif
+  }
+
+  static Hsl2RgbKernel _selectHsl2Rgb() {
+#if UIUC_RGB_HSL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return hsl2rgbAVX2; }
+    return hsl2rgbSSE2;
+#else
+    return hsl2rgbScalar;
+#endif
+  }
+
+  static Rgb2HslFloatKernel _selectRgb2HslFloat() {
+#if UIUC_RGB_HSL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return rgb2hslFloatAVX2; }
+    return rgb2hslFloatSSE2;
+#else
+    return rgb2hslFloatScalar;
+#endif
+  }
+
+  static Hsl2RgbFloatKernel _selectHsl2RgbFloat() {
+#if UIUC_RGB_HSL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return hsl2rgbFloatAVX2; }
+    return hsl2rgbFloatSSE2;
+#else
+    return hsl2rgbFloatScalar;
+#endif
+  }
+
+  void rgb2hslBatch(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    static const Rgb2HslKernel kernel = _selectRgb2Hsl();
+    kernel(rgba, hsla, count);
+  }
+
+  void hsl2rgbBatch(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    static const Hsl2RgbKernel kernel = _selectHsl2Rgb();
+    kernel(hsla, rgba, count);
+  }
+
+  void rgb2hslBatchFloat(unsigned char const * rgba, float * hsla, std::size_t count) {
+    static const Rgb2HslFloatKernel kernel = _selectRgb2HslFloat();
+    kernel(rgba, hsla, count);
+  }
+
+  void hsl2rgbBatchFloat(float const * hsla, unsigned char * rgba, std::size_t count) {
+    static const Hsl2RgbFloatKernel kernel = _selectHsl2RgbFloat();
+    kernel(hsla, rgba, count);
+  }
+}
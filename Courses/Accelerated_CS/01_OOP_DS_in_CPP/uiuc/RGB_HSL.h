@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include "HSLAPixel.h"
 
 namespace uiuc {
   typedef struct {
@@ -14,7 +16,7 @@ namespace uiuc {
     double a;  // [0, 1]
   } hslaColor;
 
-  static hslaColor rgb2hsl(rgbaColor rgb) {
+  inline hslaColor rgb2hsl(rgbaColor rgb) {
     hslaColor hsl;
     double r, g, b, min, max, chroma;
 
@@ -66,7 +68,7 @@ namespace uiuc {
     return hsl;
   }
 
-  static rgbaColor hsl2rgb(hslaColor hsl) {
+  inline rgbaColor hsl2rgb(hslaColor hsl) {
     rgbaColor rgb;
 
     // HSV Calculations -- formulas sourced from https://en.wikipedia.org/wiki/HSL_and_HSV
@@ -94,4 +96,103 @@ namespace uiuc {
     rgb.a = round(hsl.a * 255);
     return rgb;
   }
+
+  /**
+   * rgb2hsl in single precision, for one pixel of RGBA bytes. The result is
+   * written to `hsla` as four floats: h, s, l and a.
+   */
+  inline void rgb2hslFloat(unsigned char const * rgba, float * hsla) {
+    float r = rgba[0] / 255.0f;
+    float g = rgba[1] / 255.0f;
+    float b = rgba[2] / 255.0f;
+    hsla[3] = rgba[3] / 255.0f;
+
+    float min = (r < g) ? r : g;
+    min = (min < b) ? min : b;
+    float max = (r > g) ? r : g;
+    max = (max > b) ? max : b;
+    float chroma = max - min;
+
+    float l = 0.5f * (max + min);
+    hsla[2] = l;
+    if (chroma < 0.0001f || max < 0.0001f) {
+      hsla[0] = hsla[1] = 0;
+      return;
+    }
+
+    hsla[1] = chroma / (1 - std::fabs((2 * l) - 1));
+
+    float h;
+    if      (max == r) { h = std::fmod((g - b) / chroma, 6.0f); }
+    else if (max == g) { h = ((b - r) / chroma) + 2; }
+    else               { h = ((r - g) / chroma) + 4; }
+
+    h *= 60;
+    if (h < 0) { h += 360; }
+    hsla[0] = h;
+  }
+
+  /**
+   * Scales a single-precision channel in [0, 1] to a byte, rounding half up.
+   * Anything below 0, and NaN, becomes 0; anything above 1 becomes 255.
+   */
+  inline unsigned char unitToByteFloat(float v) {
+    v = v * 255.0f + 0.5f;
+    return (v > 0.0f) ? ((v < 255.0f) ? (unsigned char)v : 255) : 0;
+  }
+
+  /**
+   * hsl2rgb in single precision, for one pixel given as four floats: h, s, l
+   * and a. The result is written to `rgba` as four bytes.
+   */
+  inline void hsl2rgbFloat(float const * hsla, unsigned char * rgba) {
+    float h = hsla[0], s = hsla[1], l = hsla[2];
+    if (s <= 0.001f) {
+      rgba[0] = rgba[1] = rgba[2] = unitToByteFloat(l);
+    } else {
+      float c = (1 - std::fabs((2 * l) - 1)) * s;
+      float hh = h / 60;
+      float x = c * (1 - std::fabs(std::fmod(hh, 2.0f) - 1));
+      float r, g, b;
+
+      if (hh <= 1)      { r = c; g = x; b = 0; }
+      else if (hh <= 2) { r = x; g = c; b = 0; }
+      else if (hh <= 3) { r = 0; g = c; b = x; }
+      else if (hh <= 4) { r = 0; g = x; b = c; }
+      else if (hh <= 5) { r = x; g = 0; b = c; }
+      else              { r = c; g = 0; b = x; }
+
+      float m = l - (0.5f * c);
+      rgba[0] = unitToByteFloat(r + m);
+      rgba[1] = unitToByteFloat(g + m);
+      rgba[2] = unitToByteFloat(b + m);
+    }
+    rgba[3] = unitToByteFloat(hsla[3]);
+  }
+
+  /**
+   * Converts `count` pixels of interleaved RGBA bytes (as decoded by lodepng)
+   * to HSLA. The result is bit-for-bit the same as calling rgb2hsl on each
+   * pixel, but several pixels are converted at a time with SSE2 or AVX2,
+   * chosen at run time from what the CPU supports.
+   */
+  void rgb2hslBatch(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count);
+
+  /**
+   * Converts `count` HSLA pixels to interleaved RGBA bytes (as encoded by
+   * lodepng). The result is bit-for-bit the same as calling hsl2rgb on each
+   * pixel, but several pixels are converted at a time with SSE2 or AVX2,
+   * chosen at run time from what the CPU supports.
+   */
+  void hsl2rgbBatch(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count);
+
+  /**
+   * The single-precision versions of rgb2hslBatch and hsl2rgbBatch, where
+   * each HSLA pixel is four consecutive floats (h, s, l, a), as in
+   * BasicHSLAPixel<float>. The results are bit-for-bit the same as calling
+   * rgb2hslFloat or hsl2rgbFloat on each pixel, but four (SSE2) or eight
+   * (AVX2) pixels are converted at a time.
+   */
+  void rgb2hslBatchFloat(unsigned char const * rgba, float * hsla, std::size_t count);
+  void hsl2rgbBatchFloat(float const * hsla, unsigned char * rgba, std::size_t count);
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+/**
+ * @file Resample.cpp
+ * Implementation of separable, multi-threaded image resampling.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Resample.h"
+#include "SIMD.h"
+
+namespace uiuc {
+  // Each pixel of a pass sums a whole filter's worth of taps, many times the
+  // work of a per-pixel transform, so threads are handed a quarter of the
+  // usual number of pixels at once to keep them evenly loaded.
+  static const unsigned kPixelsPerChunk = ThreadPool::kPixelsPerChunk / 4;
+
+  // The vertical pass works on columns of this many floats (256 pixels) at a
+  // time, so the same part of every source row it reads stays in L1 cache.
+  static const unsigned kColumnBlock = 1024;
+
+  static const double kPi = 3.14159265358979323846;
+
+  static double _triangle(double x) {
+    x = std::fabs(x);
+    return (x < 1.0) ? 1.0 - x : 0.0;
+  }
+
+  // Catmull-Rom cubic (Keys' cubic with a = -0.5).
+  static double _cubic(double x) {
+    const double a = -0.5;
+    x = std::fabs(x);
+    if (x < 1.0) { return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0; }
+    if (x < 2.0) { return (((x - 5.0) * x + 8.0) * x - 4.0) * a; }
+    return 0.0;
+  }
+
+  static double _sinc(double x) {
+    if (x == 0.0) { return 1.0; }
+    x *= kPi;
+    return std::sin(x) / x;
+  }
+
+  static double _lanczos3(double x) {
+    return (std::fabs(x) < 3.0) ? _sinc(x) * _sinc(x / 3.0) : 0.0;
+  }
+
+  /**
+   * The source pixels that contribute to each output pixel along one axis,
+   * and how much each one contributes.
+   */
+  struct Contributions {
+    unsigned taps;                  /*< Most source pixels used by one output pixel */
+    std::vector<unsigned> first;    /*< First source pixel of each output pixel */
+    std::vector<unsigned> count;    /*< Number of source pixels of each output pixel */
+    std::vector<float> weights;     /*< `taps` weights per output pixel, summing to 1 */
+  };
+
+  // Computes the filter weights for resampling `in` pixels to `out`. When
+  // shrinking, the filter is widened by the scale so that every source pixel
+  // contributes to the result.
+  static Contributions _contributions(unsigned in, unsigned out, ResizeMode mode) {
+    double (*filter)(double) = _triangle;
+    double support = 1.0;
+    if (mode == ResizeMode::Bicubic) {
+      filter = _cubic;
+      support = 2.0;
+    } else if (mode == ResizeMode::Lanczos) {
+      filter = _lanczos3;
+      support = 3.0;
+    }
+
+    double scale = double(in) / out;
+    double filterScale = std::max(scale, 1.0);
+    support *= filterScale;
+
+    Contributions result;
+    result.taps = std::min(in, unsigned(std::ceil(support)) * 2 + 1);
+    result.first.resize(out);
+    result.count.resize(out);
+    result.weights.assign(std::size_t(out) * result.taps, 0.0f);
+
+    std::vector<double> weights(result.taps);
+    for (unsigned i = 0; i < out; i++) {
+      double center = (i + 0.5) * scale;
+      int lo = std::max(0, int(std::floor(center - support + 0.5)));
+      int hi = std::min(int(in), int(std::floor(center + support + 0.5)));
+      hi = std::min(hi, lo + int(result.taps));
+
+      double total = 0.0;
+      for (int x = lo; x < hi; x++) {
+        weights[x - lo] = filter((x - center + 0.5) / filterScale);
+        total += weights[x - lo];
+      }
+
+      // Near the edges the filter can miss every source pixel; fall back to
+      // the nearest one.
+      if (hi <= lo || total == 0.0) {
+        lo = std::min(int(in) - 1, int(center));
+        hi = lo + 1;
+        weights[0] = total = 1.0;
+      }
+
+      result.first[i] = lo;
+      result.count[i] = hi - lo;
+      for (int x = lo; x < hi; x++) {
+        result.weights[std::size_t(i) * result.taps + (x - lo)] = float(weights[x - lo] / total);
+      }
+    }
+    return result;
+  }
+
+  // Converts a pixel to RGBA in [0, 1] with the color premultiplied by alpha.
+  // These follow hsl2rgb and rgb2hsl, but without rounding to bytes.
+  static void _toRGBA(HSLAPixel const & pixel, float * rgba) {
+    double r, g, b;
+    if (pixel.s <= 0.001) {
+      r = g = b = pixel.l;
+    } else {
+      double c = (1 - std::fabs((2 * pixel.l) - 1)) * pixel.s;
+      double hh = pixel.h / 60;
+      double x = c * (1 - std::fabs(std::fmod(hh, 2) - 1));
+
+      if (hh <= 1)      { r = c; g = x; b = 0; }
+      else if (hh <= 2) { r = x; g = c; b = 0; }
+      else if (hh <= 3) { r = 0; g = c; b = x; }
+      else if (hh <= 4) { r = 0; g = x; b = c; }
+      else if (hh <= 5) { r = x; g = 0; b = c; }
+      else              { r = c; g = 0; b = x; }
+
+      double m = pixel.l - (0.5 * c);
+      r += m;
+      g += m;
+      b += m;
+    }
+
+    rgba[0] = float(r * pixel.a);
+    rgba[1] = float(g * pixel.a);
+    rgba[2] = float(b * pixel.a);
+    rgba[3] = float(pixel.a);
+  }
+
+  static double _clamp(double v) {
+    return (v < 0.0) ? 0.0 : (v > 1.0) ? 1.0 : v;
+  }
+
+  // Converts premultiplied RGBA back to a pixel. Bicubic and Lanczos filters
+  // overshoot at sharp edges, so channels are clamped first.
+  static void _toHSLA(float const * rgba, HSLAPixel & pixel) {
+    double a = _clamp(rgba[3]);
+    pixel.a = a;
+    if (a <= 0.0) {
+      pixel.h = pixel.s = pixel.l = 0;
+      return;
+    }
+
+    double r = _clamp(rgba[0] / a);
+    double g = _clamp(rgba[1] / a);
+    double b = _clamp(rgba[2] / a);
+
+    double min = std::min(std::min(r, g), b);
+    double max = std::max(std::max(r, g), b);
+    double chroma = max - min;
+
+    pixel.l = 0.5 * (max + min);
+    if (chroma < 0.0001 || max < 0.0001) {
+      pixel.h = pixel.s = 0;
+      return;
+    }
+
+    pixel.s = chroma / (1 - std::fabs((2 * pixel.l) - 1));
+
+    double h;
+    if      (max == r) { h = std::fmod((g - b) / chroma, 6); }
+    else if (max == g) { h = ((b - r) / chroma) + 2; }
+    else               { h = ((r - g) / chroma) + 4; }
+
+    h *= 60;
+    if (h < 0) { h += 360; }
+    pixel.h = h;
+  }
+
+  void toPremultipliedRGBA(HSLAPixel const * pixels, float * rgba, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      _toRGBA(pixels[i], rgba + (i * 4));
+    }
+  }
+
+  void fromPremultipliedRGBA(float const * rgba, HSLAPixel * pixels, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      _toHSLA(rgba + (i * 4), pixels[i]);
+    }
+  }
+
+  // Resamples one row of premultiplied RGBA pixels horizontally.
+  static void _resampleRow(float const * in, float * out, unsigned width, Contributions const & c) {
+    for (unsigned x = 0; x < width; x++) {
+      float const * weights = &c.weights[std::size_t(x) * c.taps];
+      float const * pixel = in + std::size_t(c.first[x]) * 4;
+      unsigned count = c.count[x];
+#if UIUC_SSE2
+      __m128 sum = _mm_setzero_ps();
+      for (unsigned k = 0; k < count; k++) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(pixel + k * 4)));
+      }
+      _mm_storeu_ps(out + std::size_t(x) * 4, sum);
+#else
+      float sum[4] = { 0, 0, 0, 0 };
+      for (unsigned k = 0; k < count; k++) {
+        for (unsigned i = 0; i < 4; i++) {
+          sum[i] += weights[k] * pixel[k * 4 + i];
+        }
+      }
+      std::copy(sum, sum + 4, out + std::size_t(x) * 4);
+#endif
+    }
+  }
+
+  // Computes out[i] = sum of weights[k] * rows[k][i] over `size` floats.
+  static void _resampleColumns(float const * const * rows, float const * weights, unsigned count,
+                               float * out, unsigned size) {
+    unsigned i = 0;
+#if UIUC_SSE2
+    for (; i + 4 <= size; i += 4) {
+      __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+      for (unsigned k = 1; k < count; k++) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+      }
+      _mm_storeu_ps(out + i, sum);
+    }
+#endif
+    for (; i < size; i++) {
+      float sum = 0;
+      for (unsigned k = 0; k < count; k++) {
+        sum += weights[k] * rows[k][i];
+      }
+      out[i] = sum;
+    }
+  }
+
+  static void _crop(HSLAPixel const * src, unsigned srcWidth, unsigned srcHeight,
+                    HSLAPixel * dst, unsigned dstWidth, unsigned dstHeight) {
+    unsigned copyWidth = std::min(srcWidth, dstWidth);
+    unsigned copyHeight = std::min(srcHeight, dstHeight);
+    for (unsigned y = 0; y < copyHeight; y++) {
+      HSLAPixel const * srcRow = src + std::size_t(y) * srcWidth;
+      std::copy(srcRow, srcRow + copyWidth, dst + std::size_t(y) * dstWidth);
+    }
+  }
+
+  void resample(HSLAPixel const * src, unsigned int srcWidth, unsigned int srcHeight,
+                HSLAPixel * dst, unsigned int dstWidth, unsigned int dstHeight,
+                ResizeMode mode, ThreadPool & pool) {
+    if (mode == ResizeMode::Crop || srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) {
+      _crop(src, srcWidth, srcHeight, dst, dstWidth, dstHeight);
+      return;
+    }
+
+    Contributions horizontal = _contributions(srcWidth, dstWidth, mode);
+    Contributions vertical = _contributions(srcHeight, dstHeight, mode);
+
+    // Only the source rows some output row reads need to be resampled.
+    unsigned firstRow = vertical.first.front();
+    unsigned lastRow = vertical.first.back() + vertical.count.back();
+
+    // Horizontal pass: each source row is converted to premultiplied RGBA and
+    // resampled to the new width while it is still in cache.
+    std::size_t stride = std::size_t(dstWidth) * 4;
+    std::vector<float> rows(std::size_t(lastRow - firstRow) * stride);
+    pool.parallelFor(firstRow, lastRow, ThreadPool::rowsPerChunk(std::max(srcWidth, dstWidth), kPixelsPerChunk), [&](unsigned y0, unsigned y1) {
+      std::vector<float> rgba(std::size_t(srcWidth) * 4);
+      for (unsigned y = y0; y < y1; y++) {
+        toPremultipliedRGBA(src + std::size_t(y) * srcWidth, rgba.data(), srcWidth);
+        _resampleRow(rgba.data(), &rows[(y - firstRow) * stride], dstWidth, horizontal);
+      }
+    });
+
+    // Vertical pass: each output row is a weighted sum of resampled rows,
+    // computed a block of columns at a time and converted back to HSLA.
+    pool.parallelFor(0, dstHeight, ThreadPool::rowsPerChunk(dstWidth, kPixelsPerChunk), [&](unsigned y0, unsigned y1) {
+      std::vector<float> out(stride);
+      std::vector<float const *> taps(vertical.taps);
+      for (unsigned y = y0; y < y1; y++) {
+        unsigned count = vertical.count[y];
+        float const * weights = &vertical.weights[std::size_t(y) * vertical.taps];
+        for (unsigned x0 = 0; x0 < stride; x0 += kColumnBlock) {
+          for (unsigned k = 0; k < count; k++) {
+            taps[k] = &rows[(vertical.first[y] + k - firstRow) * stride + x0];
+          }
+          unsigned size = std::min<std::size_t>(kColumnBlock, stride - x0);
+          _resampleColumns(taps.data(), weights, count, &out[x0], size);
+        }
+
+        fromPremultipliedRGBA(out.data(), dst + std::size_t(y) * dstWidth, dstWidth);
+      }
+    });
+  }
+}
@@ -0,0 +1,49 @@
+/**
+ * @file Resample.h
+ * Resizing images with interpolation, for scaling images up and down
+ * (thumbnails in particular).
+ *
+ * Pixels are converted from HSLA to premultiplied RGBA floats, so that hue
+ * does not wrap around and transparent pixels do not bleed their color into
+ * their neighbors, then resampled with a separable filter: every row is
+ * resampled horizontally, and then every column vertically. Both passes are
+ * split over a thread pool, and each pixel's four channels are processed
+ * together as one SSE vector.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ThreadPool.h"
+
+namespace uiuc {
+  /**
+   * Resamples an image to a new size.
+   * @param src The srcWidth * srcHeight pixels of the image, in row-major order.
+   * @param srcWidth Width of the image.
+   * @param srcHeight Height of the image.
+   * @param dst Receives the dstWidth * dstHeight pixels of the resized image.
+   * @param dstWidth Width of the resized image.
+   * @param dstHeight Height of the resized image.
+   * @param mode The filter to resample with. ResizeMode::Crop crops and pads
+   *             like PNG::resize.
+   * @param pool Thread pool to resample on.
+   */
+  void resample(HSLAPixel const * src, unsigned int srcWidth, unsigned int srcHeight,
+                HSLAPixel * dst, unsigned int dstWidth, unsigned int dstHeight,
+                ResizeMode mode, ThreadPool & pool);
+
+  /**
+   * Converts pixels to RGBA in [0, 1], with the color premultiplied by
+   * alpha, four floats per pixel. This is the form images are resampled in.
+   */
+  void toPremultipliedRGBA(HSLAPixel const * pixels, float * rgba, std::size_t count);
+
+  /**
+   * Converts premultiplied RGBA back to pixels, clamping every channel to
+   * [0, 1] first.
+   */
+  void fromPremultipliedRGBA(float const * rgba, HSLAPixel * pixels, std::size_t count);
+}
@@ -0,0 +1,17 @@
+/**
+ * @file SIMD.h
+ * The check that decides whether the image library compiles its SSE2 code.
+ */
+
+#pragma once
+
+// SSE2 is part of every x86-64 CPU, and the makefile builds with -msse2, so
+// __SSE2__ is defined whenever the SSE2 intrinsics (and the SSE intrinsics
+// they include) can be used. Every vectorized file checks UIUC_SSE2 and has
+// a plain C++ path for when it is 0.
+#if defined(__SSE2__)
+#define UIUC_SSE2 1
+#include <emmintrin.h>
+#else
+#define UIUC_SSE2 0
+#endif
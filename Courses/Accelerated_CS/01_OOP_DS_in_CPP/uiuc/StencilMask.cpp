@@ -0,0 +1,61 @@
+/**
+ * @file StencilMask.cpp
+ * Implementation of run-length encoded stencil masks.
+ */
+
+#include "StencilMask.h"
+
+namespace uiuc {
+  StencilMask::StencilMask() : width_(0), height_(0), coverage_(0), rowStart_(1, 0) { }
+
+  StencilMask::StencilMask(PNG const & stencil)
+    : width_(stencil.width()), height_(stencil.height()), coverage_(0) {
+    rowStart_.reserve(std::size_t(height_) + 1);
+    for (unsigned y = 0; y < height_; y++) {
+      rowStart_.push_back(runs_.size());
+      HSLAPixel const * row = stencil.row(y);
+      unsigned x = 0;
+      while (x < width_) {
+        if (row[x].l != 1.0) {
+          x++;
+          continue;
+        }
+
+        Run run;
+        run.x = x;
+        while (x < width_ && row[x].l == 1.0) { x++; }
+        run.length = x - run.x;
+        runs_.push_back(run);
+        coverage_ += run.length;
+      }
+      if (runs_.size() != rowStart_.back()) {
+        activeRows_.push_back(y);
+      }
+    }
+    rowStart_.push_back(runs_.size());
+  }
+
+  unsigned int StencilMask::width() const {
+    return width_;
+  }
+
+  unsigned int StencilMask::height() const {
+    return height_;
+  }
+
+  std::size_t StencilMask::coverage() const {
+    return coverage_;
+  }
+
+  StencilMask::Run const * StencilMask::rowBegin(unsigned int y) const {
+    return runs_.data() + rowStart_[y];
+  }
+
+  StencilMask::Run const * StencilMask::rowEnd(unsigned int y) const {
+    return runs_.data() + rowStart_[y + 1];
+  }
+
+  std::vector<unsigned int> const & StencilMask::activeRows() const {
+    return activeRows_;
+  }
+}
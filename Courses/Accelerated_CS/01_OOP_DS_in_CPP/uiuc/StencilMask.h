@@ -0,0 +1,73 @@
+/**
+ * @file StencilMask.h
+ * A compact, precompiled form of a stencil image, holding only its active
+ * pixels as runs within each row.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "PNG.h"
+
+namespace uiuc {
+  class StencilMask {
+  public:
+    /**
+      * A horizontal run of active pixels in one row of the mask.
+      */
+    struct Run {
+      unsigned int x;         /*< First pixel of the run */
+      unsigned int length;    /*< Number of pixels in the run */
+    };
+
+    /**
+      * Creates an empty mask.
+      */
+    StencilMask();
+
+    /**
+      * Compiles a mask from a stencil image. A pixel is active where its
+      * luminance is exactly 1, as in watermark.
+      * @param stencil The stencil image.
+      */
+    explicit StencilMask(PNG const & stencil);
+
+    /**
+      * Gets the width of the stencil the mask was made from.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of the stencil the mask was made from.
+      */
+    unsigned int height() const;
+
+    /**
+      * Gets the number of active pixels.
+      */
+    std::size_t coverage() const;
+
+    /**
+      * Gets the runs of active pixels in a row, left to right. Runs never
+      * touch or overlap.
+      * @param y The row, which must be less than height().
+      * @return Pointers to the first run and one past the last run.
+      */
+    Run const * rowBegin(unsigned int y) const;
+    Run const * rowEnd(unsigned int y) const;
+
+    /**
+      * Gets the rows that have at least one active pixel, top to bottom.
+      */
+    std::vector<unsigned int> const & activeRows() const;
+
+  private:
+    unsigned int width_;                  /*< Width of the stencil */
+    unsigned int height_;                 /*< Height of the stencil */
+    std::size_t coverage_;                /*< Number of active pixels */
+    std::vector<Run> runs_;               /*< Runs of every row, top to bottom */
+    std::vector<std::size_t> rowStart_;   /*< Index in runs_ of the first run of each row, and the end */
+    std::vector<unsigned int> activeRows_; /*< Rows with at least one run */
+  };
+}
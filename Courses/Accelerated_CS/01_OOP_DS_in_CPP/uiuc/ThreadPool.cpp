@@ -0,0 +1,143 @@
+/**
+ * @file ThreadPool.cpp
+ * Implementation of a small fixed-size thread pool.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include "ThreadPool.h"
+
+namespace uiuc {
+  ThreadPool::ThreadPool(unsigned int threads) : stopping_(false) {
+    if (threads == 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+
+    // The thread calling parallelFor counts as one of the threads.
+    for (unsigned i = 1; i < threads; i++) {
+      workers_.emplace_back(&ThreadPool::_work, this);
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread & worker : workers_) { worker.join(); }
+  }
+
+  ThreadPool & ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  unsigned int ThreadPool::size() const {
+    return workers_.size() + 1;
+  }
+
+  void ThreadPool::submit(std::function<void()> task) {
+    if (workers_.empty()) {
+      task();
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+  }
+
+  void ThreadPool::_work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) { return; }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  namespace {
+    // Shared state of one parallelFor call. Helper tasks hold it by
+    // shared_ptr, since a helper may only get to run after the call has
+    // returned; by then every chunk is claimed and the helper exits at once.
+    struct ParallelForState {
+      std::atomic<unsigned> next;
+      unsigned end;
+      unsigned grain;
+      unsigned chunks;
+      std::function<void(unsigned int, unsigned int)> const * body;
+
+      std::mutex mutex;
+      std::condition_variable done;
+      unsigned completed;
+      std::exception_ptr error;
+
+      // Claims and runs chunks until none are left.
+      void run() {
+        for (;;) {
+          unsigned chunkBegin = next.fetch_add(grain);
+          if (chunkBegin >= end) { return; }
+          unsigned chunkEnd = std::min(end, chunkBegin + grain);
+
+          std::exception_ptr chunkError;
+          try {
+            (*body)(chunkBegin, chunkEnd);
+          } catch (...) {
+            chunkError = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          if (chunkError && !error) { error = chunkError; }
+          if (++completed == chunks) { done.notify_all(); }
+        }
+      }
+    };
+  }
+
+  const unsigned int ThreadPool::kPixelsPerChunk;
+
+  unsigned int ThreadPool::rowsPerChunk(unsigned int width, unsigned int pixelsPerChunk) {
+    return std::max(1u, pixelsPerChunk / std::max(1u, width));
+  }
+
+  void ThreadPool::parallelFor(unsigned int begin, unsigned int end, unsigned int grain,
+                               std::function<void(unsigned int, unsigned int)> const & body) {
+    if (begin >= end) { return; }
+    if (grain == 0) { grain = 1; }
+
+    unsigned chunks = ((end - begin) + grain - 1) / grain;
+    if (workers_.empty() || chunks == 1) {
+      body(begin, end);
+      return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->next = begin;
+    state->end = end;
+    state->grain = grain;
+    state->chunks = chunks;
+    state->body = &body;
+    state->completed = 0;
+
+    // Wake at most one helper per remaining chunk. The calling thread runs
+    // chunks as well, so all of them get done even if every worker is busy.
+    unsigned helpers = std::min<unsigned>(workers_.size(), chunks - 1);
+    for (unsigned i = 0; i < helpers; i++) {
+      submit([state] { state->run(); });
+    }
+
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state] { return state->completed == state->chunks; });
+    if (state->error) { std::rethrow_exception(state->error); }
+  }
+}
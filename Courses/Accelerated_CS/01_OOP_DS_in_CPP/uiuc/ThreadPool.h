@@ -0,0 +1,95 @@
+/**
+ * @file ThreadPool.h
+ * A small fixed-size thread pool used to spread image work over CPU cores.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace uiuc {
+  class ThreadPool {
+  public:
+    /**
+      * Creates a pool that runs work on `threads` threads in total, counting
+      * the thread that calls parallelFor. A value of 0 uses one thread per
+      * hardware core.
+      * @param threads Number of threads to run work on.
+      */
+    explicit ThreadPool(unsigned int threads = 0);
+
+    /**
+      * Destructor: finishes any queued tasks and joins the worker threads.
+      */
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const & other) = delete;
+    ThreadPool & operator= (ThreadPool const & other) = delete;
+
+    /**
+      * Gets the pool shared by the image library, sized to the hardware.
+      */
+    static ThreadPool & shared();
+
+    /**
+      * Gets the number of threads work is spread over, including the
+      * calling thread.
+      */
+    unsigned int size() const;
+
+    /**
+      * Queues a task to be run by one of the worker threads. If the pool has
+      * no worker threads, the task is run immediately on the calling thread.
+      * @param task The task to run.
+      */
+    void submit(std::function<void()> task);
+
+    /**
+      * Calls `body(chunkBegin, chunkEnd)` for consecutive chunks of at most
+      * `grain` indices covering [begin, end), in parallel, and returns once
+      * every chunk is done. The calling thread works on chunks too, so this
+      * may be called from inside another task. If a chunk throws, the first
+      * exception is rethrown here after the remaining chunks finish.
+      * @param begin First index of the range.
+      * @param end One past the last index of the range.
+      * @param grain Largest number of indices handed to `body` at once.
+      * @param body The function to call for each chunk.
+      */
+    void parallelFor(unsigned int begin, unsigned int end, unsigned int grain,
+                     std::function<void(unsigned int, unsigned int)> const & body);
+
+    /**
+      * The number of pixels the image library hands to a thread at once
+      * when it splits an image by rows. This keeps the per-chunk overhead
+      * small without starving threads on small images.
+      */
+    static const unsigned int kPixelsPerChunk = 1 << 16;
+
+    /**
+      * Gets the grain for a parallelFor over the rows of an image: how many
+      * rows of `width` pixels make about `pixelsPerChunk` pixels, and at
+      * least one row.
+      * @param width Width of the rows, in pixels.
+      * @param pixelsPerChunk Pixels to hand to a thread at once.
+      * @return The number of rows per chunk.
+      */
+    static unsigned int rowsPerChunk(unsigned int width, unsigned int pixelsPerChunk = kPixelsPerChunk);
+
+  private:
+    std::vector<std::thread> workers_;          /*< Worker threads */
+    std::deque<std::function<void()>> tasks_;   /*< Tasks waiting for a worker */
+    std::mutex mutex_;                          /*< Guards tasks_ and stopping_ */
+    std::condition_variable wake_;              /*< Signalled when tasks_ or stopping_ change */
+    bool stopping_;                             /*< Set when the pool is being destroyed */
+
+    /**
+     * Main loop of each worker thread.
+     */
+    void _work();
+  };
+}
@@ -0,0 +1,127 @@
+/**
+ * @file WorkStealingPool.cpp
+ * Implementation of a thread pool with per-worker queues and work stealing.
+ */
+
+#include <algorithm>
+#include "WorkStealingPool.h"
+
+namespace uiuc {
+  // The pool and queue of the worker running on this thread, if any.
+  static thread_local WorkStealingPool * currentPool = 0;
+  static thread_local unsigned int currentQueue = 0;
+
+  WorkStealingPool::WorkStealingPool(unsigned int threads)
+    : nextQueue_(0), queued_(0), pending_(0), stopping_(false) {
+    if (threads == 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+
+    for (unsigned i = 0; i < threads; i++) {
+      queues_.emplace_back(new Queue);
+    }
+    for (unsigned i = 0; i < threads; i++) {
+      workers_.emplace_back(&WorkStealingPool::_work, this, i);
+    }
+  }
+
+  WorkStealingPool::~WorkStealingPool() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      idle_.wait(lock, [this] { return pending_ == 0; });
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread & worker : workers_) { worker.join(); }
+  }
+
+  unsigned int WorkStealingPool::size() const {
+    return workers_.size();
+  }
+
+  void WorkStealingPool::submit(std::function<void()> task) {
+    unsigned index = (currentPool == this) ? currentQueue : nextQueue_++ % queues_.size();
+
+    // Counted as pending before it can run, so that wait never sees a moment
+    // with no pending tasks while a chain of tasks is still going.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_++;
+    }
+    {
+      std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+      queues_[index]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued_++;
+    }
+    wake_.notify_one();
+  }
+
+  void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) {
+      std::exception_ptr error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+  bool WorkStealingPool::_take(unsigned int index, std::function<void()> & task) {
+    {
+      Queue & own = *queues_[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+
+    for (unsigned i = 1; i < queues_.size(); i++) {
+      Queue & victim = *queues_[(index + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void WorkStealingPool::_work(unsigned int index) {
+    currentPool = this;
+    currentQueue = index;
+
+    for (;;) {
+      std::function<void()> task;
+      if (!_take(index, task)) {
+        // queued_ only counts tasks once they are in a queue, so if it is
+        // not 0 there is something to take, unless another worker is taking
+        // it right now, in which case this just looks again.
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0) { return; }
+        continue;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_--;
+      }
+
+      std::exception_ptr taskError;
+      try {
+        task();
+      } catch (...) {
+        taskError = std::current_exception();
+      }
+      task = nullptr;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (taskError && !error_) { error_ = taskError; }
+      if (--pending_ == 0) { idle_.notify_all(); }
+    }
+  }
+}
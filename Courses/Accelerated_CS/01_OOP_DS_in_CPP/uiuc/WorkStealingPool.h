@@ -0,0 +1,94 @@
+/**
+ * @file WorkStealingPool.h
+ * A thread pool for many independent jobs that each run as a chain of
+ * tasks, such as decoding, transforming and encoding a batch of images.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace uiuc {
+  class WorkStealingPool {
+  public:
+    /**
+      * Creates a pool of worker threads, each with its own queue of tasks.
+      * A worker runs the newest task of its own queue first, so a task
+      * submitted from inside another task (the next stage of the same job)
+      * usually runs next on the same thread, while its data is still in
+      * cache. A worker whose queue is empty steals the oldest task from
+      * another worker's queue.
+      * @param threads Number of worker threads. A value of 0 uses one thread
+      *                per hardware core.
+      */
+    explicit WorkStealingPool(unsigned int threads = 0);
+
+    /**
+      * Destructor: finishes every task, including ones submitted by other
+      * tasks, and joins the worker threads.
+      */
+    ~WorkStealingPool();
+
+    WorkStealingPool(WorkStealingPool const & other) = delete;
+    WorkStealingPool & operator= (WorkStealingPool const & other) = delete;
+
+    /**
+      * Gets the number of worker threads.
+      */
+    unsigned int size() const;
+
+    /**
+      * Queues a task. From inside a task of this pool, the task goes on the
+      * current worker's own queue; from anywhere else, the queues are used
+      * in turn.
+      * @param task The task to run.
+      */
+    void submit(std::function<void()> task);
+
+    /**
+      * Waits until every submitted task has finished, including tasks
+      * submitted by other tasks while waiting. If a task threw, the first
+      * exception is rethrown here. Must not be called from inside a task.
+      */
+    void wait();
+
+  private:
+    /**
+     * A worker's queue of tasks.
+     */
+    struct Queue {
+      std::mutex mutex;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;  /*< One queue per worker */
+    std::vector<std::thread> workers_;            /*< Worker threads */
+    std::atomic<unsigned int> nextQueue_;         /*< Queue for the next task submitted from outside */
+    std::mutex mutex_;                            /*< Guards the fields below */
+    std::condition_variable wake_;                /*< Signalled when tasks are queued or stopping_ is set */
+    std::condition_variable idle_;                /*< Signalled when pending_ reaches 0 */
+    unsigned int queued_;                         /*< Tasks sitting in queues */
+    unsigned int pending_;                        /*< Tasks submitted but not yet finished */
+    std::exception_ptr error_;                    /*< First exception thrown by a task */
+    bool stopping_;                               /*< Set when the pool is being destroyed */
+
+    /**
+     * Main loop of the worker thread with the given queue.
+     */
+    void _work(unsigned int index);
+
+    /**
+     * Takes the newest task from queue `index`, or else the oldest task of
+     * any other queue.
+     */
+    bool _take(unsigned int index, std::function<void()> & task);
+  };
+}
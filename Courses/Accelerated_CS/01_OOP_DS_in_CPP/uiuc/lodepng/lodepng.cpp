@@ -34,6 +34,11 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LODEPNG_FILTER_SSE2
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -1315,6 +1320,58 @@ static unsigned inflate(unsigned char** out, size_t* outsize,
   }
 }
 
+/*
+The decompressed data is only kept for as long as deflate back-references can reach it,
+plus the output of the current block. Once more than this much is held beyond the
+window, it is handed to the callback.
+*/
+#define INFLATE_STREAM_WINDOW 32768
+#define INFLATE_STREAM_FLUSH 262144
+
+unsigned lodepng_inflate_stream(const unsigned char* in, size_t insize,
+                                lodepng_stream_callback callback, void* context,
+                                const LodePNGDecompressSettings* settings)
+{
+  size_t bp = 0;
+  unsigned BFINAL = 0;
+  size_t pos = 0; /*byte position in the window buffer*/
+  unsigned error = 0;
+  ucvector window;
+
+  (void)settings;
+  ucvector_init(&window);
+
+  while(!BFINAL && !error)
+  {
+    unsigned BTYPE;
+    if(bp + 2 >= insize * 8) { error = 52; break; } /*error, bit pointer will jump past memory*/
+    BFINAL = readBitFromStream(&bp, in);
+    BTYPE = 1u * readBitFromStream(&bp, in);
+    BTYPE += 2u * readBitFromStream(&bp, in);
+
+    if(BTYPE == 3) { error = 20; break; } /*error: invalid BTYPE*/
+    else if(BTYPE == 0) error = inflateNoCompression(&window, in, &bp, &pos, insize); /*no compression*/
+    else error = inflateHuffmanBlock(&window, in, &bp, &pos, insize, BTYPE); /*compression, BTYPE 01 or 10*/
+
+    /*hand everything but the last window to the callback and slide the window to the front*/
+    if(!error && pos > INFLATE_STREAM_WINDOW + INFLATE_STREAM_FLUSH)
+    {
+      size_t flushed = pos - INFLATE_STREAM_WINDOW;
+      error = callback(window.data, flushed, context);
+      if(!error)
+      {
+        memmove(window.data, window.data + flushed, INFLATE_STREAM_WINDOW);
+        pos = INFLATE_STREAM_WINDOW;
+        ucvector_resize(&window, pos);
+      }
+    }
+  }
+
+  if(!error && pos > 0) error = callback(window.data, pos, context);
+  ucvector_cleanup(&window);
+  return error;
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -1665,6 +1722,8 @@ static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, s
 
   size_t i, j, numdeflateblocks = (datasize + 65534) / 65535;
   unsigned datapos = 0;
+  /*empty input still needs one (empty, final) block to end the stream*/
+  if(numdeflateblocks == 0) numdeflateblocks = 1;
   for(i = 0; i != numdeflateblocks; ++i)
   {
     unsigned BFINAL, BTYPE, LEN, NLEN;
@@ -2076,6 +2135,87 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
   return error;
 }
 
+unsigned lodepng_deflate_part(unsigned char** out, size_t* outsize,
+                              const unsigned char* in, size_t inpos, size_t insize,
+                              unsigned final, const LodePNGCompressSettings* settings)
+{
+  unsigned error = 0;
+  size_t i, pos, blocksize, numdeflateblocks;
+  size_t bp = 0; /*the bit pointer, relative to the end of the existing output*/
+  size_t datasize = insize - inpos;
+  ucvector v;
+  Hash hash;
+
+  if(settings->btype > 2) return 61;
+  if(inpos > insize) return 48;
+  ucvector_init_buffer(&v, *out, *outsize);
+
+  if(settings->btype == 0)
+  {
+    /*stored blocks are byte aligned, so the only change needed is the BFINAL bit*/
+    size_t start = v.size;
+    if(datasize > 0 || final) error = deflateNoCompression(&v, in + inpos, datasize);
+    if(!error && !final && datasize > 0)
+    {
+      for(pos = start; pos < v.size; pos += 5 + 65535) v.data[pos] &= (unsigned char)~1u;
+    }
+  }
+  else if(datasize > 0 || final)
+  {
+    if(settings->btype == 1) blocksize = datasize;
+    else
+    {
+      /*same block sizes as lodepng_deflate*/
+      blocksize = datasize / 8 + 8;
+      if(blocksize < 65536) blocksize = 65536;
+      if(blocksize > 262144) blocksize = 262144;
+    }
+
+    numdeflateblocks = (datasize + blocksize - 1) / blocksize;
+    if(numdeflateblocks == 0) numdeflateblocks = 1;
+
+    error = hash_init(&hash, settings->windowsize);
+    if(!error)
+    {
+      /*fill the hash chains with the dictionary, the same way encodeLZ77 would have*/
+      pos = inpos > settings->windowsize ? inpos - settings->windowsize : 0;
+      for(; pos < inpos; ++pos)
+      {
+        unsigned hashval = getHash(in, insize, pos);
+        unsigned numzeros = hashval == 0 ? countZeros(in, insize, pos) : 0;
+        updateHashChain(&hash, pos & (settings->windowsize - 1), hashval, (unsigned short)numzeros);
+      }
+    }
+
+    for(i = 0; i != numdeflateblocks && !error; ++i)
+    {
+      unsigned last = final && (i == numdeflateblocks - 1);
+      size_t start = inpos + i * blocksize;
+      size_t end = start + blocksize;
+      if(end > insize) end = insize;
+
+      if(settings->btype == 1) error = deflateFixed(&v, &bp, &hash, in, start, end, settings, last);
+      else error = deflateDynamic(&v, &bp, &hash, in, start, end, settings, last);
+    }
+
+    hash_cleanup(&hash);
+  }
+
+  if(!error && !final && settings->btype != 0)
+  {
+    /*sync flush: an empty, non-final stored block brings the stream back to a byte boundary*/
+    addBitsToStream(&bp, &v, 0, 3);
+    ucvector_push_back(&v, 0);
+    ucvector_push_back(&v, 0);
+    ucvector_push_back(&v, 255);
+    ucvector_push_back(&v, 255);
+  }
+
+  *out = v.data;
+  *outsize = v.size;
+  return error;
+}
+
 static unsigned deflate(unsigned char** out, size_t* outsize,
                         const unsigned char* in, size_t insize,
                         const LodePNGCompressSettings* settings)
@@ -2125,6 +2265,18 @@ static unsigned adler32(const unsigned char* data, unsigned len)
   return update_adler32(1L, data, len);
 }
 
+unsigned lodepng_update_adler32(unsigned adler, const unsigned char* data, size_t len)
+{
+  while(len > 0)
+  {
+    unsigned amount = len > 1073741824 ? 1073741824 : (unsigned)len;
+    adler = update_adler32(adler, data, amount);
+    data += amount;
+    len -= amount;
+  }
+  return adler;
+}
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2189,6 +2341,50 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   }
 }
 
+typedef struct ZlibStreamContext
+{
+  lodepng_stream_callback callback;
+  void* context;
+  unsigned adler;
+  unsigned check_adler32;
+} ZlibStreamContext;
+
+static unsigned zlib_stream_callback(const unsigned char* data, size_t size, void* context)
+{
+  ZlibStreamContext* zlib = (ZlibStreamContext*)context;
+  if(zlib->check_adler32) zlib->adler = lodepng_update_adler32(zlib->adler, data, size);
+  return zlib->callback(data, size, zlib->context);
+}
+
+unsigned lodepng_zlib_decompress_stream(const unsigned char* in, size_t insize,
+                                        lodepng_stream_callback callback, void* context,
+                                        const LodePNGDecompressSettings* settings)
+{
+  unsigned error = 0;
+  ZlibStreamContext zlib;
+
+  if(insize < 2) return 53; /*error, size of zlib data too small*/
+  if((in[0] * 256 + in[1]) % 31 != 0) return 24; /*error: FCHECK is not valid*/
+  if((in[0] & 15) != 8 || ((in[0] >> 4) & 15) > 7) return 25; /*error: only deflate with a 32k window*/
+  if(((in[1] >> 5) & 1) != 0) return 26; /*error: PNG does not allow a preset dictionary*/
+
+  zlib.callback = callback;
+  zlib.context = context;
+  zlib.adler = 1;
+  zlib.check_adler32 = !settings->ignore_adler32;
+
+  error = lodepng_inflate_stream(in + 2, insize - 2, zlib_stream_callback, &zlib, settings);
+  if(error) return error;
+
+  if(zlib.check_adler32)
+  {
+    if(insize < 6) return 53;
+    if(zlib.adler != lodepng_read32bitInt(&in[insize - 4])) return 58; /*error, adler checksum not correct*/
+  }
+
+  return 0; /*no error*/
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -4099,6 +4295,12 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   return 0;
 }
 
+unsigned lodepng_unfilter_scanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                   size_t bytewidth, unsigned char filterType, size_t length)
+{
+  return unfilterScanline(recon, scanline, precon, bytewidth, filterType, length);
+}
+
 static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp)
 {
   /*
@@ -4328,6 +4530,47 @@ static unsigned readChunk_tRNS(LodePNGColorMode* color, const unsigned char* dat
   return 0; /* OK */
 }
 
+unsigned lodepng_inspect_chunk(LodePNGState* state, const unsigned char* chunk, size_t chunksize)
+{
+  unsigned chunkLength;
+  const unsigned char* data;
+
+  if(chunksize < 12) CERROR_RETURN_ERROR(state->error, 30); /*error: too small to contain a chunk*/
+  chunkLength = lodepng_chunk_length(chunk);
+  if(chunkLength > 2147483647) CERROR_RETURN_ERROR(state->error, 63);
+  if((size_t)chunkLength + 12 > chunksize) CERROR_RETURN_ERROR(state->error, 64);
+  data = lodepng_chunk_data_const(chunk);
+
+  if(lodepng_chunk_type_equals(chunk, "PLTE"))
+  {
+    state->error = readChunk_PLTE(&state->info_png.color, data, chunkLength);
+  }
+  else if(lodepng_chunk_type_equals(chunk, "tRNS"))
+  {
+    state->error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
+  }
+  else if(lodepng_chunk_type_equals(chunk, "IHDR") || lodepng_chunk_type_equals(chunk, "IDAT")
+          || lodepng_chunk_type_equals(chunk, "IEND"))
+  {
+    return state->error = 0; /*handled by the caller*/
+  }
+  else
+  {
+    /*other chunks do not change how the pixels are decoded*/
+    if(!state->decoder.ignore_critical && !lodepng_chunk_ancillary(chunk))
+    {
+      CERROR_RETURN_ERROR(state->error, 69); /*error: unknown critical chunk*/
+    }
+    return state->error = 0;
+  }
+
+  if(!state->error && !state->decoder.ignore_crc && lodepng_chunk_check_crc(chunk))
+  {
+    state->error = 57; /*invalid CRC*/
+  }
+  return state->error;
+}
+
 
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
 /*background color chunk (bKGD)*/
@@ -5275,6 +5518,205 @@ static float flog2(float f)
   return result + 1.442695f * (f * f * f / 3 - 3 * f * f / 2 + 3 * f - 1.83333f);
 }
 
+/*
+Filters one scanline with each of the 5 filter types and keeps the one with the smallest sum of
+absolute values (LFS_MINSUM). out gets the filter type byte followed by the filtered scanline.
+attempt must point to 5 buffers of length bytes each.
+*/
+static void filterScanlineMinSum(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
+                                 size_t length, size_t bytewidth, unsigned char* attempt[5])
+{
+  size_t sum[5];
+  size_t smallest = 0;
+  size_t x;
+  unsigned char type, bestType = 0;
+
+  /*try the 5 filter types*/
+  for(type = 0; type != 5; ++type)
+  {
+    filterScanline(attempt[type], scanline, prevline, length, bytewidth, type);
+
+    /*calculate the sum of the result*/
+    sum[type] = 0;
+    if(type == 0)
+    {
+      for(x = 0; x != length; ++x) sum[type] += (unsigned char)(attempt[type][x]);
+    }
+    else
+    {
+      for(x = 0; x != length; ++x)
+      {
+        /*For differences, each byte should be treated as signed, values above 127 are negative
+        (converted to signed char). Filtertype 0 isn't a difference though, so use unsigned there.
+        This means filtertype 0 is almost never chosen, but that is justified.*/
+        unsigned char s = attempt[type][x];
+        sum[type] += s < 128 ? s : (255U - s);
+      }
+    }
+
+    /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
+    if(type == 0 || sum[type] < smallest)
+    {
+      bestType = type;
+      smallest = sum[type];
+    }
+  }
+
+  /*now fill the out values*/
+  out[0] = bestType; /*the first byte of a scanline will be the filter type*/
+  for(x = 0; x != length; ++x) out[1 + x] = attempt[bestType][x];
+}
+
+/*adds the minimum sum contributions of byte i of the scanline to sum, for each filter type*/
+static void addMinSumByte(size_t sum[5], const unsigned char* scanline, const unsigned char* prevline,
+                          size_t bytewidth, size_t i)
+{
+  unsigned char x = scanline[i];
+  unsigned char a = i >= bytewidth ? scanline[i - bytewidth] : 0;
+  unsigned char b = prevline ? prevline[i] : 0;
+  unsigned char c = (prevline && i >= bytewidth) ? prevline[i - bytewidth] : 0;
+  unsigned char d[4];
+  unsigned type;
+
+  d[0] = (unsigned char)(x - a);
+  d[1] = (unsigned char)(x - b);
+  d[2] = (unsigned char)(x - ((a + b) >> 1));
+  d[3] = (unsigned char)(x - paethPredictor(a, b, c));
+
+  sum[0] += x;
+  for(type = 0; type != 4; ++type) sum[type + 1] += d[type] < 128 ? d[type] : (255U - d[type]);
+}
+
+#ifdef LODEPNG_FILTER_SSE2
+/*sum of the bytes of v, each taken as min(v, 255 - v), in the two 64-bit halves*/
+static __m128i sumSignedBytes(__m128i v)
+{
+  __m128i inverted = _mm_xor_si128(v, _mm_set1_epi8((char)0xFF));
+  return _mm_sad_epu8(_mm_min_epu8(v, inverted), _mm_setzero_si128());
+}
+
+/*the Paeth predictor of 8 pixels' bytes, widened to 16 bits*/
+static __m128i paethPredictor8(__m128i a, __m128i b, __m128i c)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i pa = _mm_sub_epi16(b, c);
+  __m128i pb = _mm_sub_epi16(a, c);
+  __m128i pc = _mm_add_epi16(pa, pb);
+  __m128i useC, useB;
+  pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+  pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+  pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+  /*same order of comparisons as paethPredictor*/
+  useC = _mm_and_si128(_mm_cmplt_epi16(pc, pa), _mm_cmplt_epi16(pc, pb));
+  useB = _mm_andnot_si128(useC, _mm_cmplt_epi16(pb, pa));
+  return _mm_or_si128(_mm_or_si128(_mm_and_si128(useC, c), _mm_and_si128(useB, b)),
+                      _mm_andnot_si128(_mm_or_si128(useC, useB), a));
+}
+#endif /*LODEPNG_FILTER_SSE2*/
+
+/*
+Same result as filterScanlineMinSum, but without trying each filter into its own buffer:
+the sums of all 5 filter types are computed in one pass, 16 bytes at a time with SSE2,
+and only the chosen filter is applied.
+*/
+static void filterScanlineMinSumFast(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
+                                     size_t length, size_t bytewidth)
+{
+  size_t sum[5] = {0, 0, 0, 0, 0};
+  size_t i = 0;
+  size_t smallest = 0;
+  unsigned char type, bestType = 0;
+
+  /*the first pixel has no left neighbour*/
+  for(; i < bytewidth && i < length; ++i) addMinSumByte(sum, scanline, prevline, bytewidth, i);
+
+#ifdef LODEPNG_FILTER_SSE2
+  {
+    __m128i zero = _mm_setzero_si128();
+    __m128i total[5];
+    for(type = 0; type != 5; ++type) total[type] = zero;
+
+    for(; i + 16 <= length; i += 16)
+    {
+      __m128i x = _mm_loadu_si128((const __m128i*)&scanline[i]);
+      __m128i a = _mm_loadu_si128((const __m128i*)&scanline[i - bytewidth]);
+      __m128i b = prevline ? _mm_loadu_si128((const __m128i*)&prevline[i]) : zero;
+      __m128i c = prevline ? _mm_loadu_si128((const __m128i*)&prevline[i - bytewidth]) : zero;
+      /*floor((a + b) / 2): _mm_avg_epu8 rounds up, so take off the odd bit*/
+      __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+      __m128i paeth = _mm_packus_epi16(
+          paethPredictor8(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero)),
+          paethPredictor8(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero)));
+
+      total[0] = _mm_add_epi64(total[0], _mm_sad_epu8(x, zero));
+      total[1] = _mm_add_epi64(total[1], sumSignedBytes(_mm_sub_epi8(x, a)));
+      total[2] = _mm_add_epi64(total[2], sumSignedBytes(_mm_sub_epi8(x, b)));
+      total[3] = _mm_add_epi64(total[3], sumSignedBytes(_mm_sub_epi8(x, average)));
+      total[4] = _mm_add_epi64(total[4], sumSignedBytes(_mm_sub_epi8(x, paeth)));
+    }
+
+    for(type = 0; type != 5; ++type)
+    {
+      unsigned long long halves[2];
+      _mm_storeu_si128((__m128i*)halves, total[type]);
+      sum[type] += (size_t)(halves[0] + halves[1]);
+    }
+  }
+#endif /*LODEPNG_FILTER_SSE2*/
+
+  for(; i < length; ++i) addMinSumByte(sum, scanline, prevline, bytewidth, i);
+
+  /*smallest sum wins, and the earliest filter type on a tie*/
+  for(type = 0; type != 5; ++type)
+  {
+    if(type == 0 || sum[type] < smallest)
+    {
+      bestType = type;
+      smallest = sum[type];
+    }
+  }
+
+  out[0] = bestType;
+  filterScanline(&out[1], scanline, prevline, length, bytewidth, bestType);
+}
+
+typedef struct FilterRows
+{
+  unsigned char* out;
+  const unsigned char* in;
+  size_t linebytes;
+  size_t bytewidth;
+} FilterRows;
+
+/*filters the rows [begin, end) of an image with filterScanlineMinSumFast*/
+static void filterRowsMinSum(void* context, size_t begin, size_t end)
+{
+  const FilterRows* rows = (const FilterRows*)context;
+  size_t y;
+  for(y = begin; y < end; ++y)
+  {
+    const unsigned char* prevline = y > 0 ? &rows->in[(y - 1) * rows->linebytes] : 0;
+    filterScanlineMinSumFast(&rows->out[y * (rows->linebytes + 1)], &rows->in[y * rows->linebytes], prevline,
+                             rows->linebytes, rows->bytewidth);
+  }
+}
+
+unsigned lodepng_filter_scanline(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
+                                 size_t length, size_t bytewidth, LodePNGFilterStrategy strategy)
+{
+  if(strategy == LFS_ZERO)
+  {
+    out[0] = 0;
+    filterScanline(&out[1], scanline, prevline, length, bytewidth, 0);
+    return 0;
+  }
+  if(strategy != LFS_MINSUM) return 88; /*only the per-scanline strategies are supported here*/
+
+  filterScanlineMinSumFast(out, scanline, prevline, length, bytewidth);
+  return 0;
+}
+
 static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
                        const LodePNGColorMode* info, const LodePNGEncoderSettings* settings)
 {
@@ -5323,13 +5765,22 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       prevline = &in[inindex];
     }
   }
+  else if(strategy == LFS_MINSUM && settings->fast_filter)
+  {
+    /*same output as below, computed row by row on the caller's threads if it gave any*/
+    FilterRows rows;
+    rows.out = out;
+    rows.in = in;
+    rows.linebytes = linebytes;
+    rows.bytewidth = bytewidth;
+    if(settings->parallel_for) settings->parallel_for(filterRowsMinSum, &rows, h, settings->parallel_context);
+    else filterRowsMinSum(&rows, 0, h);
+  }
   else if(strategy == LFS_MINSUM)
   {
     /*adaptive filtering*/
-    size_t sum[5];
     unsigned char* attempt[5]; /*five filtering attempts, one for each filter type*/
-    size_t smallest = 0;
-    unsigned char type, bestType = 0;
+    unsigned char type;
 
     for(type = 0; type != 5; ++type)
     {
@@ -5341,42 +5792,8 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
     {
       for(y = 0; y != h; ++y)
       {
-        /*try the 5 filter types*/
-        for(type = 0; type != 5; ++type)
-        {
-          filterScanline(attempt[type], &in[y * linebytes], prevline, linebytes, bytewidth, type);
-
-          /*calculate the sum of the result*/
-          sum[type] = 0;
-          if(type == 0)
-          {
-            for(x = 0; x != linebytes; ++x) sum[type] += (unsigned char)(attempt[type][x]);
-          }
-          else
-          {
-            for(x = 0; x != linebytes; ++x)
-            {
-              /*For differences, each byte should be treated as signed, values above 127 are negative
-              (converted to signed char). Filtertype 0 isn't a difference though, so use unsigned there.
-              This means filtertype 0 is almost never chosen, but that is justified.*/
-              unsigned char s = attempt[type][x];
-              sum[type] += s < 128 ? s : (255U - s);
-            }
-          }
-
-          /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
-          if(type == 0 || sum[type] < smallest)
-          {
-            bestType = type;
-            smallest = sum[type];
-          }
-        }
-
+        filterScanlineMinSum(&out[y * (linebytes + 1)], &in[y * linebytes], prevline, linebytes, bytewidth, attempt);
         prevline = &in[y * linebytes];
-
-        /*now fill the out values*/
-        out[y * (linebytes + 1)] = bestType; /*the first byte of a scanline will be the filter type*/
-        for(x = 0; x != linebytes; ++x) out[y * (linebytes + 1) + 1 + x] = attempt[bestType][x];
       }
     }
 
@@ -5956,6 +6373,9 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings)
   settings->auto_convert = 1;
   settings->force_palette = 0;
   settings->predefined_filters = 0;
+  settings->fast_filter = 0;
+  settings->parallel_for = 0;
+  settings->parallel_context = 0;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   settings->add_id = 0;
   settings->text_compression = 1;
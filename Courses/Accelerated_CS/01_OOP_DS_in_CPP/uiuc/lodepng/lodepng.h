@@ -609,6 +609,18 @@ typedef struct LodePNGEncoderSettings
   /*force creating a PLTE chunk if colortype is 2 or 6 (= a suggested palette).
   If colortype is 3, PLTE is _always_ created.*/
   unsigned force_palette;
+
+  /*With LFS_MINSUM, sum up all 5 filter types in one pass over each scanline (16 bytes
+  at a time with SSE2, where available) instead of trying each one into a buffer, and
+  filter the scanlines with parallel_for if it is set. The output is identical.
+  Default: 0*/
+  unsigned fast_filter;
+  /*Used by fast_filter to filter scanlines in parallel. It must call task(task_context,
+  begin, end) for disjoint ranges that together cover [0, count), on any threads, and
+  return once all of them are done. parallel_context is passed through. Default: NULL*/
+  void (*parallel_for)(void (*task)(void* task_context, size_t begin, size_t end),
+                       void* task_context, size_t count, void* parallel_context);
+  void* parallel_context;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   /*add LodePNG identifier and version as a text chunk, for debugging*/
   unsigned add_id;
@@ -663,6 +675,22 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Reads one chunk that comes after the header, for decoding the image data yourself
+(e.g. scanline by scanline). PLTE and tRNS are stored in state->info_png.color; other
+chunks are checked but otherwise ignored. chunksize is the number of bytes available
+at chunk, which must hold the whole chunk including its length, type and CRC.
+*/
+unsigned lodepng_inspect_chunk(LodePNGState* state, const unsigned char* chunk, size_t chunksize);
+
+/*
+Undoes the filter of one scanline. scanline does not include the filter type byte, that
+one is given in filterType. precon is the previous unfiltered scanline, or NULL for the
+first one. recon and scanline may be the same buffer.
+*/
+unsigned lodepng_unfilter_scanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                   size_t bytewidth, unsigned char filterType, size_t length);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 
@@ -671,6 +699,15 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h,
 unsigned lodepng_encode(unsigned char** out, size_t* outsize,
                         const unsigned char* image, unsigned w, unsigned h,
                         LodePNGState* state);
+
+/*
+Filters one scanline for encoding the image data yourself. out must have room for
+length + 1 bytes: the chosen filter type byte followed by the filtered scanline.
+prevline is the previous unfiltered scanline, or NULL for the first one. Only the
+strategies that work one scanline at a time, LFS_ZERO and LFS_MINSUM, are supported.
+*/
+unsigned lodepng_filter_scanline(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
+                                 size_t length, size_t bytewidth, LodePNGFilterStrategy strategy);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 /*
@@ -747,9 +784,26 @@ unsigned lodepng_crc32(const unsigned char* buf, size_t len);
 /*
 This zlib part can be used independently to zlib compress and decompress a
 buffer. It cannot be used to create gzip files however, and it only supports the
-part of zlib that is required for PNG, it does not support dictionaries.
+part of zlib that is required for PNG. It does not read or write the preset
+dictionary field of a zlib header (FDICT).
+
+Besides the whole-buffer functions, it can also work on a stream a piece at a
+time: lodepng_inflate_stream and lodepng_zlib_decompress_stream hand their
+output to a callback as it is produced, and lodepng_deflate_part compresses one
+part of a larger deflate stream, using the data before it as a dictionary that
+matches may refer back into. lodepng_update_adler32 keeps the zlib checksum of
+such a stream.
 */
 
+/*
+Receives consecutive pieces of a stream. Return 0 to continue, or an error code to stop;
+the error code is then returned by the function that called it.
+*/
+typedef unsigned (*lodepng_stream_callback)(const unsigned char* data, size_t size, void* context);
+
+/*Updates a running Adler-32 checksum (start with 1) with more data.*/
+unsigned lodepng_update_adler32(unsigned adler, const unsigned char* data, size_t len);
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*Inflate a buffer. Inflate is the decompression step of deflate. Out buffer must be freed after use.*/
 unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
@@ -765,6 +819,20 @@ buffer and *outsize its size in bytes. out must be freed by user after usage.
 unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize,
                                  const unsigned char* in, size_t insize,
                                  const LodePNGDecompressSettings* settings);
+
+/*
+Same as lodepng_inflate, but instead of building the whole output, hands it to callback
+in order, piece by piece. Only the last 32KB plus the current deflate block are held in
+memory. custom_inflate is not used.
+*/
+unsigned lodepng_inflate_stream(const unsigned char* in, size_t insize,
+                                lodepng_stream_callback callback, void* context,
+                                const LodePNGDecompressSettings* settings);
+
+/*Same as lodepng_zlib_decompress, but streams the output like lodepng_inflate_stream.*/
+unsigned lodepng_zlib_decompress_stream(const unsigned char* in, size_t insize,
+                                        lodepng_stream_callback callback, void* context,
+                                        const LodePNGDecompressSettings* settings);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -791,6 +859,17 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings);
 
+/*
+Compresses in[inpos..insize) as a part of a larger deflate stream and appends it to out.
+in[0..inpos) is used as a preset dictionary: matches may refer back into it (up to the
+window size), but it is not itself output. If final is 0, the output ends with an empty
+stored block so that it is byte aligned and more parts can be appended after it. If
+final is 1, the last block is marked as the end of the stream. custom_deflate is not used.
+*/
+unsigned lodepng_deflate_part(unsigned char** out, size_t* outsize,
+                              const unsigned char* in, size_t inpos, size_t insize,
+                              unsigned final, const LodePNGCompressSettings* settings);
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_ZLIB*/
 
@@ -5,10 +5,22 @@ ZIP_FILE = ImageTransform_submission.zip
 COLLECTED_FILES = uiuc/HSLAPixel.h uiuc/HSLAPixel.cpp ImageTransform.h ImageTransform.cpp
 
 # Add standard object files (HSLAPixel, PNG, and LodePNG)
-OBJS += uiuc/HSLAPixel.o uiuc/PNG.o uiuc/lodepng/lodepng.o
+OBJS += uiuc/HSLAPixel.o uiuc/BasicPNG.o uiuc/PNG.o uiuc/RGB_HSL.o uiuc/RGBAImage.o uiuc/ThreadPool.o uiuc/WorkStealingPool.o uiuc/ImageCompare.o uiuc/ImageHash.o uiuc/HuePalette.o uiuc/MappedFile.o uiuc/MipPyramid.o uiuc/PNGStream.o uiuc/PNGView.o uiuc/PixelPipeline.o uiuc/Resample.o uiuc/StencilMask.o uiuc/lodepng/lodepng.o
+
+# The batch driver links the same objects as the main executable, except for
+# the main executable's own main().
+BATCH = batch
+BATCH_OBJ = batch.o
+
+# So does the benchmark suite, which is not built by `all`: run `make bench`.
+# Its timings are only meaningful for optimized code, so it and the objects
+# it links are compiled with BENCH_CXXFLAGS into a directory of their own.
+BENCH = bench
+BENCH_OBJ = bench.o
 
 # Use ./.objs to store all .o file (keeping the directory clean)
 OBJS_DIR = .objs
+BENCH_OBJS_DIR = .objs-bench
 
 # Use all .cpp files in /tests/
 OBJS_TEST = $(filter-out $(EXE_OBJ), $(OBJS))
@@ -29,6 +41,7 @@ STDLIBVERSION_GNU =   # blank on purpose; default GNU library
 STDLIBVERSION = $(STDLIBVERSION_GNU)
 WARNINGS = -pedantic -Wall -Wfatal-errors -Wextra -Wno-unused-parameter -Wno-unused-variable
 CXXFLAGS = $(CS400) $(STDVERSION) $(STDLIBVERSION) -g -O0 $(WARNINGS) -MMD -MP -msse2 -c
+BENCH_CXXFLAGS = $(CS400) $(STDVERSION) $(STDLIBVERSION) -O2 -DNDEBUG $(WARNINGS) -MMD -MP -msse2 -c
 LDFLAGS = $(CS400) $(STDVERSION) $(STDLIBVERSION) -lpthread
 ASANFLAGS = -fsanitize=address -fno-omit-frame-pointer
 
@@ -40,8 +53,23 @@ $(EXE):
 	@echo " (Make sure you try \"make test\" too!)"
 	@echo ""
 
+# Rule for the batch executable
+$(BATCH):
+	$(LD) $^ $(LDFLAGS) -o $@
+	@echo ""
+	@echo " Built the batch processing program: " $(BATCH)
+	@echo ""
+
+# Rule for the benchmark executable
+$(BENCH):
+	$(LD) $^ $(LDFLAGS) -o $@
+	@echo ""
+	@echo " Built the benchmark program: " $(BENCH)
+	@echo " (Run it with \"./bench --out results.json\")"
+	@echo ""
+
 # Rule for `all`
-all: $(EXE) $(TEST)
+all: $(EXE) $(TEST) $(BATCH)
 
 # Pattern rules for object files
 $(OBJS_DIR):
@@ -54,6 +82,14 @@ $(OBJS_DIR):
 $(OBJS_DIR)/%.o: %.cpp | $(OBJS_DIR)
 	$(CXX) $(CXXFLAGS) $< -o $@
 
+$(BENCH_OBJS_DIR):
+	@mkdir -p $(BENCH_OBJS_DIR)
+	@mkdir -p $(BENCH_OBJS_DIR)/uiuc
+	@mkdir -p $(BENCH_OBJS_DIR)/uiuc/lodepng
+
+$(BENCH_OBJS_DIR)/%.o: %.cpp | $(BENCH_OBJS_DIR)
+	$(CXX) $(BENCH_CXXFLAGS) $< -o $@
+
 # Rules for executables
 $(TEST):
 	$(LD) $^ $(LDFLAGS) -o $@
@@ -64,6 +100,8 @@ $(TEST):
 # Executable dependencies
 $(EXE): $(patsubst %.o, $(OBJS_DIR)/%.o, $(OBJS))
 $(TEST): $(patsubst %.o, $(OBJS_DIR)/%.o, $(OBJS_TEST))
+$(BATCH): $(patsubst %.o, $(OBJS_DIR)/%.o, $(filter-out $(EXE_OBJ), $(OBJS)) $(BATCH_OBJ))
+$(BENCH): $(patsubst %.o, $(BENCH_OBJS_DIR)/%.o, $(filter-out $(EXE_OBJ), $(OBJS)) $(BENCH_OBJ))
 
 # Include automatically generated dependencies
 -include $(OBJS_DIR)/*.d
@@ -71,9 +109,12 @@ $(TEST): $(patsubst %.o, $(OBJS_DIR)/%.o, $(OBJS_TEST))
 -include $(OBJS_DIR)/uiuc/catch/*.d
 -include $(OBJS_DIR)/uiuc/lodepng/*.d
 -include $(OBJS_DIR)/tests/*.d
+-include $(BENCH_OBJS_DIR)/*.d
+-include $(BENCH_OBJS_DIR)/uiuc/*.d
+-include $(BENCH_OBJS_DIR)/uiuc/lodepng/*.d
 
 clean:
-	rm -rf $(EXE) $(TEST) $(OBJS_DIR) $(CLEAN_RM) $(ZIP_FILE)
+	rm -rf $(EXE) $(TEST) $(BATCH) $(BENCH) $(OBJS_DIR) $(BENCH_OBJS_DIR) $(CLEAN_RM) $(ZIP_FILE)
 
 tidy: clean
 	rm -rf doc
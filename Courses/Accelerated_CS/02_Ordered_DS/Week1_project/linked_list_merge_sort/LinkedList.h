@@ -14,6 +14,13 @@
 #include <stdexcept> // for std::runtime_error
 #include <iostream> // for std::cerr, std::cout
 #include <ostream> // for std::ostream
+#include <memory> // for std::allocator_traits
+#include <new> // for placement new
+#include <type_traits> // for std::is_trivially_destructible
+#include <utility> // for std::move
+
+#include "NodePool.h"
+#include "SkipIndex.h"
 
 // LinkedList class: A doubly-linked list. It can be used similarly
 // to a double-ended queue or a stack. The nodes are created on the heap
@@ -22,11 +29,21 @@
 // some examples in this course. Note that because it is doubly-linked
 // with prev pointers on each node, you can traverse the list in both
 // directions, but you also have to take extra care when inserting nodes.
-template <typename T>
+//
+// The Alloc template parameter chooses where the memory for the nodes comes
+// from. By default, each list has its own NodePool (see NodePool.h), which
+// hands out nodes from large chunks rather than calling new and delete for
+// every node. Any standard allocator works too; for example,
+// LinkedList<int, std::allocator<int>> allocates every node with new.
+//
+// A sorted list can also be given a skip-list index with buildIndex (see
+// SkipIndex.h), which makes insertOrdered, find, and lowerBound take
+// O(log n) expected time instead of O(n).
+template <typename T, typename Alloc = NodePool<T>>
 class LinkedList {
 public:
 
-  // Node type that is particular to the LinkedList<T> type
+  // Node type that is particular to the LinkedList<T, Alloc> type
   class Node {
   public:
     // The next node in the list, or nullptr if this is the last node.
@@ -91,6 +108,83 @@ private:
   // much change has happened in your function.)
   int size_;
 
+  // The allocator that the nodes come from. Alloc allocates items of type T,
+  // so we "rebind" it to get an allocator of the same kind for Nodes.
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Node> NodeAllocator;
+  typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+  NodeAllocator nodeAllocator_;
+
+  // Allocates a new node holding a copy of newData. Use this instead of
+  // "new Node(newData)".
+  Node* createNode(const T& newData) {
+    Node* newNode = NodeAllocatorTraits::allocate(nodeAllocator_, 1);
+    try {
+      new (newNode) Node(newData);
+    }
+    catch (...) {
+      // If copying the data throws an exception, give back the memory.
+      NodeAllocatorTraits::deallocate(nodeAllocator_, newNode, 1);
+      throw;
+    }
+    return newNode;
+  }
+
+  // Destroys a node made by createNode and frees its memory. Use this
+  // instead of "delete node".
+  void destroyNode(Node* node) {
+    node->~Node();
+    NodeAllocatorTraits::deallocate(nodeAllocator_, node, 1);
+  }
+
+  // Whether an allocator can free all of its memory at once, and doing so.
+  // Only a NodePool that no other list shares can.
+  template <typename A>
+  static bool canReleaseAll(A&) { return false; }
+  template <typename U>
+  static bool canReleaseAll(NodePool<U>& pool) { return pool.unique(); }
+  template <typename A>
+  static void releaseAll(A&) {}
+  template <typename U>
+  static void releaseAll(NodePool<U>& pool) { pool.release(); }
+
+  // Makes two allocators able to free each other's nodes, if possible, so
+  // that nodes can be moved from one list to the other. Standard allocators
+  // that compare equal already can; NodePools are joined into one pool.
+  template <typename A>
+  static bool shareAllocators(A& mine, A& theirs) { return mine == theirs; }
+  template <typename U>
+  static bool shareAllocators(NodePool<U>& mine, NodePool<U>& theirs) {
+    mine.join(theirs);
+    return true;
+  }
+
+  // The skip-list index, or nullptr if the list doesn't have one. The index
+  // is kept up to date by insertOrdered. Any other change to the list only
+  // marks it as stale, and it is built again the next time it is needed.
+  typedef SkipIndex<T, Node> Index;
+  Index* index_;
+
+  // Marks the index as stale, if there is one. Every member function that
+  // changes the list, other than insertOrdered, calls this.
+  void invalidateIndex() {
+    if (index_) index_->invalidate();
+  }
+
+  // Returns the index, building it again first if it is stale. Throws an
+  // exception if the list isn't sorted, since it can't be indexed then.
+  Index* readyIndex(const char* caller);
+
+  // The version of insertOrdered that uses the index.
+  void insertOrderedIndexed(const T& newData);
+
+  // Prepares to move nodes from other into this list, and throws an
+  // exception if the two lists' allocators can't share nodes.
+  void takeNodesFrom(LinkedList<T, Alloc>& other, const char* caller) {
+    if (!shareAllocators(nodeAllocator_, other.nodeAllocator_)) {
+      throw std::runtime_error(std::string("Error in ") + caller + ": the lists' allocators can't share nodes");
+    }
+  }
+
 public:
 
   // Note about STL (Standard Template Library) style:
@@ -183,22 +277,39 @@ public:
   
   // Delete all items in the list, leaving it empty.
   void clear() {
-    // As long as there are items left in the list, remove the tail item.
-    while (head_) {
-      popBack();
+    // If every node came from a pool that only this list uses, we can free
+    // the whole pool at once instead of freeing the nodes one at a time.
+    // The nodes still need to be destroyed first, unless destroying a T
+    // does nothing at all (as for int), in which case we can skip walking
+    // the list entirely.
+    bool releaseAtOnce = canReleaseAll(nodeAllocator_);
+    if (!releaseAtOnce || !std::is_trivially_destructible<T>::value) {
+      Node* cur = head_;
+      while (cur) {
+        Node* next = cur->next;
+        if (releaseAtOnce) cur->~Node();
+        else destroyNode(cur);
+        cur = next;
+        size_--;
+      }
+      if (0 != size_) throw std::runtime_error(std::string("Error in clear: ") + LIST_GENERAL_BUG_MESSAGE);
     }
 
-    if (0 != size_) throw std::runtime_error(std::string("Error in clear: ") + LIST_GENERAL_BUG_MESSAGE);
+    if (releaseAtOnce) releaseAll(nodeAllocator_);
+    head_ = nullptr;
+    tail_ = nullptr;
+    size_ = 0;
+    invalidateIndex();
   }
 
   // Two lists are equal if they have the same length
   // and the same data items in each position.
   // This check runs in O(n) time.
-  bool equals(const LinkedList<T>& other) const;
-  bool operator==(const LinkedList<T>& other) const {
+  bool equals(const LinkedList<T, Alloc>& other) const;
+  bool operator==(const LinkedList<T, Alloc>& other) const {
     return equals(other);
   }
-  bool operator!=(const LinkedList<T>& other) const {
+  bool operator!=(const LinkedList<T, Alloc>& other) const {
     return !equals(other);
   }
 
@@ -209,10 +320,42 @@ public:
  
   // Insert a new item to the list in the correct position, assuming the list
   // was previously sorted. The item should be inserted before the earliest
-  // item in the list that is greater. (This definition is in a separate
-  // file for the homework exercises.)
+  // item in the list that is greater, so it goes after any items equal to
+  // it, whether or not the list has an index. (This definition is in a
+  // separate file for the homework exercises.)
   void insertOrdered(const T& newData);
 
+  // Builds a skip-list index over the list, in O(n) time, so that
+  // insertOrdered, find, and lowerBound take O(log n) expected time. The
+  // list must be sorted, or this throws an exception and the list is left
+  // without an index. The index only points
+  // at the existing nodes, which never move.
+  // insertOrdered keeps the index up to date. Other changes to the list,
+  // such as pushBack or sortInPlace, make the index stale, and it is built
+  // again the next time it is used. (Changing an item's data through
+  // front(), back(), or a node pointer doesn't update the index at all, so
+  // call buildIndex again after doing that.)
+  void buildIndex();
+
+  // Throws away the index, if there is one.
+  void dropIndex() {
+    delete index_;
+    index_ = nullptr;
+  }
+
+  // Returns true if the list has an index.
+  bool hasIndex() const { return index_ != nullptr; }
+
+  // Returns the first node whose data is equal to value, or nullptr if there
+  // is none. With an index, this takes O(log n) expected time and the list
+  // must be sorted; otherwise it checks every node in order.
+  Node* find(const T& value);
+
+  // Assuming the list is sorted, returns the first node whose data is not
+  // less than value, or nullptr if every item is less than value. With an
+  // index, this takes O(log n) expected time; otherwise O(n).
+  Node* lowerBound(const T& value);
+
   // Checks whether the list is currently sorted in increasing order.
   // This is true if for all adjacent pairs of items A and B in the list: A <= B.
   bool isSorted() const;
@@ -221,46 +364,90 @@ public:
   // using the insertion sort algorithm that relies on insertOrdered.
   // This is not an efficient operation; insertion sort is O(n^2).
   // We're providing this for sake of comparison and study.
-  LinkedList<T> insertionSort() const;
+  LinkedList<T, Alloc> insertionSort() const;
   
   // Create a list of two lists, where the first list contains the first
   // half of the original list, and the second list contains the second half.
   // If the list has an odd number of elements, the first list will be larger
   // by one element. (The lists returned have copies of data and the original
   // list is unaltered.)
-  LinkedList<LinkedList<T>> splitHalves() const;
+  LinkedList<LinkedList<T, Alloc>> splitHalves() const;
   
   // Returns a list of new lists, where each list contains a single element
   // of the original list. For example, the original list [1, 2, 3] would be
   // returned as [[1],[2],[3]]. The data are copies, and the original list is
   // not altered.
-  LinkedList<LinkedList<T>> explode() const;
+  LinkedList<LinkedList<T, Alloc>> explode() const;
   
   // Assuming this list instance is currently sorted, and the "other" list is
   // also already sorted, then merge returns a new sorted list containing all
   // of the items from both of the original lists, in linear time.
   // (This definition is in a separate file for the homework exercises.)
-  LinkedList<T> merge(const LinkedList<T>& other) const;
+  LinkedList<T, Alloc> merge(const LinkedList<T, Alloc>& other) const;
+
+  // Merges a sorted list into this sorted list by relinking the nodes of
+  // both, so that nothing is copied or allocated. Afterward, this list has
+  // every item, in order, and other is empty. Equal items from this list
+  // come before those from other. Call it with std::move to show that the
+  // other list is being used up:
+  //   left.merge(std::move(right));
+  // (Writing left.merge(right) instead calls the version above, which
+  //  leaves both lists alone and returns a new one.)
+  void merge(LinkedList<T, Alloc>&& other);
+
+  // Moves all of the nodes of other into this list, before the node at
+  // position, or at the end if position is nullptr. No items are copied, and
+  // this takes O(1) time. Afterward, other is empty.
+  void splice(Node* position, LinkedList<T, Alloc>& other);
+
+  // Moves the nodes from first to last, inclusive, out of other and into
+  // this list, before the node at position (or at the end if position is
+  // nullptr), in O(1) time. count must be the number of nodes from first to
+  // last, since counting them would take O(n) time. other may be this same
+  // list, as long as position is not one of the nodes being moved.
+  void spliceRange(Node* position, LinkedList<T, Alloc>& other, Node* first, Node* last, int count);
+
+  // Splits this list in two: this list keeps the first index items, and the
+  // rest are moved, without copying, into the list that is returned. Finding
+  // the split takes O(min(index, size - index)) time, walking from whichever
+  // end is closer; the split itself is O(1). An index of size() or more
+  // returns an empty list.
+  LinkedList<T, Alloc> splitAt(int index);
   
   // This is a wrapper function that calls one of either mergeSortRecursive
   // or mergeSortIterative.
-  LinkedList<T> mergeSort() const;
+  LinkedList<T, Alloc> mergeSort() const;
   
   // The recursive version of the merge sort algorithm, which returns a new
   // list containing the sorted elements of the current list, in O(n log n) time.
-  LinkedList<T> mergeSortRecursive() const;
+  LinkedList<T, Alloc> mergeSortRecursive() const;
 
   // The iterative version of the merge sort algorithm, which returns a new
   // list containing the sorted elements of the current list, in O(n log n) time.
-  LinkedList<T> mergeSortIterative() const;
+  LinkedList<T, Alloc> mergeSortIterative() const;
+
+  // Sorts this list in place with merge sort, in O(n log n) time. Unlike
+  // the versions above, this copies no data and allocates no memory: the
+  // existing nodes are relinked into sorted order. Items that compare equal
+  // keep their original order (the sort is "stable"). Only operator< is
+  // used to compare items.
+  void sortInPlace();
+
+  // Sorts this list in place with a "natural" bottom-up merge sort, which
+  // finds the runs of items that are already in order and merges them,
+  // instead of starting from single items. A sorted or reversed list takes
+  // O(n) time, and a list made of k runs takes O(n log k) time, which is
+  // never worse than O(n log n). Like sortInPlace, it is stable, relinks the
+  // existing nodes without allocating, and only uses operator<.
+  void naturalSortInPlace();
 
   // Default constructor: The list will be empty.
-  LinkedList() : head_(nullptr), tail_(nullptr), size_(0) {}
+  LinkedList() : head_(nullptr), tail_(nullptr), size_(0), index_(nullptr) {}
   
   // The copy assignment operator replicates the content of the other list
   // one element at a time so that pointers between nodes will be correct
   // for this copy of the list.
-  LinkedList<T>& operator=(const LinkedList<T>& other) {
+  LinkedList<T, Alloc>& operator=(const LinkedList<T, Alloc>& other) {
     // Clear the current list.
     clear();
 
@@ -281,13 +468,53 @@ public:
   // The copy constructor begins by constructing the default LinkedList,
   // then it does copy assignment from the other list. Please see the
   // definition of the copy assignment operator.
-  LinkedList(const LinkedList<T>& other) : LinkedList() {
+  LinkedList(const LinkedList<T, Alloc>& other) : LinkedList() {
     *this = other;
   }
 
-  // The destructor calls clear to deallocate all of the nodes.
+  // The move constructor takes over the nodes of the other list, and its
+  // index if it has one, and the other list is left empty. Nothing is copied
+  // or allocated. (A list that is about to be destroyed, such as one
+  // returned by value from a function, is moved rather than copied.)
+  LinkedList(LinkedList<T, Alloc>&& other) noexcept
+    : head_(other.head_), tail_(other.tail_), size_(other.size_),
+      nodeAllocator_(std::move(other.nodeAllocator_)), index_(other.index_) {
+    other.head_ = nullptr;
+    other.tail_ = nullptr;
+    other.size_ = 0;
+    other.index_ = nullptr;
+  }
+
+  // The move assignment operator deletes the current items, then takes over
+  // the nodes of the other list, which is left empty.
+  LinkedList<T, Alloc>& operator=(LinkedList<T, Alloc>&& other) {
+    if (this == &other) return *this;
+
+    clear();
+
+    // This list is now empty, so it can switch to the other list's
+    // allocator, which the nodes came from.
+    nodeAllocator_ = std::move(other.nodeAllocator_);
+    head_ = other.head_;
+    tail_ = other.tail_;
+    size_ = other.size_;
+    other.head_ = nullptr;
+    other.tail_ = nullptr;
+    other.size_ = 0;
+
+    // The other list's index still points at the right nodes.
+    dropIndex();
+    index_ = other.index_;
+    other.index_ = nullptr;
+
+    return *this;
+  }
+
+  // The destructor calls clear to deallocate all of the nodes, and then
+  // deletes the index.
   ~LinkedList() {
     clear();
+    dropIndex();
   }
 
   // Checks whether the size has been correctly updated by member functions,
@@ -299,6 +526,28 @@ public:
   // this throws an exception. This is for testing only.
   bool assertPrevLinks() const;
 
+private:
+
+  // Helpers for sortInPlace. These work on chains of nodes linked only by
+  // their next pointers; the prev pointers are ignored until the end.
+
+  // Sorts the chain starting at head and returns the new first node.
+  static Node* sortChain(Node* head);
+
+  // Merges two sorted chains into one by relinking their nodes, and returns
+  // the first node of the merged chain.
+  static Node* mergeChains(Node* left, Node* right);
+
+  // Cuts the run of items already in order off the front of the chain
+  // starting at head, and returns the first node of the run. A strictly
+  // decreasing run is reversed so that it is in order. rest is set to the
+  // first node after the run.
+  static Node* takeRun(Node* head, Node*& rest);
+
+  // After the nodes have been relinked by their next pointers, sets every
+  // prev pointer and tail_ to match.
+  void fixPrevLinks(const char* caller);
+
 };
 
 // =======================================================================
@@ -368,22 +617,22 @@ public:
 // ---------------------------------------------------------------------
 
 // Operator overload that allows stream output syntax, such as with std::cout
-template <typename T>
-std::ostream& operator<<(std::ostream& os, const LinkedList<T>& list) {
+template <typename T, typename Alloc>
+std::ostream& operator<<(std::ostream& os, const LinkedList<T, Alloc>& list) {
   return list.print(os);
 }
 
 // In some versions of C++ we have to redeclare a constant static member
 // at global scope like this to ensure that the linker doesn't give an error.
-template <typename T>
-constexpr char LinkedList<T>::LIST_GENERAL_BUG_MESSAGE[];
+template <typename T, typename Alloc>
+constexpr char LinkedList<T, Alloc>::LIST_GENERAL_BUG_MESSAGE[];
 
 // Push a copy of the new data item onto the front of the list.
-template <typename T>
-void LinkedList<T>::pushFront(const T& newData) {
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::pushFront(const T& newData) {
 
   // allocate a new node
-  Node* newNode = new Node(newData);
+  Node* newNode = createNode(newData);
 
   if (!head_) {
     // If empty, insert as the only item as both head and tail.
@@ -403,14 +652,17 @@ void LinkedList<T>::pushFront(const T& newData) {
 
   // update size
   size_++;
+
+  // The index (if any) doesn't know about the new node.
+  invalidateIndex();
 }
 
 // Push a copy of the new data item onto the back of the list.
-template <typename T>
-void LinkedList<T>::pushBack(const T& newData) {
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::pushBack(const T& newData) {
 
   // allocate a new node
-  Node* newNode = new Node(newData);
+  Node* newNode = createNode(newData);
 
   if (!head_) {
     // If empty, insert as the only item as both head and tail.
@@ -430,20 +682,26 @@ void LinkedList<T>::pushBack(const T& newData) {
 
   // update size
   size_++;
+
+  // The index (if any) doesn't know about the new node.
+  invalidateIndex();
 }
 
 // Delete the front item of the list.
-template <typename T>
-void LinkedList<T>::popFront() {
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::popFront() {
 
   // If list is empty, do nothing.
   if (!head_) return;
 
+  // The index (if any) may point at the node we're about to delete.
+  invalidateIndex();
+
   // If the next item after the head is null, this is the last and only
   // item in the list.
   if (!head_->next) {
     // deallocate the only item
-    delete head_;
+    destroyNode(head_);
     // reset list pointers
     head_ = nullptr;
     tail_ = nullptr;
@@ -463,7 +721,7 @@ void LinkedList<T>::popFront() {
   // Now set the new head_'s previous pointer to null.
   head_->prev = nullptr;
   // Deallocate the old head_ item
-  delete oldHead;
+  destroyNode(oldHead);
   // It's a good practice to set pointers to null after you delete them for safety,
   // even if you don't think you're going to dereference the same pointer again.
   oldHead = nullptr;
@@ -473,17 +731,20 @@ void LinkedList<T>::popFront() {
 }
 
 // Delete the back item of the list.
-template <typename T>
-void LinkedList<T>::popBack() {
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::popBack() {
 
   // If list is empty, do nothing.
   if (!head_) return;
 
+  // The index (if any) may point at the node we're about to delete.
+  invalidateIndex();
+
   // If the tail item's prev is null, then this is the last and only
   // item in the list.
   if (!tail_->prev) {
     // deallocate the only item
-    delete tail_;
+    destroyNode(tail_);
     // reset list pointers
     head_ = nullptr;
     tail_ = nullptr;
@@ -503,7 +764,7 @@ void LinkedList<T>::popBack() {
   // Now set the new tail_'s next pointer to null.
   tail_->next = nullptr;
   // Deallocate the old tail_ item
-  delete oldTail;
+  destroyNode(oldTail);
   // It's a good practice to set pointers to null after you delete them for safety,
   // even if you don't think you're going to dereference the same pointer again.
   oldTail = nullptr;
@@ -514,8 +775,8 @@ void LinkedList<T>::popBack() {
 
 // Checks whether the list is currently sorted in increasing order.
 // This is true if for all adjacent pairs of items A and B in the list: A <= B.
-template <typename T>
-bool LinkedList<T>::isSorted() const {
+template <typename T, typename Alloc>
+bool LinkedList<T, Alloc>::isSorted() const {
   // Lists of size 0 or 1 are sorted.
   if (size_ < 2) return true;
 
@@ -545,8 +806,8 @@ bool LinkedList<T>::isSorted() const {
 // Two lists are equal if they have the same length
 // and the same data items in each position.
 // This check runs in O(n) time.
-template <typename T>
-bool LinkedList<T>::equals(const LinkedList<T>& other) const {
+template <typename T, typename Alloc>
+bool LinkedList<T, Alloc>::equals(const LinkedList<T, Alloc>& other) const {
 
   // If the lists are different sizes, they don't have the same contents.
   if (size_ != other.size_) {
@@ -575,10 +836,10 @@ bool LinkedList<T>::equals(const LinkedList<T>& other) const {
 // using the insertion sort algorithm that relies on insertOrdered.
 // This is not an efficient operation; insertion sort is O(n^2).
 // We're providing this for sake of comparison and study.
-template <typename T>
-LinkedList<T> LinkedList<T>::insertionSort() const {
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::insertionSort() const {
   // Make result list
-  LinkedList<T> result;
+  LinkedList<T, Alloc> result;
 
   // Walk along the original list and insert the items to the result in order.
   const Node* cur = head_;
@@ -592,13 +853,13 @@ LinkedList<T> LinkedList<T>::insertionSort() const {
 
 /*
 // A different implementation of insertionSort that doesn't use pointers directly
-template <typename T>
-LinkedList<T> LinkedList<T>::insertionSort() const {
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::insertionSort() const {
   // Make result list
-  LinkedList<T> result;
+  LinkedList<T, Alloc> result;
 
   // Temporary working copy of original list
-  LinkedList<T> temp = *this;
+  LinkedList<T, Alloc> temp = *this;
 
   // Consume the temporary copy and insert items into the result in order
   while (!temp.empty()) {
@@ -613,8 +874,8 @@ LinkedList<T> LinkedList<T>::insertionSort() const {
 // Output a string representation of the list.
 // This requires that the data type T supports stream output itself.
 // This is used by the operator<< overload defined in this file.
-template <typename T>
-std::ostream& LinkedList<T>::print(std::ostream& os) const {
+template <typename T, typename Alloc>
+std::ostream& LinkedList<T, Alloc>::print(std::ostream& os) const {
   // List format will be [(1)(2)(3)], etc.
   os << "[";
 
@@ -636,15 +897,15 @@ std::ostream& LinkedList<T>::print(std::ostream& os) const {
 // If the list has an odd number of elements, the first list will be larger
 // by one element. (The lists returned have copies of data and the original
 // list is unaltered.)
-template <typename T>
-LinkedList<LinkedList<T>> LinkedList<T>::splitHalves() const {
+template <typename T, typename Alloc>
+LinkedList<LinkedList<T, Alloc>> LinkedList<T, Alloc>::splitHalves() const {
 
   // Prepare a list of lists for the result:
-  LinkedList<LinkedList<T>> halves;
+  LinkedList<LinkedList<T, Alloc>> halves;
   // Prepare a working copy of "*this" object to be split:
-  LinkedList<T> leftHalf = *this;
+  LinkedList<T, Alloc> leftHalf = *this;
   // Prepare an empty right half to fill:
-  LinkedList<T> rightHalf;
+  LinkedList<T, Alloc> rightHalf;
 
   // If the original list size is 0 or 1, we don't want to change it.
   // However, for type consistency, we'll still return it as the left "half"
@@ -682,12 +943,12 @@ LinkedList<LinkedList<T>> LinkedList<T>::splitHalves() const {
 // of the original list. For example, the original list [1, 2, 3] would be
 // returned as [[1],[2],[3]]. The data are copies, and the original list is
 // not altered.
-template <typename T>
-LinkedList<LinkedList<T>> LinkedList<T>::explode() const {
+template <typename T, typename Alloc>
+LinkedList<LinkedList<T, Alloc>> LinkedList<T, Alloc>::explode() const {
 
-  LinkedList<T> workingCopy = *this;
+  LinkedList<T, Alloc> workingCopy = *this;
 
-  LinkedList< LinkedList<T> > lists;
+  LinkedList< LinkedList<T, Alloc> > lists;
 
   // This could have been done by iterating over the original list with
   // pointers instead, but here we have created a working copy, and as
@@ -695,7 +956,7 @@ LinkedList<LinkedList<T>> LinkedList<T>::explode() const {
   // singleton list (a list with a single item). We end up with a list
   // of lists, where each item is contained within its own list.
   while (!workingCopy.empty()) {
-    LinkedList<T> singletonList;
+    LinkedList<T, Alloc> singletonList;
     singletonList.pushBack(workingCopy.front());
     workingCopy.popFront();
     lists.pushBack(singletonList);
@@ -706,8 +967,8 @@ LinkedList<LinkedList<T>> LinkedList<T>::explode() const {
 
 // The recursive version of the merge sort algorithm, which returns a new
 // list containing the sorted elements of the current list, in O(n log n) time.
-template <typename T>
-LinkedList<T> LinkedList<T>::mergeSortRecursive() const {
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::mergeSortRecursive() const {
 
   // The classic recursive definition of mergeSort is elegantly simple
   // to write but the underlying principle is somewhat profound.
@@ -722,7 +983,7 @@ LinkedList<T> LinkedList<T>::mergeSortRecursive() const {
   }
 
   // Split this list into a list of two lists (the left and right halves)
-  LinkedList<LinkedList<T>> halves = splitHalves();
+  LinkedList<LinkedList<T, Alloc>> halves = splitHalves();
 
   // Note that splitHalves usually returns two halves that are definitely
   // both smaller than the original list. The only case where it would not,
@@ -736,8 +997,8 @@ LinkedList<T> LinkedList<T>::mergeSortRecursive() const {
   // since these are already safe for us to edit as working copies.
   // (If you aren't sure in a situation like this, you could just make
   //  an extra copy instead of trying to edit in-place using references.)
-  LinkedList<T>& left = halves.front();
-  LinkedList<T>& right = halves.back();
+  LinkedList<T, Alloc>& left = halves.front();
+  LinkedList<T, Alloc>& right = halves.back();
 
   // Relying on the inductive hypothesis that our algorithm successfully
   // sorts a smaller list than the original input, we recurse on each of
@@ -781,8 +1042,8 @@ LinkedList<T> LinkedList<T>::mergeSortRecursive() const {
 
 // The iterative version of the merge sort algorithm, which returns a new
 // list containing the sorted elements of the current list, in O(n log n) time.
-template <typename T>
-LinkedList<T> LinkedList<T>::mergeSortIterative() const {
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::mergeSortIterative() const {
 
   // This version of merge sort works by the same principle as the recursive
   // version described elsewhere in this source code file, but the iterative
@@ -797,48 +1058,28 @@ LinkedList<T> LinkedList<T>::mergeSortIterative() const {
     return *this;
   }
 
-  // Iteratively "explode" the original list into a list of lists, where each
-  // list contains a single item. We'll use this list of lists as our workQueue,
-  // acting as a double-ended queue containing work yet to be done.
-  LinkedList< LinkedList<T> > workQueue = explode();
-
-  // The loop invariant condition is that the lists in our queue are always
-  // individually sorted. They begin as singleton lists (one item each),
-  // which are sorted by definition. As we merge pairs of them, the merge
-  // algorithm always produces a sorted result. Therefore we always are
-  // handling sorted lists on the queue. Also, as we merge pairs of lists
-  // together, the queue size decreases towards containing only a single list.
-
-  // We want to iteratively merge pairs of lists that are about the same size.
-  // Take lists two at a time from the front of the workQueue, merge them,
-  // and send the result to the back of the workQueue.
-  while(workQueue.size() > 1) {
-    // Remove two lists from the front of the queue.
-    LinkedList<T> left = workQueue.front();
-    workQueue.popFront();
-    LinkedList<T> right = workQueue.front();
-    workQueue.popFront();
-    // Merge the two lists.
-    LinkedList<T> merged = left.merge(right);
-    // Put the result on the back of the queue.
-    // (It's important that we put it on the back of the queue, not the front.
-    //  Putting it on the back of the queue means we typically merge two small,
-    //  equally-sized arrays, resulting in a rounds of work similar to the
-    //  recursive version of merge sort. If we tried to move the merged list
-    //  to the front, then we would fetch it right back, repeatedly merging the
-    //  following single item into one huge array. Can you calculate what the
-    //  running time would be then, if we did it the wrong way here?)
-    workQueue.pushBack(merged);
-  }
-
-  // When the workQueue is reduced to size 1, its only element is the result.
-  return workQueue.front();
+  // An earlier version of this function "exploded" the original list into a
+  // list of singleton lists and used it as a work queue: it repeatedly took
+  // two lists from the front, merged them, and pushed the result on the
+  // back. That made a new list (and new nodes) for every item, and copied
+  // every item again on every round of merging.
+
+  // Now we make a single copy of the list and sort the copy in place with
+  // a bottom-up merge sort. It still merges pairs of sorted lists of about
+  // the same size, in rounds, like the work queue did, but it keeps them in
+  // a small fixed array and merges them by relinking nodes. It also starts
+  // from the runs of items that are already in order rather than from
+  // single items, so nearly sorted lists are sorted in close to O(n) time.
+  // Please see naturalSortInPlace.
+  LinkedList<T, Alloc> result = *this;
+  result.naturalSortInPlace();
+  return result;
 }
 
 // This is a wrapper function that calls one of either mergeSortRecursive
 // or mergeSortIterative.
-template <typename T>
-LinkedList<T> LinkedList<T>::mergeSort() const {
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::mergeSort() const {
 
   // As a wrapper function, this should only call one version of mergeSort
   // or the other and return that result.
@@ -848,10 +1089,340 @@ LinkedList<T> LinkedList<T>::mergeSort() const {
 
 }
 
+// Sorts this list in place by relinking its nodes, in O(n log n) time,
+// without allocating any memory.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::sortInPlace() {
+
+  // A list of size 0 or 1 is already sorted.
+  if (size_ < 2) return;
+
+  // Sort the chain of nodes using only the next pointers. The prev pointers
+  // and tail_ are stale until we fix them up below.
+  head_ = sortChain(head_);
+
+  // One final pass from front to back restores every prev pointer and
+  // finds the new tail. This is cheaper than keeping the prev pointers
+  // correct during every merge.
+  fixPrevLinks("sortInPlace");
+  invalidateIndex();
+}
+
+// Sorts this list in place with a natural bottom-up merge sort, in O(n)
+// time for a list that is already in order and O(n log n) at worst.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::naturalSortInPlace() {
+
+  // A list of size 0 or 1 is already sorted.
+  if (size_ < 2) return;
+
+  // Instead of a work queue of lists, we keep a small fixed array of sorted
+  // chains, which works like a binary counter: pending[i] is either empty
+  // or holds the merge of 2^i runs. Each new run is "added" at pending[0],
+  // and whenever a slot is already full, the two are merged and carried to
+  // the next slot up. So runs are always merged with chains of a similar
+  // number of runs, like the rounds of a work queue of lists, but no
+  // lists are ever copied. Since there are at most 2^31 runs in a list, 32
+  // slots are always enough.
+  constexpr int MAX_PENDING = 32;
+  Node* pending[MAX_PENDING] = {};
+
+  Node* rest = head_;
+  while (rest) {
+    Node* run = takeRun(rest, rest);
+
+    int i = 0;
+    while (i < MAX_PENDING - 1 && pending[i]) {
+      // The pending chain holds items from earlier in the list, so it goes
+      // on the left to keep equal items in their original order.
+      run = mergeChains(pending[i], run);
+      pending[i] = nullptr;
+      i++;
+    }
+    pending[i] = pending[i] ? mergeChains(pending[i], run) : run;
+  }
+
+  // Merge whatever is left in the slots. Higher slots hold earlier items,
+  // so we work upward, always putting the higher slot on the left.
+  Node* sorted = nullptr;
+  for (int i = 0; i < MAX_PENDING; i++) {
+    if (pending[i]) {
+      sorted = sorted ? mergeChains(pending[i], sorted) : pending[i];
+    }
+  }
+  head_ = sorted;
+
+  fixPrevLinks("naturalSortInPlace");
+  invalidateIndex();
+}
+
+// Cuts the run of items already in order off the front of the chain.
+template <typename T, typename Alloc>
+typename LinkedList<T, Alloc>::Node* LinkedList<T, Alloc>::takeRun(Node* head, Node*& rest) {
+
+  if (head->next && head->next->data < head->data) {
+    // A strictly decreasing run. Reverse it as we go, so that it comes out
+    // increasing. (Runs with equal neighbors are not treated as decreasing,
+    // since reversing them would swap the order of the equal items.)
+    Node* reversed = head;
+    Node* cur = head->next;
+    head->next = nullptr;
+    while (cur && cur->data < reversed->data) {
+      Node* next = cur->next;
+      cur->next = reversed;
+      reversed = cur;
+      cur = next;
+    }
+    rest = cur;
+    return reversed;
+  }
+
+  // An increasing run, where each item is at least as big as the one before.
+  Node* last = head;
+  while (last->next && !(last->next->data < last->data)) {
+    last = last->next;
+  }
+  rest = last->next;
+  last->next = nullptr;
+  return head;
+}
+
+// Sets every prev pointer and tail_ to match the next pointers.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::fixPrevLinks(const char* caller) {
+  Node* prev = nullptr;
+  Node* cur = head_;
+  int itemCount = 0;
+  while (cur) {
+    cur->prev = prev;
+    prev = cur;
+    cur = cur->next;
+    itemCount++;
+  }
+  tail_ = prev;
+
+  if (itemCount != size_) throw std::runtime_error(std::string("Error in ") + caller + ": " + LIST_GENERAL_BUG_MESSAGE);
+}
+
+// Sorts the chain starting at head and returns the new first node.
+template <typename T, typename Alloc>
+typename LinkedList<T, Alloc>::Node* LinkedList<T, Alloc>::sortChain(Node* head) {
+
+  // A chain of 0 or 1 nodes is already sorted.
+  if (!head || !head->next) return head;
+
+  // Find the last node of the left half with a "slow" pointer that takes
+  // one step for every two steps of a "fast" pointer. When the fast pointer
+  // reaches the end, the slow pointer is in the middle. As in splitHalves,
+  // the left half gets the extra node when the length is odd.
+  Node* slow = head;
+  Node* fast = head->next;
+  while (fast && fast->next) {
+    slow = slow->next;
+    fast = fast->next->next;
+  }
+
+  // Cut the chain in two after the slow pointer.
+  Node* right = slow->next;
+  slow->next = nullptr;
+
+  // Sort each half, then merge them. The recursion is only O(log n) deep.
+  return mergeChains(sortChain(head), sortChain(right));
+}
+
+// Merges two sorted chains into one by relinking their nodes, and returns
+// the first node of the merged chain.
+template <typename T, typename Alloc>
+typename LinkedList<T, Alloc>::Node* LinkedList<T, Alloc>::mergeChains(Node* left, Node* right) {
+
+  // "link" points at the pointer that the next node should be stored in:
+  // first mergedHead, then the next pointer of the last node appended.
+  // This lets us append without a special case for the first node.
+  Node* mergedHead = nullptr;
+  Node** link = &mergedHead;
+
+  while (left && right) {
+    // Take from the right only if it is strictly smaller, so that equal
+    // items keep their original order.
+    if (right->data < left->data) {
+      *link = right;
+      right = right->next;
+    }
+    else {
+      *link = left;
+      left = left->next;
+    }
+    link = &((*link)->next);
+  }
+
+  // One of the chains is used up; the rest of the other one is already
+  // sorted, so it can be linked on as it is.
+  *link = left ? left : right;
+
+  return mergedHead;
+}
+
+// Merges a sorted list into this sorted list by relinking the nodes of both.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::merge(LinkedList<T, Alloc>&& other) {
+
+  if (this == &other || !other.head_) return;
+  takeNodesFrom(other, "merge");
+
+  // The same merge of chains as sortInPlace uses, which keeps equal items
+  // from the left (this list) first.
+  head_ = mergeChains(head_, other.head_);
+  size_ += other.size_;
+
+  other.head_ = nullptr;
+  other.tail_ = nullptr;
+  other.size_ = 0;
+
+  fixPrevLinks("merge");
+  invalidateIndex();
+  other.invalidateIndex();
+}
+
+// Moves all of the nodes of other into this list, before position.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::splice(Node* position, LinkedList<T, Alloc>& other) {
+  if (this == &other || !other.head_) return;
+  spliceRange(position, other, other.head_, other.tail_, other.size_);
+}
+
+// Moves the nodes from first to last out of other and into this list,
+// before position.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::spliceRange(Node* position, LinkedList<T, Alloc>& other, Node* first, Node* last, int count) {
+
+  if (!first || !last || count <= 0) return;
+  if (this != &other) takeNodesFrom(other, "spliceRange");
+  invalidateIndex();
+  other.invalidateIndex();
+
+  // Unlink first..last from the other list, joining the nodes on either
+  // side of them, or updating the other list's head_ and tail_.
+  if (first->prev) first->prev->next = last->next;
+  else other.head_ = last->next;
+  if (last->next) last->next->prev = first->prev;
+  else other.tail_ = first->prev;
+  other.size_ -= count;
+
+  // Link first..last into this list before position, or at the end.
+  Node* before = position ? position->prev : tail_;
+  first->prev = before;
+  last->next = position;
+  if (before) before->next = first;
+  else head_ = first;
+  if (position) position->prev = last;
+  else tail_ = last;
+  size_ += count;
+}
+
+// Splits this list in two at index, returning the second part.
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::splitAt(int index) {
+
+  // The second part shares this list's allocator, since its nodes came
+  // from there.
+  LinkedList<T, Alloc> rest;
+  if (index < 0) index = 0;
+  if (index >= size_) return rest;
+  rest.takeNodesFrom(*this, "splitAt");
+
+  // Find the first node of the second part, from whichever end is closer.
+  Node* first = nullptr;
+  if (index <= size_ / 2) {
+    first = head_;
+    for (int i = 0; i < index; i++) first = first->next;
+  }
+  else {
+    first = tail_;
+    for (int i = size_ - 1; i > index; i--) first = first->prev;
+  }
+
+  rest.spliceRange(nullptr, *this, first, tail_, size_ - index);
+  return rest;
+}
+
+// Builds a skip-list index over the list.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::buildIndex() {
+  if (!index_) index_ = new Index();
+  if (!index_->build(head_)) {
+    dropIndex();
+    throw std::runtime_error("Error in buildIndex: the list must be sorted to be indexed");
+  }
+}
+
+// Returns the index, building it again first if it is stale.
+template <typename T, typename Alloc>
+typename LinkedList<T, Alloc>::Index* LinkedList<T, Alloc>::readyIndex(const char* caller) {
+  if (index_->stale() && !index_->build(head_)) {
+    throw std::runtime_error(std::string("Error in ") + caller + ": the list must be sorted to use its index");
+  }
+  return index_;
+}
+
+// Inserts a new item in order, using the index to find where it goes.
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::insertOrderedIndexed(const T& newData) {
+
+  // The new node goes right after the last node that is not greater than
+  // newData, which is before the earliest node that is greater.
+  Index* index = readyIndex("insertOrdered");
+  Node* before = index->findBefore(head_, newData, true);
+  Node* after = before ? before->next : head_;
+
+  Node* newNode = createNode(newData);
+  newNode->prev = before;
+  newNode->next = after;
+  if (before) before->next = newNode;
+  else head_ = newNode;
+  if (after) after->prev = newNode;
+  else tail_ = newNode;
+  size_++;
+
+  // Unlike the other changes to the list, this one keeps the index up to
+  // date, using the path that findBefore took through it.
+  index->insert(newNode);
+}
+
+// Returns the first node whose data is equal to value, or nullptr.
+template <typename T, typename Alloc>
+typename LinkedList<T, Alloc>::Node* LinkedList<T, Alloc>::find(const T& value) {
+  if (index_) {
+    Node* found = lowerBound(value);
+    return (found && !(value < found->data)) ? found : nullptr;
+  }
+
+  // Without an index, the list might not be sorted, so check every node.
+  // (Only operator< is used, so "equal" means neither item is less.)
+  for (Node* cur = head_; cur; cur = cur->next) {
+    if (!(cur->data < value) && !(value < cur->data)) return cur;
+  }
+  return nullptr;
+}
+
+// Returns the first node whose data is not less than value, or nullptr.
+template <typename T, typename Alloc>
+typename LinkedList<T, Alloc>::Node* LinkedList<T, Alloc>::lowerBound(const T& value) {
+  if (index_) {
+    Node* before = readyIndex("lowerBound")->findBefore(head_, value, false);
+    return before ? before->next : head_;
+  }
+
+  Node* cur = head_;
+  while (cur && cur->data < value) {
+    cur = cur->next;
+  }
+  return cur;
+}
+
 // Checks whether the size has been correctly updated by member functions,
 // and otherwise throws an exception. This is for testing only.
-template <typename T>
-bool LinkedList<T>::assertCorrectSize() const {
+template <typename T, typename Alloc>
+bool LinkedList<T, Alloc>::assertCorrectSize() const {
   int itemCount = 0;
   const Node* cur = head_;
   while (cur) {
@@ -865,8 +1436,8 @@ bool LinkedList<T>::assertCorrectSize() const {
 // Checks whether the reverse-direction links in the list, given by
 // the prev pointers on the nodes, are correct. If an error is found,
 // this throws an exception. This is for testing only.
-template <typename T>
-bool LinkedList<T>::assertPrevLinks() const {
+template <typename T, typename Alloc>
+bool LinkedList<T, Alloc>::assertPrevLinks() const {
   // These should end up being the same list, but we'll build one
   // in the forward direction and the other in the reverse direction.
   LinkedList<const Node*> forwardPtrList;
@@ -891,8 +1462,8 @@ bool LinkedList<T>::assertPrevLinks() const {
 }
 
 // A different version of assertPrevLinks
-// template <typename T>
-// bool LinkedList<T>::assertPrevLinks() const {
+// template <typename T, typename Alloc>
+// bool LinkedList<T, Alloc>::assertPrevLinks() const {
 //   if (head_ == tail_) {
 //     if (!head_ && 0==size_) return true;
 //     if (head_ && 1==size_) return true;
@@ -78,8 +78,8 @@
 
  ********************************************************************/
 
-template <typename T>
-void LinkedList<T>::insertOrdered(const T &newData)
+template <typename T, typename Alloc>
+void LinkedList<T, Alloc>::insertOrdered(const T &newData)
 {
 
   // -----------------------------------------------------------
@@ -129,7 +129,15 @@ void LinkedList<T>::insertOrdered(const T &newData)
   // to update all next, prev, head_, and tail_ pointers as needed on your
   // new node or on those existing nodes that are adjacent to the new node.
 
-  Node *newNode = new Node(newData);
+  // If the list has a skip-list index (see buildIndex in LinkedList.h), it
+  // can find the position in O(log n) expected time instead.
+  if (index_)
+  {
+    insertOrderedIndexed(newData);
+    return;
+  }
+
+  Node *newNode = createNode(newData);
 
   if (nullptr == head_)
   {
@@ -144,8 +152,10 @@ void LinkedList<T>::insertOrdered(const T &newData)
   }
   else
   {
+    // Walk past every item that is not greater than newData, so that it
+    // goes after any items equal to it, as with the index.
     Node *current = head_;
-    while (nullptr != current->next && current->next->data < newData)
+    while (nullptr != current->next && !(newData < current->next->data))
     {
       current = current->next;
     }
@@ -239,8 +249,8 @@ void LinkedList<T>::insertOrdered(const T &newData)
 
  ********************************************************************/
 
-template <typename T>
-LinkedList<T> LinkedList<T>::merge(const LinkedList<T> &other) const
+template <typename T, typename Alloc>
+LinkedList<T, Alloc> LinkedList<T, Alloc>::merge(const LinkedList<T, Alloc> &other) const
 {
 
   // You can't edit the original instance of LinkedList that is calling
@@ -249,8 +259,8 @@ LinkedList<T> LinkedList<T>::merge(const LinkedList<T> &other) const
   // "working copies" of the two lists: "*this" refers to the current
   // list object instance that is calling the merge member function, and
   // "other" refers to the list that was passed as an argument:
-  LinkedList<T> left = *this;
-  LinkedList<T> right = other;
+  LinkedList<T, Alloc> left = *this;
+  LinkedList<T, Alloc> right = other;
 
   // So if this function was called as "A.merge(B)", then now, "left"
   // is a temporary copy of the "A" and "right" is a temporary copy
@@ -259,7 +269,7 @@ LinkedList<T> LinkedList<T>::merge(const LinkedList<T> &other) const
   // We will also create an empty list called "merged" where we can build
   // the final result we want. This is what we will return at the end of
   // the function.
-  LinkedList<T> merged;
+  LinkedList<T, Alloc> merged;
 
   // -----------------------------------------------------------
   // TODO: Your code here!
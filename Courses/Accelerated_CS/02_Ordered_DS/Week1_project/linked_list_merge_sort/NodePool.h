@@ -0,0 +1,297 @@
+/**
+ * @file NodePool.h
+ * A pool allocator for the nodes of a LinkedList.
+ *
+**/
+
+#pragma once
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uintptr_t
+#include <memory> // for std::shared_ptr
+#include <new> // for operator new
+
+// NodePool: An allocator that hands out memory for one object at a time
+// from large chunks, instead of asking the heap for each object separately.
+// When an object is freed, its memory goes on a "free list" and is handed
+// out again by the next allocation, so a list that pushes and pops in a
+// loop stops calling the heap at all once it has warmed up.
+//
+// Every LinkedList gets its own pool by default. That means the nodes of
+// one list are packed together in memory, which is friendlier to the cache
+// than nodes scattered around the heap, and it means that when a list is
+// cleared, the whole pool can be given back at once with release().
+//
+// A NodePool object is a handle to the pool's memory: copies of it share
+// the same pool, and memory allocated through one copy may be freed
+// through another, like any C++ allocator. (LinkedList still gives each
+// copy of a list a pool of its own.) Two pools can also be joined into one,
+// which is how LinkedList moves nodes from one list to another without
+// copying them.
+//
+// NodePool follows the usual C++ allocator interface, so a LinkedList can
+// also be given a standard allocator instead, as in
+//   LinkedList<int, std::allocator<int>> list;
+// which allocates every node with new, like the original LinkedList did.
+template <typename T>
+class NodePool {
+public:
+
+  // The type this pool allocates.
+  typedef T value_type;
+
+  // Chunks are aligned to, and sized in multiples of, a typical cache line.
+  static constexpr std::size_t CACHE_LINE = 64;
+  // The first chunk is small, since many lists only ever hold a few items.
+  // Each chunk after that is twice as big as the one before, up to a limit.
+  static constexpr std::size_t FIRST_CHUNK_BYTES = 2 * CACHE_LINE;
+  static constexpr std::size_t MAX_CHUNK_BYTES = 64 * 1024;
+
+  // Default constructor: Makes a new pool. The pool doesn't take any memory
+  // from the heap until the first allocation.
+  NodePool() {}
+
+  // Allocators can be "rebound" to allocate another type; LinkedList uses
+  // this to get a pool of its Node type from a NodePool<T>. Since the slots
+  // of a pool are sized for one type, this makes a new pool.
+  template <typename U>
+  NodePool(const NodePool<U>&) {}
+
+  // Returns memory for n objects of type T. Single objects come from the
+  // pool; anything bigger goes straight to the heap.
+  T* allocate(std::size_t n) {
+    if (n != 1) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    if (!arena_) {
+      arena_ = std::make_shared<Arena>();
+    }
+    return reinterpret_cast<T*>(root()->allocate());
+  }
+
+  // Frees memory from allocate. A single object's slot goes on the free
+  // list to be reused; it is not given back to the heap until release().
+  void deallocate(T* p, std::size_t n) {
+    if (n != 1) {
+      ::operator delete(p);
+      return;
+    }
+    root()->deallocate(p);
+  }
+
+  // Returns true if no other copy of this NodePool shares its memory. Only
+  // then can release() be used to free everything in the pool at once.
+  bool unique() {
+    if (!arena_) return true;
+    // root() returns a second reference to the arena, which must be gone
+    // before the references are counted.
+    root();
+    return arena_.use_count() == 1;
+  }
+
+  // Gives every chunk back to the heap at once, leaving the pool empty.
+  // All of the objects in the pool must have been destroyed already, but
+  // they don't need to have been deallocated one by one.
+  void release() {
+    if (arena_) {
+      root()->release();
+    }
+  }
+
+  // Joins this pool and another into one, so that memory allocated from
+  // either can be freed through either, and through any copy of either.
+  // The other pool's chunks and freed slots are handed over to this one,
+  // and the other pool forwards to this one from then on. This takes O(1)
+  // time. (The unused end of the other pool's newest chunk is not reused.)
+  void join(NodePool& other) {
+    if (*this == other) return;
+    if (!other.arena_) {
+      other.arena_ = root();
+      return;
+    }
+    if (!arena_) {
+      arena_ = other.root();
+      return;
+    }
+    std::shared_ptr<Arena> mine = root();
+    std::shared_ptr<Arena> theirs = other.root();
+    mine->absorb(*theirs);
+    theirs->forward_ = mine;
+    other.arena_ = mine;
+  }
+
+  // Two allocators are equal if memory from one can be freed by the other,
+  // which for pools means that they share the same memory.
+  bool operator==(const NodePool& other) const {
+    return findRoot(arena_) == findRoot(other.arena_);
+  }
+  bool operator!=(const NodePool& other) const {
+    return !(*this == other);
+  }
+
+private:
+
+  // A freed slot holds a pointer to the next freed slot, in the memory where
+  // the object used to be.
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  // Each chunk starts with this header, which links the chunks together
+  // so that they can all be released.
+  struct Chunk {
+    Chunk* next;
+    void* memory;
+  };
+
+  // Each slot must be big enough and aligned well enough for either a T or
+  // a FreeSlot.
+  static constexpr std::size_t ALIGN = alignof(T) > alignof(FreeSlot) ? alignof(T) : alignof(FreeSlot);
+  static constexpr std::size_t RAW_SLOT_BYTES = sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot);
+  static constexpr std::size_t SLOT_BYTES = (RAW_SLOT_BYTES + ALIGN - 1) / ALIGN * ALIGN;
+  // The header at the front of a chunk, rounded up to a whole cache line so
+  // that the first slot starts on a cache line.
+  static constexpr std::size_t HEADER_BYTES = (sizeof(Chunk) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+  // The memory of the pool, shared by every copy of the NodePool.
+  class Arena {
+  public:
+
+    // After the arena has been joined into another one, this is the other
+    // one, which holds all of the memory. Otherwise it is nullptr.
+    std::shared_ptr<Arena> forward_;
+
+    Arena() : chunks_(nullptr), lastChunk_(nullptr), freeList_(nullptr), lastFree_(nullptr),
+      next_(nullptr), end_(nullptr), nextChunkBytes_(FIRST_CHUNK_BYTES) {}
+
+    ~Arena() {
+      release();
+    }
+
+    void* allocate() {
+      // Reuse a freed slot if there is one.
+      if (freeList_) {
+        FreeSlot* slot = freeList_;
+        freeList_ = slot->next;
+        if (!freeList_) lastFree_ = nullptr;
+        return slot;
+      }
+
+      // Otherwise take the next unused slot of the newest chunk, making a
+      // new chunk if it is full.
+      if (next_ == end_) {
+        addChunk();
+      }
+      void* result = next_;
+      next_ += SLOT_BYTES;
+      return result;
+    }
+
+    void deallocate(void* p) {
+      FreeSlot* slot = static_cast<FreeSlot*>(p);
+      slot->next = freeList_;
+      freeList_ = slot;
+      if (!lastFree_) lastFree_ = slot;
+    }
+
+    void release() {
+      while (chunks_) {
+        Chunk* chunk = chunks_;
+        chunks_ = chunk->next;
+        ::operator delete(chunk->memory);
+      }
+      lastChunk_ = nullptr;
+      freeList_ = nullptr;
+      lastFree_ = nullptr;
+      next_ = nullptr;
+      end_ = nullptr;
+      nextChunkBytes_ = FIRST_CHUNK_BYTES;
+    }
+
+    // Takes over all of the chunks and freed slots of another arena, leaving
+    // it empty. The last chunk and last freed slot of each list are kept so
+    // that the lists can be joined in O(1) time.
+    void absorb(Arena& other) {
+      if (other.chunks_) {
+        other.lastChunk_->next = chunks_;
+        if (!chunks_) lastChunk_ = other.lastChunk_;
+        chunks_ = other.chunks_;
+      }
+      if (other.freeList_) {
+        other.lastFree_->next = freeList_;
+        if (!freeList_) lastFree_ = other.lastFree_;
+        freeList_ = other.freeList_;
+      }
+      other.chunks_ = nullptr;
+      other.lastChunk_ = nullptr;
+      other.freeList_ = nullptr;
+      other.lastFree_ = nullptr;
+      other.next_ = nullptr;
+      other.end_ = nullptr;
+    }
+
+  private:
+
+    // Allocates a new chunk from the heap and makes it the one that slots
+    // are taken from.
+    void addChunk() {
+      std::size_t slotCount = (nextChunkBytes_ - HEADER_BYTES) / SLOT_BYTES;
+      if (slotCount < 1) slotCount = 1;
+      std::size_t chunkBytes = HEADER_BYTES + slotCount * SLOT_BYTES;
+
+      // operator new only promises alignment for ordinary types, so ask for
+      // an extra cache line and align the chunk within it ourselves.
+      void* memory = ::operator new(chunkBytes + CACHE_LINE);
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(memory);
+      address = (address + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+      char* start = reinterpret_cast<char*>(address);
+
+      Chunk* chunk = reinterpret_cast<Chunk*>(start);
+      chunk->next = chunks_;
+      chunk->memory = memory;
+      if (!chunks_) lastChunk_ = chunk;
+      chunks_ = chunk;
+
+      next_ = start + HEADER_BYTES;
+      end_ = next_ + slotCount * SLOT_BYTES;
+
+      if (nextChunkBytes_ < MAX_CHUNK_BYTES) {
+        nextChunkBytes_ *= 2;
+      }
+    }
+
+    // All of the chunks, newest first, and the oldest one.
+    Chunk* chunks_;
+    Chunk* lastChunk_;
+    // Slots that were freed and can be reused, and the last of them.
+    FreeSlot* freeList_;
+    FreeSlot* lastFree_;
+    // The next slot of the newest chunk that has never been used.
+    char* next_;
+    // The end of the newest chunk.
+    char* end_;
+    // The size of the next chunk to allocate.
+    std::size_t nextChunkBytes_;
+  };
+
+  // Follows the forwarding of joined arenas to the one that holds the
+  // memory.
+  static std::shared_ptr<Arena> findRoot(std::shared_ptr<Arena> arena) {
+    while (arena && arena->forward_) {
+      arena = arena->forward_;
+    }
+    return arena;
+  }
+
+  // Returns the arena that holds this pool's memory, and points arena_
+  // straight at it so that the forwarding is only followed once.
+  std::shared_ptr<Arena> root() {
+    if (arena_ && arena_->forward_) {
+      arena_ = findRoot(arena_);
+    }
+    return arena_;
+  }
+
+  // The pool's memory, or nullptr until the first allocation.
+  std::shared_ptr<Arena> arena_;
+};
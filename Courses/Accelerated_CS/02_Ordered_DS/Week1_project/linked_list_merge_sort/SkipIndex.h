@@ -0,0 +1,199 @@
+/**
+ * @file SkipIndex.h
+ * A skip-list index over the nodes of a sorted LinkedList.
+ *
+**/
+
+#pragma once
+
+#include <cstdint> // for std::uint32_t
+
+#include "NodePool.h"
+
+// SkipIndex: A probabilistic index that lets a sorted LinkedList be
+// searched in O(log n) expected time, instead of walking from the head.
+//
+// A skip list is a sorted linked list with "express lanes" on top of it.
+// Here, the LinkedList itself is the bottom lane. About one node in four
+// also gets an entry in index level 0, which links straight to the next
+// node that has one; about one in four of those also gets an entry in level
+// 1, and so on. A search starts in the highest level, moves along it as far
+// as it can without passing the item it is looking for, then drops down a
+// level and does the same, and finally walks a few nodes of the list itself.
+// Each level skips about four times as far as the one below it, so only a
+// few steps are taken at each of the O(log n) levels.
+//
+// The index only holds pointers to the list's nodes; it never moves or
+// copies them, so the nodes keep their addresses. The entries come from a
+// NodePool of their own, so the whole index can be thrown away at once.
+//
+// Which nodes get entries is decided randomly, so no particular order of
+// insertions can make the index lopsided, except by very bad luck.
+template <typename T, typename Node>
+class SkipIndex {
+public:
+
+  // The number of index levels. With one node in four going up each level,
+  // this is plenty for any list that fits in memory.
+  static constexpr int MAX_LEVELS = 16;
+
+  SkipIndex() : levels_(1), stale_(true), random_(2463534242u) {
+    for (int level = 0; level < MAX_LEVELS; level++) {
+      heads_[level].node = nullptr;
+      heads_[level].next = nullptr;
+      heads_[level].down = (level > 0) ? &heads_[level - 1] : nullptr;
+    }
+  }
+
+  // The index can't be copied, since its entries point into one list.
+  SkipIndex(const SkipIndex&) = delete;
+  SkipIndex& operator=(const SkipIndex&) = delete;
+
+  // Whether the index needs to be built again before it can be used,
+  // because the list was changed by something other than insert.
+  bool stale() const { return stale_; }
+
+  // Throws away every entry and marks the index as stale. The list calls
+  // this whenever it changes in a way the index doesn't keep up with.
+  void invalidate() {
+    if (stale_) return;
+    reset();
+    stale_ = true;
+  }
+
+  // Builds the index over the list starting at head, in O(n) time. Returns
+  // false, leaving the index stale, if the list isn't sorted.
+  bool build(Node* head) {
+    reset();
+
+    // The last entry so far at each level, which the next one is linked to.
+    Entry* last[MAX_LEVELS];
+    for (int level = 0; level < MAX_LEVELS; level++) {
+      last[level] = &heads_[level];
+    }
+
+    Node* prev = nullptr;
+    for (Node* cur = head; cur; cur = cur->next) {
+      if (prev && cur->data < prev->data) {
+        reset();
+        stale_ = true;
+        return false;
+      }
+      int height = randomHeight();
+      if (height > levels_) levels_ = height;
+      Entry* below = nullptr;
+      for (int level = 0; level < height; level++) {
+        Entry* entry = createEntry(cur, nullptr, below);
+        last[level]->next = entry;
+        last[level] = entry;
+        below = entry;
+      }
+      prev = cur;
+    }
+
+    stale_ = false;
+    return true;
+  }
+
+  // Finds the last node in the list starting at head that goes before
+  // value, or returns nullptr if none does. A node goes before value if its
+  // data is less than value, or, when orEqual is true, if it is not greater
+  // than value. The way down through the index is remembered for insert.
+  Node* findBefore(Node* head, const T& value, bool orEqual) {
+    Entry* entry = &heads_[levels_ - 1];
+    for (int level = levels_ - 1; level >= 0; level--) {
+      while (entry->next && goesBefore(entry->next->node->data, value, orEqual)) {
+        entry = entry->next;
+      }
+      path_[level] = entry;
+      if (level > 0) entry = entry->down;
+    }
+
+    // Finish with a short walk along the list itself.
+    Node* before = entry->node;
+    Node* cur = before ? before->next : head;
+    while (cur && goesBefore(cur->data, value, orEqual)) {
+      before = cur;
+      cur = cur->next;
+    }
+    return before;
+  }
+
+  // Adds node to the index. node must have just been linked into the list
+  // right after the node that the last call to findBefore returned.
+  void insert(Node* node) {
+    int height = randomHeight();
+    for (int level = levels_; level < height; level++) {
+      path_[level] = &heads_[level];
+    }
+    if (height > levels_) levels_ = height;
+
+    Entry* below = nullptr;
+    for (int level = 0; level < height; level++) {
+      Entry* entry = createEntry(node, path_[level]->next, below);
+      path_[level]->next = entry;
+      below = entry;
+    }
+  }
+
+private:
+
+  // An entry for one node at one level of the index. A node with entries at
+  // several levels has one entry per level, each pointing down to the one
+  // below it.
+  struct Entry {
+    Node* node;
+    Entry* next;
+    Entry* down;
+  };
+
+  // Frees every entry, leaving the index empty.
+  void reset() {
+    pool_.release();
+    for (int level = 0; level < MAX_LEVELS; level++) {
+      heads_[level].next = nullptr;
+    }
+    levels_ = 1;
+  }
+
+  static bool goesBefore(const T& data, const T& value, bool orEqual) {
+    return orEqual ? !(value < data) : data < value;
+  }
+
+  Entry* createEntry(Node* node, Entry* next, Entry* down) {
+    Entry* entry = pool_.allocate(1);
+    entry->node = node;
+    entry->next = next;
+    entry->down = down;
+    return entry;
+  }
+
+  // Picks how many levels a node gets entries in: 0 with probability 3/4,
+  // 1 with probability 3/16, and so on, by counting pairs of zero bits from
+  // a fast "xorshift" random number generator.
+  int randomHeight() {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    std::uint32_t bits = random_;
+    int height = 0;
+    while (height < MAX_LEVELS && (bits & 3) == 0) {
+      height++;
+      bits >>= 2;
+    }
+    return height;
+  }
+
+  // The start of each level, before any entries. These have no node.
+  Entry heads_[MAX_LEVELS];
+  // The number of levels that have been used so far, at least 1.
+  int levels_;
+  // Whether the entries are out of date and must be built again.
+  bool stale_;
+  // The entry at each level where the last findBefore went down a level.
+  Entry* path_[MAX_LEVELS];
+  // The state of the random number generator.
+  std::uint32_t random_;
+  // Where the entries come from.
+  NodePool<Entry> pool_;
+};
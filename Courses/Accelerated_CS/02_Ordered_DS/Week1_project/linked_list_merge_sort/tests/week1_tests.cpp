@@ -8,6 +8,9 @@
 #include <stdexcept>
 #include <sstream>
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
 
 #include "../LinkedList.h"
 #include "../LinkedListExercises.h"
@@ -106,6 +109,56 @@ TEST_CASE("Benchmark: Measuring slowdown for insertOrdered and merge", "[weight=
     }
   }
 
+  SECTION("Timing insertOrdered with a skip-list index") {
+
+    // Building a sorted list by inserting items one at a time in a random
+    // order takes O(n^2) time without an index, since each insertion walks
+    // half of the list on average, but O(n log n) expected time with one.
+    constexpr int LIST_SIZE_SMALL = 20000;
+    constexpr int LIST_SIZE_LARGE = 2000000;
+    auto item = [](int i) { return (int)((i * 2654435761u) % 1000003u); };
+
+    std::cout << std::endl;
+
+    {
+      std::cout << "Inserting " << LIST_SIZE_SMALL << " items without an index:" << std::endl;
+      LinkedList<int> list;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < LIST_SIZE_SMALL; i++) {
+        list.insertOrdered(item(i));
+      }
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (list.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+    }
+    {
+      std::cout << "The same items, with an index:" << std::endl;
+      LinkedList<int> list;
+      list.buildIndex();
+      auto start_time = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < LIST_SIZE_SMALL; i++) {
+        list.insertOrdered(item(i));
+      }
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (list.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+    }
+    {
+      std::cout << "Inserting " << LIST_SIZE_LARGE << " items with an index:" << std::endl;
+      LinkedList<int> list;
+      list.buildIndex();
+      auto start_time = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < LIST_SIZE_LARGE; i++) {
+        list.insertOrdered(item(i));
+      }
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (list.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+      std::cout << "Without an index, that would take about " << (LIST_SIZE_LARGE / LIST_SIZE_SMALL) * (LIST_SIZE_LARGE / LIST_SIZE_SMALL)
+        << "x as long as the first case." << std::endl;
+    }
+  }
+
   SECTION("Timing merge") {
 
     constexpr int NUM_TEST_RUNS = 5;
@@ -324,7 +377,7 @@ TEST_CASE("Benchmark: Measuring slowdown for sorting algorithms", "[weight=0][.]
     std::cout << std::endl;
 
     std::cout << "mergeSortIterative is being tested on much larger lists than the others"
-      << std::endl << " because this implementation exhibits extra overhead for small list sizes."
+      << std::endl << " because it sorts in place after making one copy, so it is much faster."
       << std::endl << " The change in running time becomes more clearly O(n log n) with inputs this large." << std::endl;
 
     constexpr int NUM_TEST_RUNS = 1;
@@ -400,6 +453,146 @@ TEST_CASE("Benchmark: Measuring slowdown for sorting algorithms", "[weight=0][.]
       << std::endl << " for a single algorithm before and after the increase in input size.)" << std::endl;
   }
 
+  SECTION("Timing sortInPlace") {
+
+    std::cout << std::endl;
+
+    constexpr int LIST_SIZE_MEDIUM = 50000;
+    constexpr int LIST_SIZE_LARGE = LIST_SIZE_MEDIUM*10;
+
+    LinkedList<int> unsortedList1;
+    for (int i = LIST_SIZE_MEDIUM; i>0; i--) {
+      unsortedList1.pushBack(i);
+      unsortedList1.pushFront(i);
+    }
+
+    LinkedList<int> unsortedList2;
+    for (int i = LIST_SIZE_LARGE; i>0; i--) {
+      unsortedList2.pushBack(i);
+      unsortedList2.pushFront(i);
+    }
+
+    // Only the sort itself is timed, not copying the unsorted list.
+    {
+      std::cout << "Timing sortInPlace on the same lists as mergeSortIterative:" << std::endl;
+      LinkedList<int> sortedList = unsortedList1;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      sortedList.sortInPlace();
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (!sortedList.isSorted()) std::cout << "WARNING: sortInPlace result not sorted." << std::endl;
+      if (sortedList.size() != unsortedList1.size()) std::cout << "WARNING: List size didn't match!" << std::endl;
+      if (sortedList.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+    }
+    {
+      std::cout << "Again, after increasing list size 10x:" << std::endl;
+      LinkedList<int> sortedList = unsortedList2;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      sortedList.sortInPlace();
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (!sortedList.isSorted()) std::cout << "WARNING: sortInPlace result not sorted." << std::endl;
+      if (sortedList.size() != unsortedList2.size()) std::cout << "WARNING: List size didn't match!" << std::endl;
+      if (sortedList.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+      std::cout << "sortInPlace is also O(n log n), but it makes no copies and no allocations." << std::endl;
+    }
+  }
+
+  SECTION("Timing naturalSortInPlace on nearly sorted lists") {
+
+    std::cout << std::endl;
+
+    constexpr int LIST_SIZE_MEDIUM = 100000;
+    constexpr int LIST_SIZE_LARGE = LIST_SIZE_MEDIUM*10;
+
+    // Sorted lists with every 1000th item out of place
+    LinkedList<int> nearlySortedList1;
+    for (int i = 0; i < LIST_SIZE_MEDIUM; i++) {
+      nearlySortedList1.pushBack(i % 1000 ? i : -i);
+    }
+
+    LinkedList<int> nearlySortedList2;
+    for (int i = 0; i < LIST_SIZE_LARGE; i++) {
+      nearlySortedList2.pushBack(i % 1000 ? i : -i);
+    }
+
+    {
+      std::cout << "Timing naturalSortInPlace on a nearly sorted list:" << std::endl;
+      LinkedList<int> sortedList = nearlySortedList1;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      sortedList.naturalSortInPlace();
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (!sortedList.isSorted()) std::cout << "WARNING: naturalSortInPlace result not sorted." << std::endl;
+      if (sortedList.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+    }
+    {
+      std::cout << "Timing sortInPlace on the same list:" << std::endl;
+      LinkedList<int> sortedList = nearlySortedList1;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      sortedList.sortInPlace();
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (!sortedList.isSorted()) std::cout << "WARNING: sortInPlace result not sorted." << std::endl;
+      if (sortedList.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+    }
+    {
+      std::cout << "Again with naturalSortInPlace, after increasing list size 10x:" << std::endl;
+      LinkedList<int> sortedList = nearlySortedList2;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      sortedList.naturalSortInPlace();
+      auto stop_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+      if (!sortedList.isSorted()) std::cout << "WARNING: naturalSortInPlace result not sorted." << std::endl;
+      if (sortedList.size()) std::cout << "Time elapsed: " << dur_ms.count() << "ms" << std::endl;
+      std::cout << "With few runs to merge, naturalSortInPlace is close to O(n), so the larger sort\n should take only a little over 10x longer." << std::endl;
+    }
+  }
+
+}
+
+// This is hidden because of the [.] tag.
+// You can run it explicitly with: ./test [bench]
+TEST_CASE("Benchmark: Node pool compared with new and delete", "[weight=0][.][bench]") {
+
+  constexpr int LIST_SIZE = 2000000;
+  constexpr int NUM_TEST_RUNS = 3;
+
+  std::cout << std::endl;
+
+  // Builds a list of LIST_SIZE items, pops half of them, pushes them back,
+  // and clears the list, NUM_TEST_RUNS times.
+  auto timeBuildAndClear = [](auto& list) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < NUM_TEST_RUNS; run++) {
+      for (int i = 0; i < LIST_SIZE; i++) {
+        list.pushBack(i);
+      }
+      for (int i = 0; i < LIST_SIZE / 2; i++) {
+        list.popFront();
+      }
+      for (int i = 0; i < LIST_SIZE / 2; i++) {
+        list.pushFront(i);
+      }
+      if (list.size() != LIST_SIZE) std::cout << "WARNING: List size didn't match!" << std::endl;
+      list.clear();
+    }
+    auto stop_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> dur_ms = stop_time - start_time;
+    return dur_ms.count();
+  };
+
+  {
+    std::cout << "Timing a list of " << LIST_SIZE << " items with new and delete (std::allocator):" << std::endl;
+    LinkedList<int, std::allocator<int>> list;
+    std::cout << "Time elapsed: " << timeBuildAndClear(list) << "ms" << std::endl;
+  }
+  {
+    std::cout << "Timing the same with the default NodePool:" << std::endl;
+    LinkedList<int> list;
+    std::cout << "Time elapsed: " << timeBuildAndClear(list) << "ms" << std::endl;
+    std::cout << "The pool takes nodes from large chunks, reuses popped nodes, and clear()\n frees the chunks all at once, so it should be noticeably faster." << std::endl;
+  }
 }
 
 // ========================================================================
@@ -695,3 +888,507 @@ TEST_CASE("Testing merge: Left and right lists non-empty; right list is longer",
   }
 }
 
+
+// ========================================================================
+// Tests: sortInPlace
+// ========================================================================
+
+TEST_CASE("Testing sortInPlace: Matches mergeSort and keeps the same nodes", "[weight=0]") {
+
+  LinkedList<int> list;
+  for (int i = 0; i < 1000; i++) {
+    // A scrambled sequence with plenty of repeated values
+    list.pushBack((i * 7919) % 101);
+  }
+  auto expectedList = list.mergeSort();
+
+  // Remember which nodes the list was made of, to check that sortInPlace
+  // relinks the existing nodes rather than making new ones.
+  LinkedList<const void*> nodesBefore;
+  for (auto cur = list.getHeadPtr(); cur; cur = cur->next) {
+    nodesBefore.insertOrdered(cur);
+  }
+
+  list.sortInPlace();
+
+  SECTION("Checking that values are correct") {
+    REQUIRE(list == expectedList);
+    REQUIRE(list.isSorted());
+  }
+
+  SECTION("Checking that the list prev links and tail pointer are being set correctly") {
+    REQUIRE(list.assertPrevLinks());
+  }
+
+  SECTION("Checking that the list size is being tracked correctly") {
+    REQUIRE(list.assertCorrectSize());
+  }
+
+  SECTION("Checking that the original nodes were reused") {
+    LinkedList<const void*> nodesAfter;
+    for (auto cur = list.getHeadPtr(); cur; cur = cur->next) {
+      nodesAfter.insertOrdered(cur);
+    }
+    REQUIRE(nodesAfter == nodesBefore);
+  }
+}
+
+TEST_CASE("Testing sortInPlace: Small lists and equal items", "[weight=0]") {
+
+  SECTION("Checking empty and single-item lists") {
+    LinkedList<int> empty;
+    empty.sortInPlace();
+    REQUIRE(empty.empty());
+    REQUIRE(empty.assertPrevLinks());
+
+    LinkedList<int> single;
+    single.pushBack(5);
+    single.sortInPlace();
+    REQUIRE(single.front() == 5);
+    REQUIRE(single.getHeadPtr() == single.getTailPtr());
+  }
+
+  SECTION("Checking that equal items keep their original order") {
+    // Sort pairs by their first value only; the second value records the
+    // original position.
+    struct Item {
+      int key;
+      int position;
+      bool operator<(const Item& other) const { return key < other.key; }
+    };
+    LinkedList<Item> items;
+    for (int i = 0; i < 200; i++) {
+      items.pushBack(Item{(i * 37) % 5, i});
+    }
+    items.sortInPlace();
+    REQUIRE(items.assertPrevLinks());
+    REQUIRE(items.assertCorrectSize());
+
+    bool stable = true;
+    for (auto cur = items.getHeadPtr(); cur && cur->next; cur = cur->next) {
+      const Item& a = cur->data;
+      const Item& b = cur->next->data;
+      if (b.key < a.key || (a.key == b.key && b.position < a.position)) stable = false;
+    }
+    REQUIRE(stable);
+  }
+}
+
+// ========================================================================
+// Tests: naturalSortInPlace
+// ========================================================================
+
+TEST_CASE("Testing naturalSortInPlace: Matches sortInPlace on many kinds of input", "[weight=0]") {
+
+  constexpr int LIST_SIZE = 1000;
+  LinkedList<LinkedList<int>> inputs;
+  {
+    LinkedList<int> scrambled, sorted, reversed, nearlySorted, sawtooth, constant;
+    for (int i = 0; i < LIST_SIZE; i++) {
+      scrambled.pushBack((i * 7919) % 101);
+      sorted.pushBack(i);
+      reversed.pushFront(i);
+      nearlySorted.pushBack(i % 100 ? i : -i);
+      sawtooth.pushBack(i % 37);
+      constant.pushBack(4);
+    }
+    inputs.pushBack(scrambled);
+    inputs.pushBack(sorted);
+    inputs.pushBack(reversed);
+    inputs.pushBack(nearlySorted);
+    inputs.pushBack(sawtooth);
+    inputs.pushBack(constant);
+  }
+
+  for (auto input = inputs.getHeadPtr(); input; input = input->next) {
+    LinkedList<int> expectedList = input->data;
+    expectedList.sortInPlace();
+
+    LinkedList<int> list = input->data;
+    list.naturalSortInPlace();
+    REQUIRE(list == expectedList);
+    REQUIRE(list.assertPrevLinks());
+    REQUIRE(list.assertCorrectSize());
+
+    REQUIRE(input->data.mergeSortIterative() == expectedList);
+  }
+}
+
+TEST_CASE("Testing naturalSortInPlace: Equal items keep their original order", "[weight=0]") {
+
+  struct Item {
+    int key;
+    int position;
+    bool operator<(const Item& other) const { return key < other.key; }
+  };
+
+  // Decreasing runs with repeated keys, to check that reversing a run never
+  // swaps equal items.
+  LinkedList<Item> items;
+  for (int i = 0; i < 300; i++) {
+    items.pushBack(Item{10 - (i % 11) / 2, i});
+  }
+  items.naturalSortInPlace();
+  REQUIRE(items.assertPrevLinks());
+  REQUIRE(items.assertCorrectSize());
+
+  bool stable = true;
+  for (auto cur = items.getHeadPtr(); cur && cur->next; cur = cur->next) {
+    const Item& a = cur->data;
+    const Item& b = cur->next->data;
+    if (b.key < a.key || (a.key == b.key && b.position < a.position)) stable = false;
+  }
+  REQUIRE(stable);
+}
+
+// ========================================================================
+// Tests: NodePool
+// ========================================================================
+
+TEST_CASE("Testing NodePool: Nodes are reused and lists work with any allocator", "[weight=0]") {
+
+  SECTION("Checking that a popped node's memory is reused") {
+    LinkedList<int> list;
+    list.pushBack(1);
+    list.pushBack(2);
+    auto poppedNode = list.getTailPtr();
+    list.popBack();
+    list.pushBack(3);
+    REQUIRE(list.getTailPtr() == poppedNode);
+    REQUIRE(list.back() == 3);
+  }
+
+  SECTION("Checking that chunks start on a cache line") {
+    LinkedList<int> list;
+    list.pushBack(1);
+    auto address = reinterpret_cast<std::uintptr_t>(list.getHeadPtr());
+    REQUIRE(address % NodePool<int>::CACHE_LINE == 0);
+  }
+
+  SECTION("Checking that a pool only this list uses is released all at once by clear") {
+    NodePool<int> pool;
+    REQUIRE(pool.unique());
+    int* item = pool.allocate(1);
+    REQUIRE(pool.unique());
+    {
+      NodePool<int> copy = pool;
+      REQUIRE(!pool.unique());
+    }
+    REQUIRE(pool.unique());
+    pool.deallocate(item, 1);
+
+    // Without release, clear would put the nodes on the free list, and the
+    // next node would reuse the tail's memory. Once the chunks are released,
+    // it comes from the start of a new chunk instead.
+    LinkedList<int> list;
+    list.pushBack(1);
+    list.pushBack(2);
+    auto oldTail = list.getTailPtr();
+    list.clear();
+    list.pushBack(3);
+    REQUIRE(list.getHeadPtr() != oldTail);
+    auto address = reinterpret_cast<std::uintptr_t>(list.getHeadPtr());
+    REQUIRE(address % NodePool<int>::CACHE_LINE == 0);
+    REQUIRE(list.size() == 1);
+  }
+
+  SECTION("Checking that lists of nodes with destructors are cleared correctly") {
+    LinkedList<std::string> list;
+    for (int i = 0; i < 1000; i++) {
+      list.pushBack(std::string(100, 'a' + i % 26));
+    }
+    LinkedList<std::string> copy = list;
+    list.clear();
+    REQUIRE(list.empty());
+    REQUIRE(list.assertCorrectSize());
+    for (int i = 0; i < 10; i++) {
+      list.pushFront("again");
+    }
+    REQUIRE(list.size() == 10);
+    REQUIRE(list.assertPrevLinks());
+    REQUIRE(copy.size() == 1000);
+    REQUIRE(copy.back() == std::string(100, 'a' + 999 % 26));
+  }
+
+  SECTION("Checking that a list with std::allocator behaves the same") {
+    LinkedList<int, std::allocator<int>> list;
+    for (int i = 10; i > 0; i--) {
+      list.insertOrdered(i);
+    }
+    list.popFront();
+    list.pushFront(0);
+    REQUIRE(list.size() == 10);
+    REQUIRE(list.isSorted());
+    REQUIRE(list.assertPrevLinks());
+    REQUIRE(list.assertCorrectSize());
+
+    LinkedList<int, std::allocator<int>> other;
+    other.pushBack(5);
+    REQUIRE(list.merge(other).size() == 11);
+    REQUIRE(list.mergeSort() == list);
+  }
+}
+
+TEST_CASE("Testing merge and splice: Nodes move between lists without copying", "[weight=0]") {
+
+  SECTION("Checking that merging with std::move relinks the nodes of both lists") {
+    LinkedList<int> left;
+    LinkedList<int> right;
+    for (int i = 0; i < 20; i += 2) {
+      left.pushBack(i);
+      right.pushBack(i + 1);
+    }
+    right.pushBack(100);
+    auto leftHead = left.getHeadPtr();
+    auto rightTail = right.getTailPtr();
+    LinkedList<int> expected = left.merge(right);
+
+    left.merge(std::move(right));
+    REQUIRE(left == expected);
+    REQUIRE(left.getHeadPtr() == leftHead);
+    REQUIRE(left.getTailPtr() == rightTail);
+    REQUIRE(left.assertPrevLinks());
+    REQUIRE(left.assertCorrectSize());
+    REQUIRE(right.empty());
+    REQUIRE(right.assertCorrectSize());
+
+    // The nodes from both lists must still be freed correctly.
+    left.clear();
+    right.pushBack(1);
+    REQUIRE(right.size() == 1);
+  }
+
+  SECTION("Checking that merging with std::move keeps equal items from this list first") {
+    LinkedList<int> left;
+    LinkedList<int> right;
+    left.pushBack(1);
+    left.pushBack(2);
+    right.pushBack(1);
+    right.pushBack(2);
+    auto leftNode = left.getHeadPtr();
+    auto rightNode = right.getHeadPtr();
+    left.merge(std::move(right));
+    REQUIRE(left.getHeadPtr() == leftNode);
+    REQUIRE(left.getHeadPtr()->next == rightNode);
+  }
+
+  SECTION("Checking splice, spliceRange, and splitAt") {
+    LinkedList<int> list;
+    LinkedList<int> other;
+    for (int i = 0; i < 10; i++) {
+      list.pushBack(i);
+      other.pushBack(100 + i);
+    }
+    auto otherHead = other.getHeadPtr();
+
+    // Move all of other into the middle of list.
+    auto position = list.getHeadPtr()->next->next;
+    list.splice(position, other);
+    REQUIRE(list.size() == 20);
+    REQUIRE(other.empty());
+    REQUIRE(position->prev->data == 109);
+    REQUIRE(list.getHeadPtr()->next->next == otherHead);
+    REQUIRE(list.assertPrevLinks());
+    REQUIRE(list.assertCorrectSize());
+
+    // Split the nodes of other back off, from near each end of the list.
+    LinkedList<int> tail = list.splitAt(12);
+    REQUIRE(list.size() == 12);
+    REQUIRE(tail.size() == 8);
+    REQUIRE(list.back() == 109);
+    REQUIRE(tail.front() == 2);
+    REQUIRE(tail.assertPrevLinks());
+    LinkedList<int> middle = list.splitAt(2);
+    REQUIRE(middle.getHeadPtr() == otherHead);
+    REQUIRE(middle.size() == 10);
+    REQUIRE(middle.assertPrevLinks());
+    REQUIRE(list.assertPrevLinks());
+    REQUIRE(list.assertCorrectSize());
+    REQUIRE(list.splitAt(2).empty());
+
+    // Move three nodes from the front of tail to the front of list.
+    auto first = tail.getHeadPtr();
+    auto last = first->next->next;
+    list.spliceRange(list.getHeadPtr(), tail, first, last, 3);
+    REQUIRE(list.size() == 5);
+    REQUIRE(tail.size() == 5);
+    REQUIRE(list.front() == 2);
+    REQUIRE(tail.front() == 5);
+    REQUIRE(list.assertPrevLinks());
+    REQUIRE(tail.assertPrevLinks());
+    REQUIRE(list.assertCorrectSize());
+
+    // Move a node to the end of the same list.
+    list.spliceRange(nullptr, list, list.getHeadPtr(), list.getHeadPtr(), 1);
+    REQUIRE(list.front() == 3);
+    REQUIRE(list.back() == 2);
+    REQUIRE(list.size() == 5);
+    REQUIRE(list.assertPrevLinks());
+  }
+
+  SECTION("Checking that moving a list takes its nodes") {
+    LinkedList<std::string> list;
+    list.pushBack("a");
+    list.pushBack("b");
+    auto head = list.getHeadPtr();
+    LinkedList<std::string> moved(std::move(list));
+    REQUIRE(moved.getHeadPtr() == head);
+    REQUIRE(moved.size() == 2);
+    REQUIRE(list.empty());
+    REQUIRE(list.assertCorrectSize());
+
+    LinkedList<std::string> assigned;
+    assigned.pushBack("c");
+    assigned = std::move(moved);
+    REQUIRE(assigned.getHeadPtr() == head);
+    REQUIRE(assigned.back() == "b");
+    REQUIRE(moved.empty());
+    moved.pushBack("d");
+    REQUIRE(moved.size() == 1);
+  }
+
+  SECTION("Checking that lists with std::allocator can splice too") {
+    LinkedList<int, std::allocator<int>> list;
+    LinkedList<int, std::allocator<int>> other;
+    for (int i = 0; i < 5; i++) {
+      list.pushBack(2 * i);
+      other.pushBack(2 * i + 1);
+    }
+    list.merge(std::move(other));
+    REQUIRE(list.size() == 10);
+    REQUIRE(list.isSorted());
+    LinkedList<int, std::allocator<int>> rest = list.splitAt(5);
+    list.splice(nullptr, rest);
+    REQUIRE(list.size() == 10);
+    REQUIRE(list.isSorted());
+    REQUIRE(list.assertPrevLinks());
+  }
+}
+
+TEST_CASE("Testing skip-list index: insertOrdered, find, and lowerBound", "[weight=0]") {
+
+  // The same pseudo-random items for every section, with plenty of repeats.
+  auto item = [](int i) { return (i * 7919) % 1000; };
+
+  SECTION("Checking that indexed insertOrdered matches insertOrdered without an index") {
+    LinkedList<int> indexed;
+    LinkedList<int> plain;
+    indexed.buildIndex();
+    REQUIRE(indexed.hasIndex());
+    for (int i = 0; i < 5000; i++) {
+      indexed.insertOrdered(item(i));
+      plain.insertOrdered(item(i));
+    }
+    REQUIRE(indexed == plain);
+    REQUIRE(indexed.isSorted());
+    REQUIRE(indexed.assertPrevLinks());
+    REQUIRE(indexed.assertCorrectSize());
+  }
+
+  SECTION("Checking that equal items are inserted after the existing ones, without moving any nodes") {
+    LinkedList<std::string> list;
+    list.pushBack("a");
+    list.pushBack("b");
+    list.pushBack("c");
+    list.buildIndex();
+    auto firstB = list.getHeadPtr()->next;
+    list.insertOrdered("b");
+    REQUIRE(list.getHeadPtr()->next == firstB);
+    REQUIRE(firstB->next->data == "b");
+    REQUIRE(firstB->next->next == list.getTailPtr());
+    REQUIRE(list.find("b") == firstB);
+  }
+
+  SECTION("Checking that equal items go in the same place with and without an index") {
+    struct Item {
+      int key;
+      int id;
+      bool operator<(const Item& other) const { return key < other.key; }
+    };
+
+    LinkedList<Item> indexed;
+    LinkedList<Item> plain;
+    indexed.buildIndex();
+    for (int i = 0; i < 2000; i++) {
+      indexed.insertOrdered(Item{item(i) % 50, i});
+      plain.insertOrdered(Item{item(i) % 50, i});
+    }
+    REQUIRE(indexed.size() == plain.size());
+
+    bool same = true;
+    bool stable = true;
+    auto cur = indexed.getHeadPtr();
+    for (auto other = plain.getHeadPtr(); cur && other; cur = cur->next, other = other->next) {
+      if (cur->data.key != other->data.key || cur->data.id != other->data.id) same = false;
+      if (cur->next && cur->data.key == cur->next->data.key && cur->next->data.id < cur->data.id) stable = false;
+    }
+    REQUIRE(same);
+    REQUIRE(stable);
+  }
+
+  SECTION("Checking find and lowerBound with and without an index") {
+    LinkedList<int> list;
+    for (int i = 0; i < 2000; i++) {
+      list.insertOrdered(item(i));
+    }
+    LinkedList<int> indexed = list;
+    indexed.buildIndex();
+    for (int value = -1; value <= 1001; value++) {
+      auto expected = list.lowerBound(value);
+      auto found = indexed.lowerBound(value);
+      if (expected) {
+        REQUIRE(found);
+        REQUIRE(found->data == expected->data);
+        REQUIRE((!found->prev || found->prev->data < value));
+      }
+      else {
+        REQUIRE(!found);
+      }
+      REQUIRE((indexed.find(value) ? indexed.find(value) == found : !list.find(value)));
+    }
+  }
+
+  SECTION("Checking that the index is rebuilt after other changes to the list") {
+    LinkedList<int> list;
+    for (int i = 0; i < 100; i++) {
+      list.pushBack(2 * i);
+    }
+    list.buildIndex();
+    list.insertOrdered(51);
+    list.popFront();
+    list.popBack();
+    list.pushBack(1000);
+    list.pushFront(-1);
+    REQUIRE(list.find(51)->prev->data == 50);
+    REQUIRE(list.find(1000) == list.getTailPtr());
+    REQUIRE(list.lowerBound(-5) == list.getHeadPtr());
+
+    LinkedList<int> other;
+    other.pushBack(3);
+    list.splice(list.getHeadPtr(), other);
+    list.sortInPlace();
+    list.insertOrdered(3);
+    REQUIRE(list.find(3)->next->data == 3);
+    REQUIRE(list.isSorted());
+    REQUIRE(list.assertPrevLinks());
+
+    LinkedList<int> moved = std::move(list);
+    REQUIRE(moved.hasIndex());
+    REQUIRE(!list.hasIndex());
+    REQUIRE(moved.find(1000) == moved.getTailPtr());
+
+    moved.clear();
+    moved.insertOrdered(5);
+    REQUIRE(moved.find(5) == moved.getHeadPtr());
+    moved.dropIndex();
+    REQUIRE(!moved.hasIndex());
+  }
+
+  SECTION("Checking that an unsorted list can't be indexed") {
+    LinkedList<int> list;
+    list.pushBack(2);
+    list.pushBack(1);
+    REQUIRE_THROWS_AS(list.buildIndex(), std::runtime_error);
+    REQUIRE(list.find(1) == list.getTailPtr());
+  }
+}